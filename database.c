@@ -162,23 +162,34 @@ void create_user(const char *name, DBList *atags)
 char *get_user_id_by_name(const char *name)
 {
   DBList *user_ids = get_user_ids();
+  DBList *query_keys = create_dblist();
   DBListNode *curr = user_ids->head;
   while (curr)
   {
-    const char *user_id = curr->data->value.string;
-    char *query_key = create_query_key(USER_NS, user_id, NAME_FIELD_NAME);
-    const char *user_name = dbapi_get(query_key);
-    free(query_key);
-    if (user_name && strcmp(user_name, name) == 0)
+    rpush(query_keys, create_dblistnode(dbobj_create_string(create_query_key(USER_NS, curr->data->value.string, NAME_FIELD_NAME))));
+    curr = curr->next;
+  }
+
+  // 以單一請求取得所有 user 的名稱
+  DBList *user_names = dbapi_mget(query_keys);
+  free_dblist(query_keys);
+
+  char *oid = NULL;
+  DBListNode *name_node = user_names ? user_names->head : NULL;
+  curr = user_ids->head;
+  while (curr && name_node)
+  {
+    if (dbobj_is_string(name_node->data) && strcmp(name_node->data->value.string, name) == 0)
     {
-      char *oid = dbutil_strdup(user_id);
-      free_dblist(user_ids);
-      return oid;
+      oid = dbutil_strdup(curr->data->value.string);
+      break;
     }
     curr = curr->next;
+    name_node = name_node->next;
   }
+  free_dblist(user_names);
   free_dblist(user_ids);
-  return NULL;
+  return oid;
 }
 
 void delete_user(const char *oid)
@@ -268,6 +279,23 @@ DBList *get_post_tags(const char *post_id)
   return post_tags;
 }
 
+DBList *get_posts_tags(DBList *post_ids)
+{
+  DBList *query_keys = create_dblist();
+  DBListNode *post_id_node = post_ids->head;
+  while (post_id_node)
+  {
+    rpush(query_keys, create_dblistnode(dbobj_create_string(create_query_key(POST_NS, post_id_node->data->value.string, TAGS_FIELD_NAME))));
+    post_id_node = post_id_node->next;
+  }
+
+  // 以單一請求取得所有貼文的 tags
+  DBList *posts_tags = dbapi_mlrange(query_keys, 0, DB_UINT_MAX);
+  free_dblist(query_keys);
+
+  return posts_tags ? posts_tags : create_dblist();
+}
+
 DBList *get_posts_by_tag(const char *tag_id, size_t limit, const bool by_index)
 {
   if (by_index)
@@ -281,26 +309,41 @@ DBList *get_posts_by_tag(const char *tag_id, size_t limit, const bool by_index)
   DBList *filtered_post_ids = create_dblist();
   DBList *post_ids = get_post_ids();
   DBListNode *post_id_node = post_ids->head;
+  db_uint_t post_tags_capacity = 16, post_tags_count, i;
+  const char **post_tag_ids = (const char **)malloc(post_tags_capacity * sizeof(const char *));
+  if (!post_tag_ids)
+    EXIT_ON_MEMORY_ERROR();
 
+  // 直接借用資料庫中的 tags 比對，不必複製每個 tag
+  dbapi_begin_read();
   while (post_id_node && filtered_post_ids->length < limit)
   {
     const char *post_id = post_id_node->data->value.string;
-    DBList *post_tags = get_post_tags(post_id);
-    DBListNode *post_tag_node = post_tags->head;
-    while (post_tag_node)
+    char *query_key = create_query_key(POST_NS, post_id, TAGS_FIELD_NAME);
+    post_tags_count = dbapi_lrange_view(query_key, 0, DB_UINT_MAX, post_tag_ids, post_tags_capacity);
+    if (post_tags_count > post_tags_capacity)
+    {
+      post_tags_capacity = post_tags_count;
+      post_tag_ids = (const char **)realloc(post_tag_ids, post_tags_capacity * sizeof(const char *));
+      if (!post_tag_ids)
+        EXIT_ON_MEMORY_ERROR();
+      dbapi_lrange_view(query_key, 0, DB_UINT_MAX, post_tag_ids, post_tags_capacity);
+    }
+    free(query_key);
+
+    for (i = 0; i < post_tags_count; ++i)
     {
-      const char *post_tag_id = post_tag_node->data->value.string;
-      if (strcmp(post_tag_id, tag_id) == 0)
+      if (strcmp(post_tag_ids[i], tag_id) == 0)
       {
         rpush(filtered_post_ids, create_dblistnode_with_string(post_id));
         break;
       }
-      post_tag_node = post_tag_node->next;
     }
-    free_dblist(post_tags);
     post_id_node = post_id_node->next;
   }
+  dbapi_end_read();
 
+  free(post_tag_ids);
   free_dblist(post_ids);
   return filtered_post_ids;
 }
@@ -366,6 +409,15 @@ db_bool_t set_user_ptags(const char *user_id, DBList *tags)
   return true; // 成功更新 s，返回 true
 }
 
+db_bool_t remove_user_ptag(const char *user_id, const char *ptag)
+{
+  char *query_key = create_query_key(USER_NS, user_id, PTAGS_FIELD_NAME);
+  db_uint_t removed = dbapi_lrem(query_key, 1, ptag);
+  free(query_key);
+
+  return removed > 0;
+}
+
 void start_db(void)
 {
   dbapi_start_server();
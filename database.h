@@ -45,6 +45,10 @@ void delete_posts();
 // 呼叫者負責釋放傳回的字串陣列。
 DBList *get_post_tags(const char *tag_id);
 
+// 以單一請求取得多篇 post 的 tags，依 post_ids 的順序每篇回傳一個 list 節點
+// 呼叫者需釋放傳回的陣列
+DBList *get_posts_tags(DBList *post_ids);
+
 // 根據某個標籤取得貼文清單
 // 呼叫者需釋放傳回的陣列
 DBList *get_posts_by_tag(const char *tag_id, size_t limit, const bool by_index);
@@ -66,6 +70,9 @@ DBList *get_user_ptags(const char *user_id);
 
 db_bool_t set_user_ptags(const char *user_id, DBList *tags);
 
+// 只移除一個 ptag，不必重建整個 List
+db_bool_t remove_user_ptag(const char *user_id, const char *ptag);
+
 void start_db(void);
 
 void save_db(void);
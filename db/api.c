@@ -2,19 +2,140 @@
 #include <stdlib.h>
 #include <stdarg.h>
 #include <string.h>
+#include <strings.h>
 #include <ctype.h>
+#include <time.h>
 
 #include "utils.h"
 #include "interaction.h"
 #include "list.h"
+#include "arena.h"
 #include "core.h"
+#include "resp.h"
 #include "api.h"
 
 // Parses command string into DBRequest structure
-static DBRequest *parse_command(const char *command);
+static DBRequest *parse_command(const char *command, size_t length);
+
+// Commands a pipe sends to the worker together, the next window is decoded while they run
+#define DBAPI_PIPE_WINDOW 1024
+// Bytes read from the input of a pipe at a time
+#define DBAPI_PIPE_READ_SIZE 65536
+
+typedef struct DBCommandName
+{
+  const char *name;
+  db_action_t action;
+} DBCommandName;
+
+// Sorted by name for the binary search of `find_command`, names are matched case-insensitively
+static const DBCommandName command_names[] = {
+    {"BLPOP", DB_BLPOP},
+    {"BRPOP", DB_BRPOP},
+    {"DECR", DB_DECR},
+    {"DECRBY", DB_DECRBY},
+    {"DEL", DB_DEL},
+    {"EXPIRE", DB_EXPIRE},
+    {"FLUSHALL", DB_FLUSHALL},
+    {"GET", DB_GET},
+    {"HDEL", DB_HDEL},
+    {"HGET", DB_HGET},
+    {"HGETALL", DB_HGETALL},
+    {"HINCRBY", DB_HINCRBY},
+    {"HINCRBYFLOAT", DB_HINCRBYFLOAT},
+    {"HMGET", DB_HMGET},
+    {"HSCAN", DB_HSCAN},
+    {"HSET", DB_HSET},
+    {"INCR", DB_INCR},
+    {"INCRBY", DB_INCRBY},
+    {"INFO_DATASET_MEMORY", DB_INFO_DATASET_MEMORY},
+    {"KEYS", DB_KEYS},
+    {"LINDEX", DB_LINDEX},
+    {"LINSERT", DB_LINSERT},
+    {"LLEN", DB_LLEN},
+    {"LPOP", DB_LPOP},
+    {"LPOS", DB_LPOS},
+    {"LPUSH", DB_LPUSH},
+    {"LRANGE", DB_LRANGE},
+    {"LREM", DB_LREM},
+    {"LSET", DB_LSET},
+    {"LTRIM", DB_LTRIM},
+    {"MGET", DB_MGET},
+    {"MLRANGE", DB_MLRANGE},
+    {"MSET", DB_MSET},
+    {"PERSIST", DB_PERSIST},
+    {"PEXPIRE", DB_PEXPIRE},
+    {"PTTL", DB_PTTL},
+    {"RENAME", DB_RENAME},
+    {"RPOP", DB_RPOP},
+    {"RPUSH", DB_RPUSH},
+    {"SAVE", DB_SAVE},
+    {"SCAN", DB_SCAN},
+    {"SET", DB_SET},
+    {"SHUTDOWN", DB_SHUTDOWN},
+    {"START", DB_START},
+    {"TTL", DB_TTL},
+    {"ZADD", DB_ZADD},
+    {"ZCARD", DB_ZCARD},
+    {"ZCOUNT", DB_ZCOUNT},
+    {"ZINCRBY", DB_ZINCRBY},
+    {"ZINTERSTORE", DB_ZINTERSTORE},
+    {"ZRANGE", DB_ZRANGE},
+    {"ZRANGEBYSCORE", DB_ZRANGEBYSCORE},
+    {"ZRANK", DB_ZRANK},
+    {"ZREM", DB_ZREM},
+    {"ZREMRANGEBYSCORE", DB_ZREMRANGEBYSCORE},
+    {"ZREVRANGE", DB_ZREVRANGE},
+    {"ZREVRANGEBYSCORE", DB_ZREVRANGEBYSCORE},
+    {"ZSCAN", DB_ZSCAN},
+    {"ZSCORE", DB_ZSCORE},
+    {"ZUNIONSTORE", DB_ZUNIONSTORE},
+};
+
+// Commands of a pipe sent to the worker together
+typedef struct DBApiPipeWindow
+{
+  DBRequest *requests[DBAPI_PIPE_WINDOW];
+  DBReply *replies[DBAPI_PIPE_WINDOW];
+  db_uint_t count;
+} DBApiPipeWindow;
+
+// Decodes commands from `data`, starting at `*offset`, until the window is full; returns DB_RESP_INCOMPLETE once the data runs out
+static db_resp_status_t fill_pipe_window(DBApiPipeWindow *window, const char *data, size_t length, db_bool_t at_end, size_t *offset);
+// Sends the requests of a window to the worker under a single lock
+static void submit_pipe_window(DBApiPipeWindow *window);
+// Awaits the replies of a window, encoding them into `output` unless it is NULL, and empties it; returns the number of errors
+static db_uint_t finish_pipe_window(DBApiPipeWindow *window, DBRespBuffer *output, db_uint8_t protocol);
+
+// Most arguments of a request built on the stack
+#define DBAPI_STACK_ARGS 4
+
+// Request of an allocation-free call with everything the worker needs, built on the stack of the caller
+typedef struct DBApiStackRequest
+{
+  DBRequest request;
+  DBReply reply;
+  DBTask task;
+  DBList args;
+  DBListNode nodes[DBAPI_STACK_ARGS];
+  DBObj objs[DBAPI_STACK_ARGS];
+} DBApiStackRequest;
+
+static void init_stack_request(DBApiStackRequest *stack, db_action_t action);
+// Appends an argument to a stack request and returns its object, to be initialized with `dbobj_init_static_*`
+static DBObj *push_stack_arg(DBApiStackRequest *stack);
+// Sends a stack request to the worker and awaits it; returns its reply, or NULL if the database is closed
+static DBReply *run_stack_request(DBApiStackRequest *stack);
+// Frees what the worker put in the reply and the arena of a stack request
+static void finish_stack_request(DBApiStackRequest *stack);
+// Copies the string of a reply into `buffer`, see `dbapi_get_into`
+static db_int_t copy_reply_string(DBReply *reply, char *buffer, db_uint_t capacity);
 
 static db_bool_t reply_is_error(const DBReply *reply);
 
+// Adds the strings of a list as arguments of a request
+static void add_request_string_args(DBRequest *request, const DBList *strings);
+
 db_bool_t server_is_running()
 {
   core_lock();
@@ -37,6 +158,13 @@ void server_config_persistence_filepath(const char *persistence_filepath)
   core_unlock();
 }
 
+void server_config_list_node_size(db_uint_t list_node_size)
+{
+  core_lock();
+  db_config_list_node_size(list_node_size);
+  core_unlock();
+}
+
 void dbapi_start_server()
 {
   core_lock();
@@ -60,7 +188,7 @@ void dbapi_start_terminal_client()
     command_buffer = input_string();
     if (!command_buffer)
       continue;
-    request = parse_command(command_buffer);
+    request = parse_command(command_buffer, strlen(command_buffer));
     free_reply(print_reply(dbapi_request_sync(request)));
     free_request(request);
     free(command_buffer);
@@ -71,11 +199,205 @@ void dbapi_start_terminal_client()
 
 void dbapi_run_command(const char *command)
 {
-  DBRequest *request = parse_command(command);
+  if (!command)
+    return;
+  DBRequest *request = parse_command(command, strlen(command));
   free_reply(dbapi_request_sync(request));
   free_request(request);
 }
 
+db_double_t dbapi_bench_parse(const char *command, db_uint_t iterations)
+{
+  struct timespec start, end;
+  timespec_get(&start, TIME_UTC);
+  size_t length = strlen(command);
+  for (db_uint_t i = 0; i < iterations; ++i)
+    free_request(parse_command(command, length));
+  timespec_get(&end, TIME_UTC);
+
+  db_double_t seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / (db_double_t)NANOSECONDS_PER_SECOND;
+  return seconds > 0 ? iterations / seconds : 0;
+}
+
+char *dbapi_run_resp(const char *input, size_t length, db_uint8_t protocol, size_t *output_length)
+{
+  DBApiPipeWindow windows[2];
+  DBRespBuffer output;
+  db_resp_status_t status;
+  size_t offset = 0;
+  db_uint_t current = 0;
+
+  resp_buffer_init(&output);
+  windows[0].count = windows[1].count = 0;
+
+  // the next window is decoded while the worker runs the previous one
+  do
+  {
+    status = fill_pipe_window(&windows[current], input, length, true, &offset);
+    submit_pipe_window(&windows[current]);
+    finish_pipe_window(&windows[current ^ 1], &output, protocol);
+    current ^= 1;
+  } while (status == DB_RESP_OK);
+  finish_pipe_window(&windows[current ^ 1], &output, protocol);
+
+  // a command cut short by the end of the input is not valid either
+  if (status == DB_RESP_PROTOCOL_ERROR || offset < length)
+  {
+    DBObj *error = dbobj_create_error(dbutil_strdup(DB_ERR_PROTOCOL_ERROR));
+    resp_encode_reply(&output, error, protocol);
+    free_dbobj(error);
+  }
+
+  return resp_buffer_take(&output, output_length);
+}
+
+db_bool_t dbapi_pipe(FILE *input, DBPipeStats *stats)
+{
+  DBApiPipeWindow windows[2];
+  DBPipeStats counters = {0};
+  db_resp_status_t status;
+  size_t capacity = DBAPI_PIPE_READ_SIZE, length = 0, offset = 0;
+  db_uint_t current = 0;
+  db_bool_t at_end = false;
+  struct timespec start, end;
+
+  char *buffer = (char *)malloc(capacity);
+  if (!buffer)
+    EXIT_ON_MEMORY_ERROR();
+  windows[0].count = windows[1].count = 0;
+  timespec_get(&start, TIME_UTC);
+
+  while (true)
+  {
+    status = fill_pipe_window(&windows[current], buffer, length, at_end, &offset);
+    if (status == DB_RESP_INCOMPLETE && !at_end)
+    {
+      // the partial command is kept, the buffer grows if it fills it alone
+      length -= offset;
+      memmove(buffer, buffer + offset, length);
+      offset = 0;
+      if (length == capacity)
+      {
+        capacity *= 2;
+        char *grown = (char *)realloc(buffer, capacity);
+        if (!grown)
+          EXIT_ON_MEMORY_ERROR();
+        buffer = grown;
+      }
+      size_t read = fread(buffer + length, 1, capacity - length, input);
+      length += read;
+      counters.bytes += read;
+      at_end = read == 0;
+      continue;
+    }
+
+    counters.commands += windows[current].count;
+    submit_pipe_window(&windows[current]);
+    counters.errors += finish_pipe_window(&windows[current ^ 1], NULL, 0);
+    current ^= 1;
+    if (status != DB_RESP_OK)
+      break;
+  }
+  counters.errors += finish_pipe_window(&windows[current ^ 1], NULL, 0);
+
+  timespec_get(&end, TIME_UTC);
+  counters.seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / (db_double_t)NANOSECONDS_PER_SECOND;
+  if (stats)
+    *stats = counters;
+  free(buffer);
+
+  return status != DB_RESP_PROTOCOL_ERROR && offset == length && !ferror(input);
+}
+
+void dbapi_begin_read()
+{
+  core_lock();
+}
+
+void dbapi_end_read()
+{
+  core_unlock();
+}
+
+const char *dbapi_get_view(const char *key, char *buffer)
+{
+  return db_view_string(key, buffer);
+}
+
+db_uint_t dbapi_lrange_view(const char *key, db_uint_t start, db_uint_t stop, const char **views, db_uint_t capacity)
+{
+  return db_view_list_range(key, start, stop, views, capacity);
+}
+
+db_int_t dbapi_get_into(const char *key, char *buffer, db_uint_t capacity)
+{
+  DBApiStackRequest stack;
+  init_stack_request(&stack, DB_GET);
+  dbobj_init_static_string(push_stack_arg(&stack), key);
+  db_int_t result = copy_reply_string(run_stack_request(&stack), buffer, capacity);
+  finish_stack_request(&stack);
+  return result;
+}
+
+db_int_t dbapi_hget_into(const char *key, const char *field, char *buffer, db_uint_t capacity)
+{
+  DBApiStackRequest stack;
+  init_stack_request(&stack, DB_HGET);
+  dbobj_init_static_string(push_stack_arg(&stack), key);
+  dbobj_init_static_string(push_stack_arg(&stack), field);
+  db_int_t result = copy_reply_string(run_stack_request(&stack), buffer, capacity);
+  finish_stack_request(&stack);
+  return result;
+}
+
+db_int_t dbapi_lindex_into(const char *key, db_int_t index, char *buffer, db_uint_t capacity)
+{
+  DBApiStackRequest stack;
+  init_stack_request(&stack, DB_LINDEX);
+  dbobj_init_static_string(push_stack_arg(&stack), key);
+  dbobj_init_static_int(push_stack_arg(&stack), index);
+  db_int_t result = copy_reply_string(run_stack_request(&stack), buffer, capacity);
+  finish_stack_request(&stack);
+  return result;
+}
+
+db_uint_t dbapi_lrange_cb(const char *key, db_uint_t start, db_uint_t stop, DBApiValueFunc callback, void *context)
+{
+  char number[DBOBJ_NUMBER_BUFFER_SIZE];
+  db_uint_t count = 0;
+  DBApiStackRequest stack;
+  init_stack_request(&stack, DB_LRANGE);
+  dbobj_init_static_string(push_stack_arg(&stack), key);
+  dbobj_init_static_uint(push_stack_arg(&stack), start);
+  dbobj_init_static_uint(push_stack_arg(&stack), stop);
+  DBReply *reply = run_stack_request(&stack);
+  if (reply && dbobj_is_list(reply->data))
+  {
+    for (DBListNode *node = reply->data->value.list->head; node; node = node->next, ++count)
+      callback(dbobj_string_view(node->data, number), context);
+  }
+  finish_stack_request(&stack);
+  return count;
+}
+
+db_uint_t dbapi_hgetall_cb(const char *key, DBApiFieldFunc callback, void *context)
+{
+  char field_number[DBOBJ_NUMBER_BUFFER_SIZE], value_number[DBOBJ_NUMBER_BUFFER_SIZE];
+  db_uint_t count = 0;
+  DBApiStackRequest stack;
+  init_stack_request(&stack, DB_HGETALL);
+  dbobj_init_static_string(push_stack_arg(&stack), key);
+  DBReply *reply = run_stack_request(&stack);
+  if (reply && dbobj_is_list(reply->data))
+  {
+    // the reply alternates fields and values
+    for (DBListNode *node = reply->data->value.list->head; node && node->next; node = node->next->next, ++count)
+      callback(dbobj_string_view(node->data, field_number), dbobj_string_view(node->next->data, value_number), context);
+  }
+  finish_stack_request(&stack);
+  return count;
+}
+
 DBReply *dbapi_request_async(DBRequest *request)
 {
   if (!request)
@@ -98,188 +420,235 @@ DBReply *dbapi_await_reply(DBReply *reply)
   if (!reply)
     return NULL;
 
-  while (true)
-  {
-    core_lock();
-    if (reply->done)
-    {
-      core_unlock();
-      break;
-    }
-    core_unlock();
-  }
+  core_await_reply(reply);
 
   return reply;
 };
 
-static DBRequest *parse_command(const char *command)
+static int compare_command_name(const void *name, const void *command)
 {
-  if (!command)
+  return strcasecmp((const char *)name, ((const DBCommandName *)command)->name);
+}
+
+// Slices the next token of the command in place and moves `*pos` past it; returns NULL at the end of the command
+// Quoted tokens are unescaped where they are, an unterminated quote runs to the end and is dropped
+static char *next_command_token(char **pos, size_t *length, db_bool_t *quoted)
+{
+  char *p = *pos, *token;
+
+  while (isspace((unsigned char)*p))
+    ++p;
+
+  if (*p == '"')
+  {
+    char *out = token = ++p;
+    while (*p != '\0' && *p != '"')
+    {
+      // Handle escape
+      if (*p == '\\' && *(p + 1) == '"')
+        ++p;
+      *out++ = *p++;
+    }
+    if (*p == '\0')
+    {
+      *pos = p;
+      return NULL;
+    }
+    *out = '\0';
+    *pos = p + 1;
+    *length = out - token;
+    *quoted = true;
+    return token;
+  }
+
+  if (*p == '\0')
+  {
+    *pos = p;
     return NULL;
+  }
 
-  DBRequest *request = (DBRequest *)calloc(1, sizeof(DBRequest));
-  if (!request)
-    EXIT_ON_MEMORY_ERROR();
+  token = p;
+  while (*p != '\0' && !isspace((unsigned char)*p))
+    ++p;
+  *length = p - token;
+  if (*p != '\0')
+    *p++ = '\0';
+  *pos = p;
+  *quoted = false;
+  return token;
+}
 
-  // Duplicate command for tokenization
-  char *command_copy = dbutil_strdup(command);
-  if (!command_copy)
-    EXIT_ON_MEMORY_ERROR();
+static db_action_t find_command(const char *name)
+{
+  const DBCommandName *command = name ? bsearch(name, command_names, sizeof(command_names) / sizeof(command_names[0]),
+                                                sizeof(command_names[0]), compare_command_name)
+                                      : NULL;
+  return command ? command->action : DB_UNKNOWN_COMMAND;
+}
 
-  char *token = strtok(command_copy, " ");
-
-  // Parse action string into db_action_t
-  to_uppercase(token);
-  if (!token)
-    request->action = DB_UNKNOWN_COMMAND;
-  if (strcmp(token, "SAVE") == 0)
-    request->action = DB_SAVE;
-  else if (strcmp(token, "START") == 0)
-    request->action = DB_START;
-  else if (strcmp(token, "SET") == 0)
-    request->action = DB_SET;
-  else if (strcmp(token, "GET") == 0)
-    request->action = DB_GET;
-  else if (strcmp(token, "RENAME") == 0)
-    request->action = DB_RENAME;
-  else if (strcmp(token, "DEL") == 0)
-    request->action = DB_DEL;
-  else if (strcmp(token, "LPUSH") == 0)
-    request->action = DB_LPUSH;
-  else if (strcmp(token, "LPOP") == 0)
-    request->action = DB_LPOP;
-  else if (strcmp(token, "RPUSH") == 0)
-    request->action = DB_RPUSH;
-  else if (strcmp(token, "RPOP") == 0)
-    request->action = DB_RPOP;
-  else if (strcmp(token, "LLEN") == 0)
-    request->action = DB_LLEN;
-  else if (strcmp(token, "LRANGE") == 0)
-    request->action = DB_LRANGE;
-  else if (strcmp(token, "HGET") == 0)
-    request->action = DB_HGET;
-  else if (strcmp(token, "HSET") == 0)
-    request->action = DB_HSET;
-  else if (strcmp(token, "HINCRBY") == 0)
-    request->action = DB_HINCRBY;
-  else if (strcmp(token, "HDEL") == 0)
-    request->action = DB_HDEL;
-  else if (strcmp(token, "EXPIRE") == 0)
-    request->action = DB_EXPIRE;
-  else if (strcmp(token, "ZSCORE") == 0)
-    request->action = DB_ZSCORE;
-  else if (strcmp(token, "ZADD") == 0)
-    request->action = DB_ZADD;
-  else if (strcmp(token, "ZCARD") == 0)
-    request->action = DB_ZCARD;
-  else if (strcmp(token, "ZCOUNT") == 0)
-    request->action = DB_ZCOUNT;
-  else if (strcmp(token, "ZINTERSTORE") == 0)
-    request->action = DB_ZINTERSTORE;
-  else if (strcmp(token, "ZUNIONSTORE") == 0)
-    request->action = DB_ZUNIONSTORE;
-  else if (strcmp(token, "ZRANGE") == 0)
-    request->action = DB_ZRANGE;
-  else if (strcmp(token, "ZRANGEBYSCORE") == 0)
-    request->action = DB_ZRANGEBYSCORE;
-  else if (strcmp(token, "ZRANK") == 0)
-    request->action = DB_ZRANK;
-  else if (strcmp(token, "ZREM") == 0)
-    request->action = DB_ZREM;
-  else if (strcmp(token, "ZREMRANGEBYSCORE") == 0)
-    request->action = DB_ZREMRANGEBYSCORE;
-  else if (strcmp(token, "KEYS") == 0)
-    request->action = DB_KEYS;
-  else if (strcmp(token, "FLUSHALL") == 0)
-    request->action = DB_FLUSHALL;
-  else if (strcmp(token, "INFO_DATASET_MEMORY") == 0)
-    request->action = DB_INFO_DATASET_MEMORY;
-  else if (strcmp(token, "SHUTDOWN") == 0)
-    request->action = DB_SHUTDOWN;
-  else
-    request->action = DB_UNKNOWN_COMMAND;
+static DBRequest *parse_command(const char *command, size_t length)
+{
+  DBRequest *request = create_request(DB_UNKNOWN_COMMAND);
+
+  // The command is copied into the arena of the request once, then its tokens are sliced in place
+  char *pos = arena_strndup(&request->arena, command, length);
+  db_bool_t quoted;
+  char *token = next_command_token(&pos, &length, &quoted);
 
-  // Move past action in original command string
-  const char *pos = command + strlen(token);
+  request->action = find_command(token);
 
-  while (*pos != '\0')
+  // Unquoted numbers are parsed here once, quoted tokens always stay strings
+  while ((token = next_command_token(&pos, &length, &quoted)))
   {
-    // Skip extra whitespace
-    while (isspace(*pos))
-      ++pos;
+    DBObj *arg = quoted ? NULL : dbobj_create_arena_number(&request->arena, token, length);
+    add_request_arg(request, arg ? arg : dbobj_create_arena_string(token));
+  }
 
-    if (*pos == '\0')
-      break;
+  return request;
+}
+
+// Decodes the next command of a pipe, a RESP array or an inline line; `*request` is NULL for a blank line
+// At the end of the input, the last inline command does not need a line break
+static db_resp_status_t decode_pipe_command(const char *data, size_t length, db_bool_t at_end, size_t *consumed, DBRequest **request)
+{
+  *request = NULL;
+  if (!length)
+    return DB_RESP_INCOMPLETE;
 
-    if (*pos == '"')
+  if (*data == '*')
+  {
+    const char *name;
+    DBRequest *command = create_request(DB_UNKNOWN_COMMAND);
+    db_resp_status_t status = resp_decode_command(data, length, consumed, command, &name);
+    // empty arrays are skipped like blank lines
+    if (status != DB_RESP_OK || !name)
     {
-      // Parse quoted string
-      ++pos;
-      const char *start = pos;
-      size_t length = 0;
-      char *string_value = NULL;
-
-      // Continue until end of string or until reaching an unescaped quote
-      while (*pos != '\0' && (*pos != '"' || (*(pos - 1) == '\\' && pos != start)))
-      {
-        // Handle escape
-        if (*pos == '\\' && *(pos + 1) == '"')
-          ++pos;
-        ++pos;
-        ++length;
-      }
+      free_request(command);
+      return status;
+    }
+    command->action = find_command(name);
+    *request = command;
+    return DB_RESP_OK;
+  }
 
-      if (*pos == '"')
-      {
-        string_value = (char *)malloc(length + 1);
-        if (!string_value)
-          EXIT_ON_MEMORY_ERROR();
+  const char *line_end = (const char *)memchr(data, '\n', length);
+  if (!line_end && !at_end)
+    return DB_RESP_INCOMPLETE;
+  size_t line_length = line_end ? (size_t)(line_end - data) : length;
+  *consumed = line_end ? line_length + 1 : length;
+  if (line_length && data[line_length - 1] == '\r')
+    --line_length;
 
-        // Remove escape sequences
-        size_t i = 0;
-        const char *src = start;
-        while (src < pos)
-        {
-          if (*src == '\\' && *(src + 1) == '"')
-          {
-            string_value[i++] = '"';
-            src += 2;
-          }
-          else
-          {
-            string_value[i++] = *src++;
-          }
-        }
-        string_value[i] = '\0';
-        ++pos;
-
-        add_request_arg(request, dbobj_create_string_with_dup(string_value));
-        free(string_value);
-      }
-    }
-    else
+  for (size_t i = 0; i < line_length; ++i)
+    if (!isspace((unsigned char)data[i]))
     {
-      // Parse signed or unsigned integer, or treat as a string
-      char *endptr = NULL;
-      const char *start = pos;
-      while (*pos != '\0' && !isspace(*pos))
-        ++pos;
-      size_t length = pos - start;
-
-      char *string_value = (char *)malloc(length + 1);
-      if (!string_value)
-        EXIT_ON_MEMORY_ERROR();
-
-      strncpy(string_value, start, length);
-      string_value[length] = '\0';
-
-      add_request_arg(request, dbobj_create_string_with_dup(string_value));
-      free(string_value);
+      *request = parse_command(data, line_length);
+      break;
     }
+  return DB_RESP_OK;
+}
+
+static db_resp_status_t fill_pipe_window(DBApiPipeWindow *window, const char *data, size_t length, db_bool_t at_end, size_t *offset)
+{
+  size_t consumed;
+  DBRequest *request;
+
+  while (window->count < DBAPI_PIPE_WINDOW)
+  {
+    db_resp_status_t status = decode_pipe_command(data + *offset, length - *offset, at_end, &consumed, &request);
+    if (status != DB_RESP_OK)
+      return status;
+    *offset += consumed;
+    if (request)
+      window->requests[window->count++] = request;
   }
+  return DB_RESP_OK;
+}
 
-  free(command_copy);
-  return request;
+static void submit_pipe_window(DBApiPipeWindow *window)
+{
+  core_lock();
+  for (db_uint_t i = 0; i < window->count; ++i)
+    window->replies[i] = db_handle_request(window->requests[i]);
+  core_unlock();
+}
+
+static db_uint_t finish_pipe_window(DBApiPipeWindow *window, DBRespBuffer *output, db_uint8_t protocol)
+{
+  db_uint_t errors = 0;
+
+  for (db_uint_t i = 0; i < window->count; ++i)
+  {
+    DBReply *reply = dbapi_await_reply(window->replies[i]);
+    if (reply_is_error(reply))
+      ++errors;
+    if (output)
+      resp_encode_reply(output, reply->data, protocol);
+    free_reply(reply);
+    free_request(window->requests[i]);
+  }
+  window->count = 0;
+
+  return errors;
+}
+
+static void init_stack_request(DBApiStackRequest *stack, db_action_t action)
+{
+  stack->request.action = action;
+  stack->request.args = &stack->args;
+  stack->request.arena.chunks = NULL;
+  stack->reply.done = false;
+  stack->reply.data = NULL;
+  stack->args.head = NULL;
+  stack->args.tail = NULL;
+  stack->args.length = 0;
+}
+
+static DBObj *push_stack_arg(DBApiStackRequest *stack)
+{
+  DBListNode *node = &stack->nodes[stack->args.length];
+  node->data = &stack->objs[stack->args.length];
+  node->prev = stack->args.tail;
+  node->next = NULL;
+  if (stack->args.tail)
+    stack->args.tail->next = node;
+  else
+    stack->args.head = node;
+  stack->args.tail = node;
+  stack->args.length++;
+  return node->data;
+}
+
+static DBReply *run_stack_request(DBApiStackRequest *stack)
+{
+  core_lock();
+  db_bool_t queued = db_queue_request(&stack->request, &stack->reply, &stack->task);
+  core_unlock();
+  return queued ? dbapi_await_reply(&stack->reply) : NULL;
+}
+
+static void finish_stack_request(DBApiStackRequest *stack)
+{
+  free_dbobj(stack->reply.data);
+  stack->reply.data = NULL;
+  arena_release(&stack->request.arena);
+}
+
+static db_int_t copy_reply_string(DBReply *reply, char *buffer, db_uint_t capacity)
+{
+  char number[DBOBJ_NUMBER_BUFFER_SIZE];
+  const char *value = reply ? dbobj_string_view(reply->data, number) : NULL;
+  if (!value)
+    return -1;
+
+  size_t length = strlen(value);
+  if (capacity)
+  {
+    size_t copied = length < capacity ? length : capacity - 1;
+    memcpy(buffer, value, copied);
+    buffer[copied] = '\0';
+  }
+  return (db_int_t)length;
 }
 
 static db_bool_t reply_is_error(const DBReply *reply)
@@ -287,19 +656,30 @@ static db_bool_t reply_is_error(const DBReply *reply)
   return reply && reply->data && reply->data->type == DB_TYPE_ERROR;
 }
 
+static void add_request_string_args(DBRequest *request, const DBList *strings)
+{
+  DBListNode *node = strings ? strings->head : NULL;
+  while (node)
+  {
+    if (dbobj_is_string(node->data))
+      add_request_string_arg(request, node->data->value.string);
+    node = node->next;
+  }
+}
+
 char *dbapi_get(const char *key)
 {
   DBRequest *request = create_request(DB_GET);
-  add_request_arg(request, dbobj_create_string_with_dup(key));
+  add_request_string_arg(request, key);
   DBReply *reply = dbapi_request_sync(request);
   free_request(request);
-  if (reply_is_error(reply))
+  if (reply_is_error(reply) || !dbobj_is_string(reply->data))
   {
     free_reply(reply);
     return NULL;
   }
-  char *result = reply->data->value.string;
-  reply->data->value.string = NULL;
+  char *result = dbobj_extract_string(reply->data);
+  reply->data = NULL;
   free_reply(reply);
   return result;
 }
@@ -307,8 +687,8 @@ char *dbapi_get(const char *key)
 db_bool_t dbapi_set(const char *key, const char *value)
 {
   DBRequest *request = create_request(DB_SET);
-  add_request_arg(request, dbobj_create_string_with_dup(key));
-  add_request_arg(request, dbobj_create_string_with_dup(value));
+  add_request_moved_string_arg(request, key);
+  add_request_moved_string_arg(request, value);
   DBReply *reply = dbapi_request_sync(request);
   free_request(request);
   if (reply_is_error(reply))
@@ -321,27 +701,104 @@ db_bool_t dbapi_set(const char *key, const char *value)
   return result;
 }
 
-db_uint_t dbapi_del(const char *key)
+DBList *dbapi_mget(const DBList *keys)
 {
-  DBRequest *request = create_request(DB_DEL);
-  add_request_arg(request, dbobj_create_string_with_dup(key));
+  DBRequest *request = create_request(DB_MGET);
+  add_request_string_args(request, keys);
   DBReply *reply = dbapi_request_sync(request);
   free_request(request);
-  if (reply_is_error(reply))
+  if (reply_is_error(reply) || !dbobj_is_list(reply->data))
   {
     free_reply(reply);
-    return false;
+    return NULL;
   }
-  db_uint_t result = reply->data->value.uint_value;
+  DBList *result = reply->data->value.list;
+  reply->data->value.list = NULL;
+  free_reply(reply);
+  return result;
+}
+
+db_bool_t dbapi_mset_n(const char *key, ...)
+{
+  DBRequest *request = create_request(DB_MSET);
+  va_list args;
+  va_start(args, key);
+  const char *arg = key;
+  while (arg)
+  {
+    add_request_moved_string_arg(request, arg);
+    arg = va_arg(args, const char *);
+  }
+  va_end(args);
+  DBReply *reply = dbapi_request_sync(request);
+  free_request(request);
+  db_bool_t result = !reply_is_error(reply);
   free_reply(reply);
   return result;
 }
 
+db_int_t dbapi_incr(const char *key)
+{
+  DBApiStackRequest stack;
+  init_stack_request(&stack, DB_INCR);
+  dbobj_init_static_string(push_stack_arg(&stack), key);
+  DBReply *reply = run_stack_request(&stack);
+  db_int_t result = reply && !reply_is_error(reply) ? reply->data->value.int_value : 0;
+  finish_stack_request(&stack);
+  return result;
+}
+
+db_int_t dbapi_incrby(const char *key, db_int_t value)
+{
+  DBApiStackRequest stack;
+  init_stack_request(&stack, DB_INCRBY);
+  dbobj_init_static_string(push_stack_arg(&stack), key);
+  dbobj_init_static_int(push_stack_arg(&stack), value);
+  DBReply *reply = run_stack_request(&stack);
+  db_int_t result = reply && !reply_is_error(reply) ? reply->data->value.int_value : 0;
+  finish_stack_request(&stack);
+  return result;
+}
+
+db_int_t dbapi_decr(const char *key)
+{
+  DBApiStackRequest stack;
+  init_stack_request(&stack, DB_DECR);
+  dbobj_init_static_string(push_stack_arg(&stack), key);
+  DBReply *reply = run_stack_request(&stack);
+  db_int_t result = reply && !reply_is_error(reply) ? reply->data->value.int_value : 0;
+  finish_stack_request(&stack);
+  return result;
+}
+
+db_int_t dbapi_decrby(const char *key, db_int_t value)
+{
+  DBApiStackRequest stack;
+  init_stack_request(&stack, DB_DECRBY);
+  dbobj_init_static_string(push_stack_arg(&stack), key);
+  dbobj_init_static_int(push_stack_arg(&stack), value);
+  DBReply *reply = run_stack_request(&stack);
+  db_int_t result = reply && !reply_is_error(reply) ? reply->data->value.int_value : 0;
+  finish_stack_request(&stack);
+  return result;
+}
+
+db_uint_t dbapi_del(const char *key)
+{
+  DBApiStackRequest stack;
+  init_stack_request(&stack, DB_DEL);
+  dbobj_init_static_string(push_stack_arg(&stack), key);
+  DBReply *reply = run_stack_request(&stack);
+  db_uint_t result = reply && !reply_is_error(reply) ? reply->data->value.uint_value : 0;
+  finish_stack_request(&stack);
+  return result;
+}
+
 db_bool_t dbapi_rename(const char *old_key, const char *new_key)
 {
   DBRequest *request = create_request(DB_RENAME);
-  add_request_arg(request, dbobj_create_string_with_dup(old_key));
-  add_request_arg(request, dbobj_create_string_with_dup(new_key));
+  add_request_string_arg(request, old_key);
+  add_request_string_arg(request, new_key);
   DBReply *reply = dbapi_request_sync(request);
   free_request(request);
   if (reply_is_error(reply))
@@ -357,8 +814,8 @@ db_bool_t dbapi_rename(const char *old_key, const char *new_key)
 db_uint_t dbapi_lpush(const char *key, const char *value)
 {
   DBRequest *request = create_request(DB_LPUSH);
-  add_request_arg(request, dbobj_create_string_with_dup(key));
-  add_request_arg(request, dbobj_create_string_with_dup(value));
+  add_request_string_arg(request, key);
+  add_request_string_arg(request, value);
   DBReply *reply = dbapi_request_sync(request);
   free_request(request);
   if (reply_is_error(reply))
@@ -376,13 +833,13 @@ db_uint_t dbapi_lpush_n(const char *key, ...)
   DBRequest *request = create_request(DB_LPUSH);
   va_list args;
   va_start(args, key);
-  add_request_arg(request, dbobj_create_string_with_dup(key));
+  add_request_string_arg(request, key);
   while (true)
   {
     const char *value = va_arg(args, const char *);
     if (value == NULL)
       break;
-    add_request_arg(request, dbobj_create_string_with_dup(value));
+    add_request_string_arg(request, value);
   }
   va_end(args);
   DBReply *reply = dbapi_request_sync(request);
@@ -400,25 +857,56 @@ db_uint_t dbapi_lpush_n(const char *key, ...)
 char *dbapi_lpop(const char *key)
 {
   DBRequest *request = create_request(DB_LPOP);
-  add_request_arg(request, dbobj_create_string_with_dup(key));
+  add_request_string_arg(request, key);
   DBReply *reply = dbapi_request_sync(request);
   free_request(request);
-  if (reply_is_error(reply))
+  if (reply_is_error(reply) || !dbobj_is_string(reply->data))
+  {
+    free_reply(reply);
+    return NULL;
+  }
+  char *result = dbobj_extract_string(reply->data);
+  reply->data = NULL;
+  free_reply(reply);
+  return result;
+}
+
+// Shared by `dbapi_blpop` and `dbapi_brpop`, returns the element of the reply
+static char *dbapi_blocking_pop(db_action_t action, const char *key, db_double_t timeout)
+{
+  DBRequest *request = create_request(action);
+  add_request_string_arg(request, key);
+  add_request_arg(request, dbobj_create_double(timeout));
+  DBReply *reply = dbapi_request_sync(request);
+  free_request(request);
+  if (reply_is_error(reply) || !dbobj_is_list(reply->data) || !reply->data->value.list->tail)
   {
     free_reply(reply);
     return NULL;
   }
-  char *result = reply->data->value.string;
-  reply->data->value.string = NULL;
+  DBObj *value = reply->data->value.list->tail->data;
+  char *result = dbobj_is_string(value) ? value->value.string : NULL;
+  if (result)
+    value->value.string = NULL;
   free_reply(reply);
   return result;
 }
 
+char *dbapi_blpop(const char *key, db_double_t timeout)
+{
+  return dbapi_blocking_pop(DB_BLPOP, key, timeout);
+}
+
+char *dbapi_brpop(const char *key, db_double_t timeout)
+{
+  return dbapi_blocking_pop(DB_BRPOP, key, timeout);
+}
+
 db_uint_t dbapi_rpush(const char *key, const char *value)
 {
   DBRequest *request = create_request(DB_RPUSH);
-  add_request_arg(request, dbobj_create_string_with_dup(key));
-  add_request_arg(request, dbobj_create_string_with_dup(value));
+  add_request_string_arg(request, key);
+  add_request_string_arg(request, value);
   DBReply *reply = dbapi_request_sync(request);
   free_request(request);
   if (reply_is_error(reply))
@@ -436,13 +924,13 @@ db_uint_t dbapi_rpush_n(const char *key, ...)
   DBRequest *request = create_request(DB_RPUSH);
   va_list args;
   va_start(args, key);
-  add_request_arg(request, dbobj_create_string_with_dup(key));
+  add_request_string_arg(request, key);
   while (true)
   {
     const char *value = va_arg(args, const char *);
     if (value == NULL)
       break;
-    add_request_arg(request, dbobj_create_string_with_dup(value));
+    add_request_string_arg(request, value);
   }
   va_end(args);
   DBReply *reply = dbapi_request_sync(request);
@@ -460,40 +948,35 @@ db_uint_t dbapi_rpush_n(const char *key, ...)
 char *dbapi_rpop(const char *key)
 {
   DBRequest *request = create_request(DB_RPOP);
-  add_request_arg(request, dbobj_create_string_with_dup(key));
+  add_request_string_arg(request, key);
   DBReply *reply = dbapi_request_sync(request);
   free_request(request);
-  if (reply_is_error(reply))
+  if (reply_is_error(reply) || !dbobj_is_string(reply->data))
   {
     free_reply(reply);
     return NULL;
   }
-  char *result = reply->data->value.string;
-  reply->data->value.string = NULL;
+  char *result = dbobj_extract_string(reply->data);
+  reply->data = NULL;
   free_reply(reply);
   return result;
 }
 
 db_uint_t dbapi_llen(const char *key)
 {
-  DBRequest *request = create_request(DB_LLEN);
-  add_request_arg(request, dbobj_create_string_with_dup(key));
-  DBReply *reply = dbapi_request_sync(request);
-  free_request(request);
-  if (reply_is_error(reply))
-  {
-    free_reply(reply);
-    return 0;
-  }
-  db_uint_t result = reply->data->value.uint_value;
-  free_reply(reply);
+  DBApiStackRequest stack;
+  init_stack_request(&stack, DB_LLEN);
+  dbobj_init_static_string(push_stack_arg(&stack), key);
+  DBReply *reply = run_stack_request(&stack);
+  db_uint_t result = reply && !reply_is_error(reply) ? reply->data->value.uint_value : 0;
+  finish_stack_request(&stack);
   return result;
 }
 
 DBList *dbapi_lrange(const char *key, const db_uint_t start, const db_uint_t end)
 {
   DBRequest *request = create_request(DB_LRANGE);
-  add_request_arg(request, dbobj_create_string_with_dup(key));
+  add_request_string_arg(request, key);
   add_request_arg(request, dbobj_create_uint(start));
   add_request_arg(request, dbobj_create_uint(end));
   DBReply *reply = dbapi_request_sync(request);
@@ -509,30 +992,161 @@ DBList *dbapi_lrange(const char *key, const db_uint_t start, const db_uint_t end
   return result;
 }
 
-char *dbapi_hget(const char *key, const char *field)
+DBList *dbapi_mlrange(const DBList *keys, const db_uint_t start, const db_uint_t end)
 {
-  DBRequest *request = create_request(DB_HGET);
-  add_request_arg(request, dbobj_create_string_with_dup(key));
-  add_request_arg(request, dbobj_create_string_with_dup(field));
+  DBRequest *request = create_request(DB_MLRANGE);
+  add_request_arg(request, dbobj_create_uint(start));
+  add_request_arg(request, dbobj_create_uint(end));
+  add_request_string_args(request, keys);
   DBReply *reply = dbapi_request_sync(request);
   free_request(request);
-  if (reply_is_error(reply))
+  if (reply_is_error(reply) || !dbobj_is_list(reply->data))
   {
     free_reply(reply);
     return NULL;
   }
-  char *result = reply->data->value.string;
-  reply->data->value.string = NULL;
+  DBList *result = reply->data->value.list;
+  reply->data->value.list = NULL;
   free_reply(reply);
   return result;
 }
 
-db_uint_t dbapi_hset(const char *key, const char *field, const char *value)
+char *dbapi_lindex(const char *key, db_int_t index)
 {
-  DBRequest *request = create_request(DB_HSET);
-  add_request_arg(request, dbobj_create_string_with_dup(key));
-  add_request_arg(request, dbobj_create_string_with_dup(field));
-  add_request_arg(request, dbobj_create_string_with_dup(value));
+  DBRequest *request = create_request(DB_LINDEX);
+  add_request_string_arg(request, key);
+  add_request_arg(request, dbobj_create_int(index));
+  DBReply *reply = dbapi_request_sync(request);
+  free_request(request);
+  if (reply_is_error(reply) || !dbobj_is_string(reply->data))
+  {
+    free_reply(reply);
+    return NULL;
+  }
+  char *result = dbobj_extract_string(reply->data);
+  reply->data = NULL;
+  free_reply(reply);
+  return result;
+}
+
+db_bool_t dbapi_lset(const char *key, db_int_t index, const char *value)
+{
+  DBRequest *request = create_request(DB_LSET);
+  add_request_string_arg(request, key);
+  add_request_arg(request, dbobj_create_int(index));
+  add_request_string_arg(request, value);
+  DBReply *reply = dbapi_request_sync(request);
+  free_request(request);
+  if (reply_is_error(reply))
+  {
+    free_reply(reply);
+    return false;
+  }
+  db_bool_t result = dbobj_is_string(reply->data) && strcmp(reply->data->value.string, OK) == 0;
+  free_reply(reply);
+  return result;
+}
+
+db_bool_t dbapi_ltrim(const char *key, db_int_t start, db_int_t stop)
+{
+  DBRequest *request = create_request(DB_LTRIM);
+  add_request_string_arg(request, key);
+  add_request_arg(request, dbobj_create_int(start));
+  add_request_arg(request, dbobj_create_int(stop));
+  DBReply *reply = dbapi_request_sync(request);
+  free_request(request);
+  if (reply_is_error(reply))
+  {
+    free_reply(reply);
+    return false;
+  }
+  db_bool_t result = dbobj_is_string(reply->data) && strcmp(reply->data->value.string, OK) == 0;
+  free_reply(reply);
+  return result;
+}
+
+db_int_t dbapi_linsert(const char *key, db_bool_t after, const char *pivot, const char *value)
+{
+  DBRequest *request = create_request(DB_LINSERT);
+  add_request_string_arg(request, key);
+  add_request_string_arg(request, after ? "AFTER" : "BEFORE");
+  add_request_string_arg(request, pivot);
+  add_request_string_arg(request, value);
+  DBReply *reply = dbapi_request_sync(request);
+  free_request(request);
+  if (reply_is_error(reply) || !dbobj_is_int(reply->data))
+  {
+    free_reply(reply);
+    return -1;
+  }
+  db_int_t result = reply->data->value.int_value;
+  free_reply(reply);
+  return result;
+}
+
+db_uint_t dbapi_lrem(const char *key, db_int_t count, const char *value)
+{
+  DBRequest *request = create_request(DB_LREM);
+  add_request_string_arg(request, key);
+  add_request_arg(request, dbobj_create_int(count));
+  add_request_string_arg(request, value);
+  DBReply *reply = dbapi_request_sync(request);
+  free_request(request);
+  if (reply_is_error(reply))
+  {
+    free_reply(reply);
+    return 0;
+  }
+  db_uint_t result = reply->data->value.uint_value;
+  free_reply(reply);
+  return result;
+}
+
+db_int_t dbapi_lpos(const char *key, const char *value)
+{
+  DBRequest *request = create_request(DB_LPOS);
+  add_request_string_arg(request, key);
+  add_request_string_arg(request, value);
+  DBReply *reply = dbapi_request_sync(request);
+  free_request(request);
+  if (reply_is_error(reply) || !dbobj_is_uint(reply->data))
+  {
+    free_reply(reply);
+    return -1;
+  }
+  db_int_t result = (db_int_t)reply->data->value.uint_value;
+  free_reply(reply);
+  return result;
+}
+
+char *dbapi_hget(const char *key, const char *field)
+{
+  DBRequest *request = create_request(DB_HGET);
+  add_request_string_arg(request, key);
+  add_request_string_arg(request, field);
+  DBReply *reply = dbapi_request_sync(request);
+  free_request(request);
+  if (reply_is_error(reply) || !dbobj_is_string(reply->data))
+  {
+    free_reply(reply);
+    return NULL;
+  }
+  char *result = dbobj_extract_string(reply->data);
+  reply->data = NULL;
+  free_reply(reply);
+  return result;
+}
+
+db_uint_t dbapi_hset(const char *key, const char *field, const char *value)
+{
+  DBRequest *request = create_request(DB_HSET);
+  add_request_string_arg(request, key);
+  add_request_string_arg(request, field);
+  // values this long always end up in a hash table, which can take the argument as is
+  if (value && strlen(value) > HASH_MAX_LISTPACK_VALUE)
+    add_request_moved_string_arg(request, value);
+  else
+    add_request_string_arg(request, value);
   DBReply *reply = dbapi_request_sync(request);
   free_request(request);
   if (reply_is_error(reply))
@@ -545,11 +1159,46 @@ db_uint_t dbapi_hset(const char *key, const char *field, const char *value)
   return result;
 }
 
+DBList *dbapi_hmget(const char *key, const DBList *fields)
+{
+  DBRequest *request = create_request(DB_HMGET);
+  add_request_string_arg(request, key);
+  add_request_string_args(request, fields);
+  DBReply *reply = dbapi_request_sync(request);
+  free_request(request);
+  if (reply_is_error(reply) || !dbobj_is_list(reply->data))
+  {
+    free_reply(reply);
+    return NULL;
+  }
+  DBList *result = reply->data->value.list;
+  reply->data->value.list = NULL;
+  free_reply(reply);
+  return result;
+}
+
+DBList *dbapi_hgetall(const char *key)
+{
+  DBRequest *request = create_request(DB_HGETALL);
+  add_request_string_arg(request, key);
+  DBReply *reply = dbapi_request_sync(request);
+  free_request(request);
+  if (reply_is_error(reply) || !dbobj_is_list(reply->data))
+  {
+    free_reply(reply);
+    return NULL;
+  }
+  DBList *result = reply->data->value.list;
+  reply->data->value.list = NULL;
+  free_reply(reply);
+  return result;
+}
+
 db_uint_t dbapi_hdel(const char *key, const char *field)
 {
   DBRequest *request = create_request(DB_HDEL);
-  add_request_arg(request, dbobj_create_string_with_dup(key));
-  add_request_arg(request, dbobj_create_string_with_dup(field));
+  add_request_string_arg(request, key);
+  add_request_string_arg(request, field);
   DBReply *reply = dbapi_request_sync(request);
   free_request(request);
   if (reply_is_error(reply))
@@ -565,8 +1214,8 @@ db_uint_t dbapi_hdel(const char *key, const char *field)
 db_int_t dbapi_hincrby(const char *key, const char *field, db_int_t value)
 {
   DBRequest *request = create_request(DB_HINCRBY);
-  add_request_arg(request, dbobj_create_string_with_dup(key));
-  add_request_arg(request, dbobj_create_string_with_dup(field));
+  add_request_string_arg(request, key);
+  add_request_string_arg(request, field);
   add_request_arg(request, dbobj_create_int(value));
   DBReply *reply = dbapi_request_sync(request);
   free_request(request);
@@ -580,6 +1229,209 @@ db_int_t dbapi_hincrby(const char *key, const char *field, db_int_t value)
   return result;
 }
 
+db_double_t dbapi_hincrbyfloat(const char *key, const char *field, db_double_t value)
+{
+  DBRequest *request = create_request(DB_HINCRBYFLOAT);
+  add_request_string_arg(request, key);
+  add_request_string_arg(request, field);
+  add_request_arg(request, dbobj_create_double(value));
+  DBReply *reply = dbapi_request_sync(request);
+  free_request(request);
+  if (reply_is_error(reply))
+  {
+    free_reply(reply);
+    return 0;
+  }
+  db_double_t result = reply->data->value.double_value;
+  free_reply(reply);
+  return result;
+}
+
+db_bool_t dbapi_expire(const char *key, db_uint_t seconds)
+{
+  DBApiStackRequest stack;
+  init_stack_request(&stack, DB_EXPIRE);
+  dbobj_init_static_string(push_stack_arg(&stack), key);
+  dbobj_init_static_uint(push_stack_arg(&stack), seconds);
+  DBReply *reply = run_stack_request(&stack);
+  db_bool_t result = reply && !reply_is_error(reply) ? reply->data->value.int_value == 1 : false;
+  finish_stack_request(&stack);
+  return result;
+}
+
+db_bool_t dbapi_pexpire(const char *key, db_uint_t milliseconds)
+{
+  DBApiStackRequest stack;
+  init_stack_request(&stack, DB_PEXPIRE);
+  dbobj_init_static_string(push_stack_arg(&stack), key);
+  dbobj_init_static_uint(push_stack_arg(&stack), milliseconds);
+  DBReply *reply = run_stack_request(&stack);
+  db_bool_t result = reply && !reply_is_error(reply) ? reply->data->value.int_value == 1 : false;
+  finish_stack_request(&stack);
+  return result;
+}
+
+db_int_t dbapi_ttl(const char *key)
+{
+  DBApiStackRequest stack;
+  init_stack_request(&stack, DB_TTL);
+  dbobj_init_static_string(push_stack_arg(&stack), key);
+  DBReply *reply = run_stack_request(&stack);
+  db_int_t result = reply && !reply_is_error(reply) ? reply->data->value.int_value : -2;
+  finish_stack_request(&stack);
+  return result;
+}
+
+db_int_t dbapi_pttl(const char *key)
+{
+  DBApiStackRequest stack;
+  init_stack_request(&stack, DB_PTTL);
+  dbobj_init_static_string(push_stack_arg(&stack), key);
+  DBReply *reply = run_stack_request(&stack);
+  db_int_t result = reply && !reply_is_error(reply) ? reply->data->value.int_value : -2;
+  finish_stack_request(&stack);
+  return result;
+}
+
+db_bool_t dbapi_persist(const char *key)
+{
+  DBApiStackRequest stack;
+  init_stack_request(&stack, DB_PERSIST);
+  dbobj_init_static_string(push_stack_arg(&stack), key);
+  DBReply *reply = run_stack_request(&stack);
+  db_bool_t result = reply && !reply_is_error(reply) ? reply->data->value.int_value == 1 : false;
+  finish_stack_request(&stack);
+  return result;
+}
+
+db_uint_t dbapi_zadd(const char *key, db_double_t score, const char *member)
+{
+  DBRequest *request = create_request(DB_ZADD);
+  add_request_string_arg(request, key);
+  add_request_arg(request, dbobj_create_double(score));
+  add_request_string_arg(request, member);
+  DBReply *reply = dbapi_request_sync(request);
+  free_request(request);
+  if (reply_is_error(reply))
+  {
+    free_reply(reply);
+    return 0;
+  }
+  db_uint_t result = reply->data->value.uint_value;
+  free_reply(reply);
+  return result;
+}
+
+db_double_t dbapi_zincrby(const char *key, db_double_t increment, const char *member)
+{
+  DBRequest *request = create_request(DB_ZINCRBY);
+  add_request_string_arg(request, key);
+  add_request_arg(request, dbobj_create_double(increment));
+  add_request_string_arg(request, member);
+  DBReply *reply = dbapi_request_sync(request);
+  free_request(request);
+  if (reply_is_error(reply))
+  {
+    free_reply(reply);
+    return 0;
+  }
+  db_double_t result = reply->data->value.double_value;
+  free_reply(reply);
+  return result;
+}
+
+db_uint_t dbapi_zrem(const char *key, const char *member)
+{
+  DBRequest *request = create_request(DB_ZREM);
+  add_request_string_arg(request, key);
+  add_request_string_arg(request, member);
+  DBReply *reply = dbapi_request_sync(request);
+  free_request(request);
+  if (reply_is_error(reply))
+  {
+    free_reply(reply);
+    return 0;
+  }
+  db_uint_t result = reply->data->value.uint_value;
+  free_reply(reply);
+  return result;
+}
+
+db_uint_t dbapi_zcard(const char *key)
+{
+  DBRequest *request = create_request(DB_ZCARD);
+  add_request_string_arg(request, key);
+  DBReply *reply = dbapi_request_sync(request);
+  free_request(request);
+  if (reply_is_error(reply))
+  {
+    free_reply(reply);
+    return 0;
+  }
+  db_uint_t result = reply->data->value.uint_value;
+  free_reply(reply);
+  return result;
+}
+
+db_int_t dbapi_zrank(const char *key, const char *member)
+{
+  DBRequest *request = create_request(DB_ZRANK);
+  add_request_string_arg(request, key);
+  add_request_string_arg(request, member);
+  DBReply *reply = dbapi_request_sync(request);
+  free_request(request);
+  if (reply_is_error(reply) || !dbobj_is_int(reply->data))
+  {
+    free_reply(reply);
+    return -1;
+  }
+  db_int_t result = reply->data->value.int_value;
+  free_reply(reply);
+  return result;
+}
+
+DBList *dbapi_zrange(const char *key, db_uint_t start, db_uint_t stop, db_bool_t withscores)
+{
+  DBRequest *request = create_request(DB_ZRANGE);
+  add_request_string_arg(request, key);
+  add_request_arg(request, dbobj_create_uint(start));
+  add_request_arg(request, dbobj_create_uint(stop));
+  if (withscores)
+    add_request_string_arg(request, "WITHSCORES");
+  DBReply *reply = dbapi_request_sync(request);
+  free_request(request);
+  if (reply_is_error(reply))
+  {
+    free_reply(reply);
+    return NULL;
+  }
+  DBList *result = reply->data->value.list;
+  reply->data->value.list = NULL;
+  free_reply(reply);
+  return result;
+}
+
+DBList *dbapi_zrevrange(const char *key, db_uint_t start, db_uint_t stop, db_bool_t withscores)
+{
+  DBRequest *request = create_request(DB_ZREVRANGE);
+  add_request_string_arg(request, key);
+  add_request_arg(request, dbobj_create_uint(start));
+  add_request_arg(request, dbobj_create_uint(stop));
+  if (withscores)
+    add_request_string_arg(request, "WITHSCORES");
+  DBReply *reply = dbapi_request_sync(request);
+  free_request(request);
+  if (reply_is_error(reply))
+  {
+    free_reply(reply);
+    return NULL;
+  }
+  DBList *result = reply->data->value.list;
+  reply->data->value.list = NULL;
+  free_reply(reply);
+  return result;
+}
+
 DBList *dbapi_keys()
 {
   DBRequest *request = create_request(DB_KEYS);
@@ -599,7 +1451,7 @@ DBList *dbapi_keys()
 DBList *dbapi_match_keys(const char *pattern)
 {
   DBRequest *request = create_request(DB_MATCH_KEYS);
-  add_request_arg(request, dbobj_create_string_with_dup(pattern));
+  add_request_string_arg(request, pattern);
   DBReply *reply = dbapi_request_sync(request);
   free_request(request);
   if (reply_is_error(reply))
@@ -613,6 +1465,37 @@ DBList *dbapi_match_keys(const char *pattern)
   return result;
 }
 
+DBList *dbapi_scan(db_uint_t cursor, const char *pattern, db_uint_t count, db_uint_t *next_cursor)
+{
+  DBRequest *request = create_request(DB_SCAN);
+  add_request_arg(request, dbobj_create_uint(cursor));
+  if (pattern)
+  {
+    add_request_string_arg(request, "MATCH");
+    add_request_string_arg(request, pattern);
+  }
+  if (count)
+  {
+    add_request_string_arg(request, "COUNT");
+    add_request_arg(request, dbobj_create_uint(count));
+  }
+  DBReply *reply = dbapi_request_sync(request);
+  free_request(request);
+  if (reply_is_error(reply))
+  {
+    free_reply(reply);
+    *next_cursor = 0;
+    return NULL;
+  }
+  DBList *result = reply->data->value.list;
+  reply->data->value.list = NULL;
+  free_reply(reply);
+  DBListNode *cursor_node = lpop(result);
+  *next_cursor = cursor_node->data->value.uint_value;
+  free_dblistnode(cursor_node);
+  return result;
+}
+
 db_bool_t dbapi_shutdown()
 {
   DBRequest *request = create_request(DB_SHUTDOWN);
@@ -655,6 +1538,22 @@ db_bool_t dbapi_flushall()
   return result;
 }
 
+char *dbapi_info_dataset_memory()
+{
+  DBRequest *request = create_request(DB_INFO_DATASET_MEMORY);
+  DBReply *reply = dbapi_request_sync(request);
+  free_request(request);
+  if (reply_is_error(reply) || !dbobj_is_string(reply->data))
+  {
+    free_reply(reply);
+    return NULL;
+  }
+  char *result = dbobj_extract_string(reply->data);
+  reply->data = NULL;
+  free_reply(reply);
+  return result;
+}
+
 void dbapi_free(char *s)
 {
   free(s);
@@ -664,3 +1563,65 @@ void dbapi_free_list(DBList *list)
 {
   free_dblist(list);
 }
+
+#define RESULT_PASS "\033[0;32mPASS\033[0m"
+#define RESULT_FAIL "\033[0;31mFAIL\033[0m"
+
+typedef struct DBApiTestCase
+{
+  const char *command;
+  const char *expected;
+} DBApiTestCase;
+
+// Checks the RESP2 replies of commands taking number arguments, the server must be running
+void test_dbapi_number_args()
+{
+  DBApiTestCase test_cases[] = {
+      {"SET test:n 10", "+OK\r\n"},
+      {"INCRBY test:n 5", ":15\r\n"},
+      {"INCRBY test:n abc", "-" DB_ERR_NOT_INTEGER "\r\n"},
+      {"INCRBY test:n 1.5", "-" DB_ERR_NOT_INTEGER "\r\n"},
+      {"INCRBY test:n 5x", "-" DB_ERR_NOT_INTEGER "\r\n"},
+      {"INCRBY test:n", "-" DB_ERR_ARG_ERROR "\r\n"},
+      {"DECRBY test:n 5", ":10\r\n"},
+      {"DECRBY test:n abc", "-" DB_ERR_NOT_INTEGER "\r\n"},
+      {"DECRBY test:n 1.5", "-" DB_ERR_NOT_INTEGER "\r\n"},
+      {"GET test:n", "$2\r\n10\r\n"},
+      {"HSET test:h f 1", ":1\r\n"},
+      {"HINCRBY test:h f 2", ":3\r\n"},
+      {"HINCRBY test:h f abc", "-" DB_ERR_NOT_INTEGER "\r\n"},
+      {"HINCRBYFLOAT test:h f 0.5", "$3\r\n3.5\r\n"},
+      {"HINCRBYFLOAT test:h f abc", "-" DB_ERR_NOT_FLOAT "\r\n"},
+      {"HINCRBYFLOAT test:h f inf", "-" DB_ERR_NOT_FLOAT "\r\n"},
+      {"HINCRBYFLOAT test:h f", "-" DB_ERR_ARG_ERROR "\r\n"},
+      {"ZADD test:z abc m", "-" DB_ERR_ARG_ERROR "\r\n"},
+      {"ZADD test:z 1 m 2x n", "-" DB_ERR_ARG_ERROR "\r\n"},
+      {"ZADD test:z nan m", "-" DB_ERR_ARG_ERROR "\r\n"},
+      {"ZADD test:z 1.5 m -inf n", ":2\r\n"},
+      {"ZADD test:z INCR abc m", "-" DB_ERR_ARG_ERROR "\r\n"},
+      {"ZADD test:z INCR 1 m", "$3\r\n2.5\r\n"},
+      {"ZINCRBY test:z abc m", "-" DB_ERR_ARG_ERROR "\r\n"},
+      {"ZINCRBY test:z 0.5 m", "$1\r\n3\r\n"},
+      {"ZCARD test:z", ":2\r\n"},
+      {"PEXPIRE test:n abc", "-" DB_ERR_ARG_ERROR "\r\n"},
+      {"PEXPIRE test:n -1", "-" DB_ERR_ARG_ERROR "\r\n"},
+      {"PEXPIRE test:n 1.5", "-" DB_ERR_ARG_ERROR "\r\n"},
+      {"EXPIRE test:n abc", "-" DB_ERR_ARG_ERROR "\r\n"},
+      {"EXPIRE test:n", "-" DB_ERR_ARG_ERROR "\r\n"},
+      {"EXPIRE test:n 100", ":1\r\n"},
+      {"TTL test:n", ":100\r\n"},
+      {"DEL test:n test:h test:z", ":3\r\n"},
+  };
+
+  size_t test_count = sizeof(test_cases) / sizeof(DBApiTestCase);
+
+  for (size_t i = 0; i < test_count; ++i)
+  {
+    size_t length;
+    char *output = dbapi_run_resp(test_cases[i].command, strlen(test_cases[i].command), RESP_PROTOCOL_2, &length);
+    printf("[%s] Command: \"%s\"\n",
+           strcmp(output, test_cases[i].expected) == 0 ? RESULT_PASS : RESULT_FAIL,
+           test_cases[i].command);
+    free(output);
+  }
+}
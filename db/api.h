@@ -1,15 +1,53 @@
 #ifndef DB_API_H
 #define DB_API_H
 
+#include <stdio.h>
+
 #include "types.h"
 
 db_bool_t server_is_running();
 void server_config_hash_seed(db_uint_t hash_seed);
 void server_config_persistence_filepath(const char *persistence_filepath);
+// Sets the maximum number of bytes of entries in a node of the lists, see `db_config_list_node_size`
+void server_config_list_node_size(db_uint_t list_node_size);
 
 void dbapi_start_server();
 void dbapi_start_terminal_client();
 void dbapi_run_command(const char *command);
+// Parsing throughput benchmark: parses `command` `iterations` times without running it
+// Returns the number of commands parsed per second
+db_double_t dbapi_bench_parse(const char *command, db_uint_t iterations);
+// Runs the commands of `input`, RESP arrays of bulk strings or inline command lines, and returns their replies
+// encoded with `protocol` (RESP_PROTOCOL_2 or RESP_PROTOCOL_3); stops with a protocol error reply at invalid input
+char *dbapi_run_resp(const char *input, size_t length, db_uint8_t protocol, size_t *output_length);
+// Bulk loader: streams the commands of `input`, in the same forms, into the database with pipelining
+// Replies are discarded and errors counted in `stats`; returns false if the input is not valid
+db_bool_t dbapi_pipe(FILE *input, DBPipeStats *stats);
+
+// Borrowed reads: between `dbapi_begin_read` and `dbapi_end_read` the database cannot change, so the
+// views below point into the stored data instead of copying it. They must not be used after `dbapi_end_read`,
+// and no other dbapi function may be called in between since the worker is held off until then.
+void dbapi_begin_read();
+void dbapi_end_read();
+// Returns the value of a string key, or NULL; `buffer` (DBOBJ_NUMBER_BUFFER_SIZE bytes) holds formatted numbers
+const char *dbapi_get_view(const char *key, char *buffer);
+// Fills `views` with up to `capacity` elements of a list range and returns the length of the range,
+// so a caller can grow `views` and read again if it was too small
+db_uint_t dbapi_lrange_view(const char *key, db_uint_t start, db_uint_t stop, const char **views, db_uint_t capacity);
+
+// Allocation-free calls: their requests are built on the stack of the caller and their results are written into
+// caller memory or streamed to a callback, so nothing is allocated on the client side
+typedef void (*DBApiValueFunc)(const char *value, void *context);
+typedef void (*DBApiFieldFunc)(const char *field, const char *value, void *context);
+// Copies the value of a string key into `buffer`, truncated to `capacity` bytes with the terminator
+// Returns the length of the whole value, so a truncated copy can be detected like with snprintf, or -1 if there is none
+db_int_t dbapi_get_into(const char *key, char *buffer, db_uint_t capacity);
+db_int_t dbapi_hget_into(const char *key, const char *field, char *buffer, db_uint_t capacity);
+db_int_t dbapi_lindex_into(const char *key, db_int_t index, char *buffer, db_uint_t capacity);
+// Calls `callback` with each element of a list range, in order; returns the number of elements
+db_uint_t dbapi_lrange_cb(const char *key, db_uint_t start, db_uint_t stop, DBApiValueFunc callback, void *context);
+// Calls `callback` with each field of a hash; returns the number of fields
+db_uint_t dbapi_hgetall_cb(const char *key, DBApiFieldFunc callback, void *context);
 
 DBReply *dbapi_request_async(DBRequest *request);
 DBReply *dbapi_request_sync(DBRequest *request);
@@ -17,6 +55,16 @@ DBReply *dbapi_await_reply(DBReply *reply);
 
 char *dbapi_get(const char *key);
 db_bool_t dbapi_set(const char *key, const char *value);
+// Returns the values of the string keys of `keys` in one request, with a null node for each missing key
+DBList *dbapi_mget(const DBList *keys);
+// Sets key/value pairs in one request; the arguments alternate keys and values and must end with NULL
+db_bool_t dbapi_mset_n(const char *key, ...);
+// Counters are stored as native integers, a missing key counts as 0; returns 0 on error
+// The counter calls, `dbapi_del`, `dbapi_llen` and the expiration calls do not allocate either, see `dbapi_get_into`
+db_int_t dbapi_incr(const char *key);
+db_int_t dbapi_incrby(const char *key, db_int_t value);
+db_int_t dbapi_decr(const char *key);
+db_int_t dbapi_decrby(const char *key, db_int_t value);
 db_uint_t dbapi_del(const char *key);
 db_bool_t dbapi_rename(const char *old_key, const char *new_key);
 db_uint_t dbapi_lpush(const char *key, const char *value);
@@ -25,17 +73,59 @@ char *dbapi_lpop(const char *key);
 db_uint_t dbapi_rpush(const char *key, const char *value);
 db_uint_t dbapi_rpush_n(const char *key, ...);
 char *dbapi_rpop(const char *key);
+// Pop from a list, waiting up to `timeout` seconds (0 forever) for an element; returns NULL on timeout
+char *dbapi_blpop(const char *key, db_double_t timeout);
+char *dbapi_brpop(const char *key, db_double_t timeout);
 db_uint_t dbapi_llen(const char *key);
 DBList *dbapi_lrange(const char *key, db_uint_t start, db_uint_t end);
+// Returns the same range of each list of `keys` in one request, as a list of list nodes
+DBList *dbapi_mlrange(const DBList *keys, db_uint_t start, db_uint_t end);
+// Indexes are 0-based, negative ones count from the end of the list
+char *dbapi_lindex(const char *key, db_int_t index);
+db_bool_t dbapi_lset(const char *key, db_int_t index, const char *value);
+db_bool_t dbapi_ltrim(const char *key, db_int_t start, db_int_t stop);
+// Returns the new length, 0 if the list does not exist or -1 if `pivot` is not found
+db_int_t dbapi_linsert(const char *key, db_bool_t after, const char *pivot, const char *value);
+// Removes `count` occurrences of `value` from the head (from the tail if negative, all if 0)
+db_uint_t dbapi_lrem(const char *key, db_int_t count, const char *value);
+// Returns the index of the first occurrence of `value`, or -1 if not found
+db_int_t dbapi_lpos(const char *key, const char *value);
 char *dbapi_hget(const char *key, const char *field);
 db_uint_t dbapi_hset(const char *key, const char *field, const char *value);
+// Returns the values of `fields` in one request, with a null node for each missing field
+DBList *dbapi_hmget(const char *key, const DBList *fields);
+// Returns all fields of a hash as a flat list of field/value pairs
+DBList *dbapi_hgetall(const char *key);
 db_uint_t dbapi_hdel(const char *key, const char *field);
 db_int_t dbapi_hincrby(const char *key, const char *field, db_int_t value);
+db_double_t dbapi_hincrbyfloat(const char *key, const char *field, db_double_t value);
+db_bool_t dbapi_expire(const char *key, db_uint_t seconds);
+db_bool_t dbapi_pexpire(const char *key, db_uint_t milliseconds);
+db_int_t dbapi_ttl(const char *key);
+db_int_t dbapi_pttl(const char *key);
+db_bool_t dbapi_persist(const char *key);
+// Returns the number of added members
+db_uint_t dbapi_zadd(const char *key, db_double_t score, const char *member);
+// Returns the new score of the member
+db_double_t dbapi_zincrby(const char *key, db_double_t increment, const char *member);
+db_uint_t dbapi_zrem(const char *key, const char *member);
+db_uint_t dbapi_zcard(const char *key);
+// Returns the 0-based rank of a member, or -1 if not found
+db_int_t dbapi_zrank(const char *key, const char *member);
+// Returns the members from rank `start` to rank `stop`, followed by their scores if `withscores`
+DBList *dbapi_zrange(const char *key, db_uint_t start, db_uint_t stop, db_bool_t withscores);
+// Same as `dbapi_zrange` with ranks counted from the highest score, for top-N queries
+DBList *dbapi_zrevrange(const char *key, db_uint_t start, db_uint_t stop, db_bool_t withscores);
 DBList *dbapi_keys();
 DBList *dbapi_match_keys(const char *pattern);
+// Returns about `count` keys matching `pattern` (NULL for all) and stores the next cursor in `next_cursor`
+// The iteration is complete when the next cursor is 0, a key may be returned more than once
+DBList *dbapi_scan(db_uint_t cursor, const char *pattern, db_uint_t count, db_uint_t *next_cursor);
 db_bool_t dbapi_shutdown();
 db_bool_t dbapi_save();
 db_bool_t dbapi_flushall();
+// Returns the slab occupancy report of INFO_DATASET_MEMORY
+char *dbapi_info_dataset_memory();
 
 void dbapi_free(char *s);
 void dbapi_free_list(DBList *list);
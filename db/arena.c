@@ -0,0 +1,57 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils.h"
+#include "arena.h"
+
+void *arena_alloc(DBArena *arena, size_t size)
+{
+  size = (size + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+  DBArenaChunk *chunk = arena->chunks;
+
+  if (!chunk || chunk->size - chunk->used < size)
+  {
+    size_t chunk_size = size > ARENA_CHUNK_SIZE ? size : ARENA_CHUNK_SIZE;
+    DBArenaChunk *new_chunk = (DBArenaChunk *)malloc(sizeof(DBArenaChunk) + chunk_size);
+    if (!new_chunk)
+      EXIT_ON_MEMORY_ERROR();
+    new_chunk->size = chunk_size;
+    new_chunk->used = 0;
+    // an oversized chunk is filled at once, so it goes behind the chunk being filled
+    if (chunk && chunk_size > ARENA_CHUNK_SIZE)
+    {
+      new_chunk->next = chunk->next;
+      chunk->next = new_chunk;
+    }
+    else
+    {
+      new_chunk->next = chunk;
+      arena->chunks = new_chunk;
+    }
+    chunk = new_chunk;
+  }
+
+  void *block = chunk->data + chunk->used;
+  chunk->used += size;
+  return block;
+}
+
+char *arena_strndup(DBArena *arena, const char *string, size_t length)
+{
+  char *copy = (char *)arena_alloc(arena, length + 1);
+  memcpy(copy, string, length);
+  copy[length] = '\0';
+  return copy;
+}
+
+void arena_release(DBArena *arena)
+{
+  DBArenaChunk *chunk = arena->chunks, *next;
+  while (chunk)
+  {
+    next = chunk->next;
+    free(chunk);
+    chunk = next;
+  }
+  arena->chunks = NULL;
+}
@@ -0,0 +1,22 @@
+#ifndef DB_ARENA_H
+#define DB_ARENA_H
+
+#include <stddef.h>
+
+#include "types.h"
+
+// Usable bytes of a chunk, larger allocations get a chunk of their own
+#define ARENA_CHUNK_SIZE 1024
+// Allocations are aligned to this
+#define ARENA_ALIGNMENT 8
+
+// Returns `size` bytes from the arena, they stay valid until `arena_release`
+void *arena_alloc(DBArena *arena, size_t size);
+
+// Copies `length` bytes of a string into the arena and terminates it
+char *arena_strndup(DBArena *arena, const char *string, size_t length);
+
+// Frees every chunk of the arena, which can then be used again
+void arena_release(DBArena *arena);
+
+#endif
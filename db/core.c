@@ -1,4 +1,6 @@
+#include <stdio.h>
 #include <string.h>
+#include <strings.h>
 #include <time.h>
 #include <malloc.h>
 #include <threads.h>
@@ -8,16 +10,31 @@
 #include "utils.h"
 #include "list.h"
 #include "hash.h"
+#include "zset.h"
+#include "listpack.h"
+#include "quicklist.h"
+#include "slab.h"
+#include "arena.h"
 #include "interaction.h"
 #include "core.h"
 
-typedef struct DBTask
+typedef struct CoreScanContext
+{
+  // NULL if every entry matches
+  const DBGlobPattern *glob;
+  DBList *result;
+} CoreScanContext;
+
+// A BLPOP or BRPOP waiting for one of its keys to receive elements
+typedef struct CoreBlockedPop
 {
-  clock_t created_at;
   DBRequest *request;
   DBReply *reply;
-  struct DBTask *next;
-} DBTask;
+  db_bool_t from_tail;
+  // 0 if it waits forever
+  db_mstime_t deadline;
+  struct CoreBlockedPop *next;
+} CoreBlockedPop;
 
 static inline void core_lock_init();
 
@@ -25,33 +42,52 @@ static DBListNode *get_arg_head_node(DBRequest *request);
 
 static int core_worker();
 
-// Retrieves a string by key;
-static const char const *core_retrieve_string(const char *key);
+// Retrieves a string by key, numbers are formatted into `buffer`
+static const char *core_retrieve_string(const char *key, char *buffer);
+
+// Returns a reply for a stored string, sharing it instead of copying it when possible
+static DBObj *core_string_reply(DBObj *value);
 
 // Retrieves a list by key;
-static DBList *core_retrieve_list(const char *key, const db_bool_t create_new_if_not_found);
+static DBQuicklist *core_retrieve_list(const char *key, const db_bool_t create_new_if_not_found);
+
+// Replies null to the blocked pops whose deadline has passed; returns true if there were any
+static db_bool_t core_expire_blocked_pops(db_mstime_t now);
 
 // File path for database persistence
 static char *persistence_filepath = NULL;
 
+// Maximum number of bytes of entries in a node of the lists created from now on
+static db_uint_t list_node_size = QUICKLIST_DEFAULT_NODE_SIZE;
+
 static db_bool_t is_running = false;
 static DBHash *main_ht = NULL;
-static DBHash *expr_ht = NULL;
-static db_uint_t expr_check_index = 0;
 static mtx_t *lock = NULL;
 static thrd_t core_worker_thread = -1;
 
 static DBTask *task_queue_head = NULL;
 static DBTask *task_queue_tail = NULL;
 
+// Signaled by the worker whenever it completes replies
+static cnd_t *reply_cond = NULL;
+
+// Blocked pops in arrival order, each list serves the oldest one first
+static CoreBlockedPop *blocked_pops_head = NULL;
+static CoreBlockedPop *blocked_pops_tail = NULL;
+
+// Set by a handler that parked its request, so the worker leaves the reply pending
+static db_bool_t request_blocked = false;
+
 static inline void core_lock_init()
 {
   if (!lock)
   {
     lock = (mtx_t *)calloc(1, sizeof(mtx_t));
-    if (!lock)
+    reply_cond = (cnd_t *)calloc(1, sizeof(cnd_t));
+    if (!lock || !reply_cond)
       EXIT_ON_MEMORY_ERROR();
     mtx_init(lock, mtx_plain);
+    cnd_init(reply_cond);
   }
 }
 
@@ -73,6 +109,14 @@ db_bool_t core_trylock_is_success()
   return mtx_trylock(lock) == thrd_success;
 }
 
+void core_await_reply(DBReply *reply)
+{
+  core_lock();
+  while (!reply->done)
+    cnd_wait(reply_cond, lock);
+  core_unlock();
+}
+
 static DBListNode *get_arg_head_node(DBRequest *request)
 {
   if (!request || !request->args)
@@ -80,6 +124,36 @@ static DBListNode *get_arg_head_node(DBRequest *request)
   return request->args->head;
 }
 
+// Collects the remaining string arguments into an array of the request arena; returns NULL if any of them is not a string
+static const char **get_string_args(DBRequest *request, DBListNode *curr_arg_node, db_uint_t *count)
+{
+  DBListNode *node;
+  db_uint_t i = 0;
+
+  *count = 0;
+  for (node = curr_arg_node; node; node = node->next)
+  {
+    if (!get_string_arg(node))
+      return NULL;
+    ++*count;
+  }
+
+  const char **strings = (const char **)arena_alloc(&request->arena, *count * sizeof(char *));
+
+  for (node = curr_arg_node; node; node = node->next)
+    strings[i++] = get_string_arg(node);
+
+  return strings;
+}
+
+// Looks up several keys of the main table at once, the returned array lives in the request arena
+static DBHashEntry **core_retrieve_entries(DBRequest *request, const char **keys, db_uint_t count)
+{
+  DBHashEntry **entries = (DBHashEntry **)arena_alloc(&request->arena, count * sizeof(DBHashEntry *));
+  ht_get_many(main_ht, keys, count, entries);
+  return entries;
+}
+
 void db_start()
 {
   if (is_running)
@@ -91,12 +165,11 @@ void db_start()
   if (main_ht)
     ht_reset(main_ht);
   else
+  {
     main_ht = ht_create();
-
-  if (expr_ht)
-    ht_reset(expr_ht);
-  else
-    expr_ht = ht_create();
+    // keys follow the `namespace:oid:field` schema, so pattern queries mostly have a literal prefix
+    ht_enable_prefix_index(main_ht);
+  }
 
   db_flushall(NULL, NULL);
 
@@ -120,14 +193,12 @@ void db_start()
     fclose(file);
 
     char *key = NULL;
-    DBList *list;
-    cJSON *cjson_cursor = cJSON_Parse(buffer);
+    DBQuicklist *list;
+    cJSON *cjson_root = cJSON_Parse(buffer);
+    cJSON *cjson_cursor = cjson_root ? cjson_root->child : NULL;
     cJSON *cjson_array_cursor = NULL;
     free(buffer);
 
-    if (cjson_cursor)
-      cjson_cursor = cjson_cursor->child;
-
     while (cjson_cursor)
     {
       key = cjson_cursor->string;
@@ -140,28 +211,30 @@ void db_start()
 
       if (cJSON_IsString(cjson_cursor))
       {
-        hset(main_ht, dbutil_strdup(key), dbobj_create_string_with_dup(cJSON_GetStringValue(cjson_cursor)), expr_ht);
+        hset(main_ht, key, dbobj_try_encode_number(dbobj_create_string_with_dup(cJSON_GetStringValue(cjson_cursor))));
       }
 
       else if (cJSON_IsArray(cjson_cursor))
       {
         cjson_array_cursor = cjson_cursor->child;
 
-        list = create_dblist();
+        list = quicklist_create(list_node_size);
         while (cjson_array_cursor)
         {
           if (cJSON_IsString(cjson_array_cursor))
           {
-            rpush(list, create_dblistnode_with_string(cJSON_GetStringValue(cjson_array_cursor)));
+            quicklist_push_tail(list, cJSON_GetStringValue(cjson_array_cursor));
           }
 
           cjson_array_cursor = cjson_array_cursor->next;
         }
-        hset(main_ht, dbutil_strdup(key), dbobj_create_string_with_dup(cJSON_GetStringValue(cjson_cursor)), expr_ht);
+        hset(main_ht, key, dbobj_create_quicklist(list));
       }
 
       cjson_cursor = cjson_cursor->next;
     }
+
+    cJSON_Delete(cjson_root);
   }
 
   thrd_create(&core_worker_thread, core_worker, NULL);
@@ -183,23 +256,32 @@ void db_config_persistence_filepath(const char *_persistence_filepath)
   persistence_filepath = dbutil_strdup(_persistence_filepath);
 }
 
-DBReply *db_handle_request(DBRequest *request)
+void db_config_list_node_size(db_uint_t _list_node_size)
 {
-  DBReply *reply = create_reply();
+  list_node_size = _list_node_size ? _list_node_size : QUICKLIST_DEFAULT_NODE_SIZE;
+}
 
-  if (!is_running)
-  {
-    reply_error(reply, DB_ERR_DB_IS_CLOSED);
-    return reply;
-  }
+const char *db_view_string(const char *key, char *buffer)
+{
+  return is_running ? core_retrieve_string(key, buffer) : NULL;
+}
 
-  DBTask *task = (DBTask *)malloc(sizeof(DBTask));
-  if (!task)
-    EXIT_ON_MEMORY_ERROR();
+db_uint_t db_view_list_range(const char *key, db_uint_t start, db_uint_t stop, const char **views, db_uint_t capacity)
+{
+  if (!is_running || !key)
+    return 0;
+
+  DBHashEntry *entry = hget(main_ht, key);
 
+  return entry && dbobj_is_list(entry->data) ? quicklist_view_range(entry->data->value.quicklist, start, stop, views, capacity) : 0;
+}
+
+static void core_queue_task(DBTask *task, DBRequest *request, DBReply *reply, db_bool_t caller_owned)
+{
   task->created_at = clock();
   task->request = request;
   task->reply = reply;
+  task->caller_owned = caller_owned;
   task->next = NULL;
 
   if (!task_queue_head)
@@ -212,10 +294,40 @@ DBReply *db_handle_request(DBRequest *request)
     task_queue_tail->next = task;
     task_queue_tail = task;
   }
+}
+
+DBReply *db_handle_request(DBRequest *request)
+{
+  DBReply *reply = create_reply();
+
+  if (!is_running)
+  {
+    reply_error(reply, DB_ERR_DB_IS_CLOSED);
+    reply->done = true;
+    return reply;
+  }
+
+  DBTask *task = (DBTask *)malloc(sizeof(DBTask));
+  if (!task)
+    EXIT_ON_MEMORY_ERROR();
+
+  core_queue_task(task, request, reply, false);
 
   return reply;
 }
 
+db_bool_t db_queue_request(DBRequest *request, DBReply *reply, DBTask *task)
+{
+  if (!is_running)
+    return false;
+
+  reply->done = false;
+  reply->data = NULL;
+  core_queue_task(task, request, reply, true);
+
+  return true;
+}
+
 static int core_worker()
 {
   clock_t t0;
@@ -225,7 +337,7 @@ static int core_worker()
   const long sleep_increment_ns = NANOSECONDS_PER_SECOND / (5 * 60 * 1000);
   clock_t idle_start_time = 0;
   long sleep_duration_ns = 0;
-  db_bool_t has_request = false;
+  db_bool_t has_request = false, has_expired_pops = false;
   DBHashEntry *curr_check_entry = NULL;
 
   while (is_running)
@@ -254,6 +366,24 @@ static int core_worker()
         case DB_SET:
           db_set(request, reply);
           break;
+        case DB_MGET:
+          db_mget(request, reply);
+          break;
+        case DB_MSET:
+          db_mset(request, reply);
+          break;
+        case DB_INCR:
+          db_incr(request, reply);
+          break;
+        case DB_INCRBY:
+          db_incrby(request, reply);
+          break;
+        case DB_DECR:
+          db_decr(request, reply);
+          break;
+        case DB_DECRBY:
+          db_decrby(request, reply);
+          break;
         case DB_RENAME:
           db_rename(request, reply);
           break;
@@ -278,34 +408,132 @@ static int core_worker()
         case DB_LRANGE:
           db_lrange(request, reply);
           break;
+        case DB_MLRANGE:
+          db_mlrange(request, reply);
+          break;
+        case DB_LINDEX:
+          db_lindex(request, reply);
+          break;
+        case DB_LSET:
+          db_lset(request, reply);
+          break;
+        case DB_LTRIM:
+          db_ltrim(request, reply);
+          break;
+        case DB_LINSERT:
+          db_linsert(request, reply);
+          break;
+        case DB_LREM:
+          db_lrem(request, reply);
+          break;
+        case DB_LPOS:
+          db_lpos(request, reply);
+          break;
+        case DB_BLPOP:
+          db_blpop(request, reply);
+          break;
+        case DB_BRPOP:
+          db_brpop(request, reply);
+          break;
         case DB_HGET:
           db_hget(request, reply);
           break;
         case DB_HSET:
           db_hset(request, reply);
           break;
+        case DB_HMGET:
+          db_hmget(request, reply);
+          break;
+        case DB_HGETALL:
+          db_hgetall(request, reply);
+          break;
         case DB_HDEL:
           db_hdel(request, reply);
           break;
         case DB_HINCRBY:
           db_hincrby(request, reply);
           break;
+        case DB_HINCRBYFLOAT:
+          db_hincrbyfloat(request, reply);
+          break;
         case DB_EXPIRE:
           db_expire(request, reply);
           break;
+        case DB_PEXPIRE:
+          db_pexpire(request, reply);
+          break;
+        case DB_TTL:
+          db_ttl(request, reply);
+          break;
+        case DB_PTTL:
+          db_pttl(request, reply);
+          break;
+        case DB_PERSIST:
+          db_persist(request, reply);
+          break;
         case DB_KEYS:
           db_keys(request, reply);
           break;
         case DB_MATCH_KEYS:
           db_match_keys(request, reply);
           break;
+        case DB_SCAN:
+          db_scan(request, reply);
+          break;
+        case DB_HSCAN:
+          db_hscan(request, reply);
+          break;
+        case DB_ZADD:
+          db_zadd(request, reply);
+          break;
+        case DB_ZINCRBY:
+          db_zincrby(request, reply);
+          break;
+        case DB_ZSCORE:
+          db_zscore(request, reply);
+          break;
+        case DB_ZCARD:
+          db_zcard(request, reply);
+          break;
+        case DB_ZCOUNT:
+          db_zcount(request, reply);
+          break;
+        case DB_ZRANGE:
+          db_zrange(request, reply);
+          break;
+        case DB_ZRANGEBYSCORE:
+          db_zrangebyscore(request, reply);
+          break;
+        case DB_ZREVRANGE:
+          db_zrevrange(request, reply);
+          break;
+        case DB_ZREVRANGEBYSCORE:
+          db_zrevrangebyscore(request, reply);
+          break;
+        case DB_ZRANK:
+          db_zrank(request, reply);
+          break;
+        case DB_ZREM:
+          db_zrem(request, reply);
+          break;
+        case DB_ZREMRANGEBYSCORE:
+          db_zremrangebyscore(request, reply);
+          break;
+        case DB_ZINTERSTORE:
+          db_zinterstore(request, reply);
+          break;
+        case DB_ZUNIONSTORE:
+          db_zunionstore(request, reply);
+          break;
+        case DB_ZSCAN:
+          db_zscan(request, reply);
+          break;
         case DB_FLUSHALL:
           db_flushall(request, reply);
           break;
-        // TODO: Returns the memory usage of the current database dataset
-        // case DB_INFO_DATASET_MEMORY:
-        //   db_get_dataset_memory_usage(request, reply);
-        //   break;
+        case DB_INFO_DATASET_MEMORY:
+          db_info_dataset_memory(request, reply);
+          break;
         case DB_SAVE:
           db_save(request, reply);
           break;
@@ -316,18 +544,27 @@ static int core_worker()
           reply_error(reply, DB_ERR_UNKNOWN_COMMAND);
           break;
         }
-        reply->done = true;
-        free(task_queue_head);
+        // a blocked request is completed later, by a push or its timeout
+        if (request_blocked)
+          request_blocked = false;
+        else
+          reply->done = true;
+        DBTask *done_task = task_queue_head;
         task_queue_head = task_queue_head->next;
+        if (!done_task->caller_owned)
+          free(done_task);
         if (!task_queue_head)
           task_queue_tail = NULL;
       } while (task_queue_head);
     }
 
-    // maintain expires ht
-    if (expr_check_index >= expr_ht->size0)
-      expr_check_index = 0;
-    ht_maintain_expires(main_ht, expr_ht, ++expr_check_index);
+    has_expired_pops = blocked_pops_head && core_expire_blocked_pops(dbutil_mstime());
+
+    if (has_request || has_expired_pops)
+      cnd_broadcast(reply_cond);
+
+    // actively delete expired keys
+    ht_maintain_expires(main_ht, ACTIVE_EXPIRE_CYCLE_KEYS);
     core_unlock();
 
     if (!has_request)
@@ -342,6 +579,8 @@ static int core_worker()
       {
         if (sleep_duration_ns < NANOSECONDS_PER_SECOND)
           sleep_duration_ns += sleep_increment_ns;
+        if (blocked_pops_head && sleep_duration_ns > BLOCKED_POP_MAX_SLEEP_NS)
+          sleep_duration_ns = BLOCKED_POP_MAX_SLEEP_NS;
         thrd_sleep(&(struct timespec){.tv_sec = 0, .tv_nsec = sleep_duration_ns}, NULL);
       }
     }
@@ -350,37 +589,48 @@ static int core_worker()
   return 0;
 }
 
-static const char const *core_retrieve_string(const char *key)
+static const char *core_retrieve_string(const char *key, char *buffer)
 {
   if (!key)
     return NULL;
 
-  DBHashEntry *entry = hget(main_ht, key, expr_ht);
+  DBHashEntry *entry = hget(main_ht, key);
 
   if (entry && entry->data->type == DB_TYPE_STRING)
   {
-    return entry->data->value.string;
+    return dbobj_string_view(entry->data, buffer);
   }
 
   return NULL;
 }
 
-static DBList *core_retrieve_list(const char *key, const db_bool_t create_new_if_not_found)
+static DBObj *core_string_reply(DBObj *value)
+{
+  // numbers are formatted when read, so only plain strings are shared
+  if (value->encoding != DB_ENC_DEFAULT)
+  {
+    char buffer[DBOBJ_NUMBER_BUFFER_SIZE];
+    return dbobj_create_string_with_dup(dbobj_string_view(value, buffer));
+  }
+  return dbobj_retain(value);
+}
+
+static DBQuicklist *core_retrieve_list(const char *key, const db_bool_t create_new_if_not_found)
 {
   if (!key)
     return NULL;
 
-  DBHashEntry *entry = hget(main_ht, key, expr_ht);
+  DBHashEntry *entry = hget(main_ht, key);
 
   if (entry)
   {
-    return entry->data->type == DB_TYPE_LIST ? entry->data->value.list : NULL;
+    return entry->data->type == DB_TYPE_LIST ? entry->data->value.quicklist : NULL;
   }
 
   if (create_new_if_not_found)
   {
-    DBList *list = create_dblist();
-    hset(main_ht, dbutil_strdup(key), dbobj_create_list(list), expr_ht);
+    DBQuicklist *list = quicklist_create(list_node_size);
+    hset(main_ht, key, dbobj_create_quicklist(list));
 
     return list;
   }
@@ -388,6 +638,30 @@ static DBList *core_retrieve_list(const char *key, const db_bool_t create_new_if
   return NULL;
 }
 
+// Looks up an existing list, `wrongtype` is set if the key holds another type
+static DBQuicklist *core_lookup_list(const char *key, db_bool_t *wrongtype)
+{
+  DBHashEntry *entry = hget(main_ht, key);
+
+  *wrongtype = entry && !dbobj_is_list(entry->data);
+  return entry && !*wrongtype ? entry->data->value.quicklist : NULL;
+}
+
+// Pops up to `count` elements into a new list; returns NULL if the list is empty
+static DBList *core_pop_list(DBQuicklist *list, db_uint_t count, db_bool_t from_tail)
+{
+  if (!list->length)
+    return NULL;
+
+  DBList *popped = create_dblist();
+  char *value;
+
+  while (count-- && (value = from_tail ? quicklist_pop_tail(list) : quicklist_pop_head(list)))
+    rpush(popped, create_dblistnode(dbobj_create_string(value)));
+
+  return popped;
+}
+
 void db_get(DBRequest *request, DBReply *reply)
 {
   DBListNode *curr_arg_node = get_arg_head_node(request);
@@ -400,463 +674,2081 @@ void db_get(DBRequest *request, DBReply *reply)
     return;
   }
 
-  const char const *value = core_retrieve_string(key);
+  DBHashEntry *entry = hget(main_ht, key);
 
-  if (value)
+  if (entry && dbobj_is_string(entry->data))
   {
     // Return the string value
-    reply_data(reply, dbobj_create_string_with_dup(value));
+    reply_data(reply, core_string_reply(entry->data));
   }
   else
   {
     // Not found
-    reply_data(reply, dbobj_create_null());
+    reply_data(reply, dbobj_shared_null());
   }
 }
 
 void db_set(DBRequest *request, DBReply *reply)
 {
-  DBListNode *curr_arg_node = get_arg_head_node(request);
-  char *key = get_string_arg(curr_arg_node);
-  curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
-  char *value = get_string_arg(curr_arg_node);
-  curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+  DBListNode *key_node = get_arg_head_node(request);
+  DBListNode *value_node = key_node ? key_node->next : NULL;
 
-  if (!key || !value || curr_arg_node)
+  if (!get_string_arg(key_node) || !get_string_arg(value_node) || value_node->next)
   {
     reply_error(reply, DB_ERR_ARG_ERROR);
     return;
   }
 
-  hset(main_ht, key, dbobj_create_string_with_dup(value), expr_ht);
-  reply_data(reply, dbobj_create_string_with_dup(OK));
+  // the key and the value are moved out of the request into the table
+  hset_move(main_ht, take_string_arg_chars(key_node), dbobj_try_encode_number(take_string_arg(value_node)));
+  reply_data(reply, dbobj_shared_ok());
 }
 
-void db_rename(DBRequest *request, DBReply *reply)
+void db_mget(DBRequest *request, DBReply *reply)
 {
-  DBListNode *curr_arg_node = get_arg_head_node(request);
-  char *old_key = get_string_arg(curr_arg_node);
-  curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
-  char *new_key = get_string_arg(curr_arg_node);
-  curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+  db_uint_t count, i;
+  const char **keys = get_string_args(request, get_arg_head_node(request), &count);
 
-  if (!old_key || !new_key || curr_arg_node)
+  if (!keys || !count)
   {
     reply_error(reply, DB_ERR_ARG_ERROR);
     return;
   }
 
-  if (!ht_rename(main_ht, old_key, new_key, expr_ht))
+  DBHashEntry **entries = core_retrieve_entries(request, keys, count);
+  DBList *values = create_dblist();
+
+  for (i = 0; i < count; ++i)
   {
-    reply_error(reply, DB_ERR_NONEXISTENT_KEY);
-    return;
+    if (entries[i] && dbobj_is_string(entries[i]->data))
+      rpush(values, create_dblistnode(core_string_reply(entries[i]->data)));
+    else
+      rpush(values, create_dblistnode(dbobj_shared_null()));
   }
 
-  reply_data(reply, dbobj_create_string_with_dup(OK));
+  reply_data(reply, dbobj_create_list(values));
 }
 
-void db_del(DBRequest *request, DBReply *reply)
+void db_mset(DBRequest *request, DBReply *reply)
 {
-  DBListNode *curr_arg_node = get_arg_head_node(request);
-  char *key = get_string_arg(curr_arg_node);
-  curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+  DBListNode *curr_arg_node = get_arg_head_node(request), *node;
+  db_uint_t count = 0;
 
-  if (!key)
+  for (node = curr_arg_node; node && get_string_arg(node); node = node->next)
+    ++count;
+
+  if (node || !count || count % 2)
   {
     reply_error(reply, DB_ERR_ARG_ERROR);
     return;
   }
 
-  db_uint_t deleted_count = 0;
-
-  while (key)
-  {
-    if (hdel(main_ht, key, expr_ht))
-      ++deleted_count;
-    key = get_string_arg(curr_arg_node);
-    curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
-  }
+  for (node = curr_arg_node; node; node = node->next->next)
+    hset_move(main_ht, take_string_arg_chars(node), dbobj_try_encode_number(take_string_arg(node->next)));
 
-  reply_data(reply, dbobj_create_uint(deleted_count));
+  reply_data(reply, dbobj_shared_ok());
 }
 
-void db_lpush(DBRequest *request, DBReply *reply)
+// Adds `increment` to the integer held by `key`, updating the stored number in place
+static void core_incrby(DBReply *reply, const char *key, db_int_t increment)
 {
-  DBListNode *curr_arg_node = get_arg_head_node(request);
-  char *key = get_string_arg(curr_arg_node);
-  curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
-  char *member = get_string_arg(curr_arg_node);
-  curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+  DBHashEntry *entry = hget(main_ht, key);
+  db_int_t result;
 
-  if (!key || !member)
+  if (!entry)
   {
-    reply_error(reply, DB_ERR_ARG_ERROR);
+    hset(main_ht, key, dbobj_create_int_string(increment));
+    reply_data(reply, dbobj_shared_int(increment));
     return;
   }
 
-  DBList *list = core_retrieve_list(key, true);
-
-  if (!list)
+  if (!dbobj_is_string(entry->data))
   {
     reply_error(reply, DB_ERR_WRONGTYPE);
     return;
   }
 
-  while (member)
+  // a reply may still share the stored value, which must not change under it
+  if (dbobj_is_shared(entry->data))
   {
-    lpush(list, create_dblistnode_with_string(member));
-    member = get_string_arg(curr_arg_node);
-    curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+    DBObj *copy = dbobj_dup_string(entry->data);
+    free_dbobj(entry->data);
+    entry->data = copy;
+  }
+
+  if (!dbobj_string_incrby(entry->data, increment, &result))
+  {
+    reply_error(reply, DB_ERR_NOT_INTEGER);
+    return;
   }
 
-  reply_data(reply, dbobj_create_uint(list->length));
+  reply_data(reply, dbobj_shared_int(result));
 }
 
-void db_lpop(DBRequest *request, DBReply *reply)
+void db_incr(DBRequest *request, DBReply *reply)
 {
   DBListNode *curr_arg_node = get_arg_head_node(request);
   char *key = get_string_arg(curr_arg_node);
   curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
-  db_uint_t count = curr_arg_node ? get_uint_arg(curr_arg_node) : 1;
-  curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
 
-  if (!key || !count || curr_arg_node)
+  if (!key || curr_arg_node)
   {
     reply_error(reply, DB_ERR_ARG_ERROR);
     return;
   }
 
-  DBList *list = core_retrieve_list(key, false);
-
-  if (!list)
-  {
-    reply_data(reply, dbobj_create_null());
-    return;
-  }
-
-  if (count == 1)
-  {
-    reply_data(reply, dbobj_create_string(extract_dblistnode_string(lpop(list))));
-  }
-  else if (count)
-  {
-    reply_data(reply, dbobj_create_list(lpop_n(list, count)));
-  }
+  core_incrby(reply, key, 1);
 }
 
-void db_rpush(DBRequest *request, DBReply *reply)
+void db_incrby(DBRequest *request, DBReply *reply)
 {
   DBListNode *curr_arg_node = get_arg_head_node(request);
   char *key = get_string_arg(curr_arg_node);
   curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
-  char *member = get_string_arg(curr_arg_node);
+  DBListNode *increment_node = curr_arg_node;
+  db_int_t increment;
   curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
 
-  if (!key || !member)
+  if (!key || !increment_node || curr_arg_node)
   {
     reply_error(reply, DB_ERR_ARG_ERROR);
     return;
   }
 
-  DBList *list = core_retrieve_list(key, true);
-
-  if (!list)
+  if (!parse_int_arg(increment_node, &increment))
   {
-    reply_error(reply, DB_ERR_WRONGTYPE);
+    reply_error(reply, DB_ERR_NOT_INTEGER);
     return;
   }
 
-  while (member)
-  {
-    rpush(list, create_dblistnode_with_string(member));
-    member = get_string_arg(curr_arg_node);
-    curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
-  }
-
-  reply_data(reply, dbobj_create_uint(list->length));
+  core_incrby(reply, key, increment);
 }
 
-void db_rpop(DBRequest *request, DBReply *reply)
+void db_decr(DBRequest *request, DBReply *reply)
 {
   DBListNode *curr_arg_node = get_arg_head_node(request);
   char *key = get_string_arg(curr_arg_node);
   curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
-  db_uint_t count = curr_arg_node ? get_uint_arg(curr_arg_node) : 1;
-  curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
 
-  if (!key || !count || curr_arg_node)
+  if (!key || curr_arg_node)
   {
     reply_error(reply, DB_ERR_ARG_ERROR);
     return;
   }
 
-  DBList *list = core_retrieve_list(key, false);
-
-  if (!list)
-  {
-    reply_data(reply, dbobj_create_null());
-    return;
-  }
-
-  if (count == 1)
-  {
-    reply_data(reply, dbobj_create_string(extract_dblistnode_string(rpop(list))));
-  }
-  else if (count)
-  {
-    reply_data(reply, dbobj_create_list(rpop_n(list, count)));
-  }
+  core_incrby(reply, key, -1);
 }
 
-void db_llen(DBRequest *request, DBReply *reply)
+void db_decrby(DBRequest *request, DBReply *reply)
 {
   DBListNode *curr_arg_node = get_arg_head_node(request);
   char *key = get_string_arg(curr_arg_node);
   curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+  DBListNode *decrement_node = curr_arg_node;
+  db_int_t decrement;
+  curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
 
-  if (!key || curr_arg_node)
+  if (!key || !decrement_node || curr_arg_node)
   {
     reply_error(reply, DB_ERR_ARG_ERROR);
     return;
   }
 
-  const DBList const *list = core_retrieve_list(key, false);
+  if (!parse_int_arg(decrement_node, &decrement))
+  {
+    reply_error(reply, DB_ERR_NOT_INTEGER);
+    return;
+  }
+
+  // the smallest integer has no opposite
+  if (decrement == INT32_MIN)
+  {
+    reply_error(reply, DB_ERR_NOT_INTEGER);
+    return;
+  }
 
-  reply_data(reply, dbobj_create_uint(list ? list->length : 0));
+  core_incrby(reply, key, -decrement);
 }
 
-void db_lrange(DBRequest *request, DBReply *reply)
+void db_rename(DBRequest *request, DBReply *reply)
 {
   DBListNode *curr_arg_node = get_arg_head_node(request);
-  char *key = get_string_arg(curr_arg_node);
-  curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
-  db_uint_t start = curr_arg_node ? get_uint_arg(curr_arg_node) : 0;
+  char *old_key = get_string_arg(curr_arg_node);
   curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
-  db_uint_t stop = curr_arg_node ? get_uint_arg(curr_arg_node) : DB_UINT_MAX;
+  char *new_key = get_string_arg(curr_arg_node);
   curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
 
-  if (!key || curr_arg_node)
+  if (!old_key || !new_key || curr_arg_node)
   {
     reply_error(reply, DB_ERR_ARG_ERROR);
     return;
   }
 
-  DBList *list = core_retrieve_list(key, false);
-
-  list = lrange(list, start, stop);
-
-  if (!list)
+  if (!ht_rename(main_ht, old_key, new_key))
   {
-    reply_error(reply, DB_ERR_WRONGTYPE);
+    reply_error(reply, DB_ERR_NONEXISTENT_KEY);
     return;
   }
 
-  reply_data(reply, dbobj_create_list(list));
+  reply_data(reply, dbobj_shared_ok());
 }
 
-void db_hget(DBRequest *request, DBReply *reply)
+void db_del(DBRequest *request, DBReply *reply)
 {
   DBListNode *curr_arg_node = get_arg_head_node(request);
   char *key = get_string_arg(curr_arg_node);
   curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
-  char *field = get_string_arg(curr_arg_node);
-  curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
 
-  if (!key || !field || curr_arg_node)
+  if (!key)
   {
     reply_error(reply, DB_ERR_ARG_ERROR);
     return;
   }
 
-  DBHashEntry *entry = hget(main_ht, key, expr_ht);
+  db_uint_t deleted_count = 0;
 
-  if (!entry)
+  while (key)
   {
-    reply_data(reply, dbobj_create_null());
+    if (hdel(main_ht, key))
+      ++deleted_count;
+    key = get_string_arg(curr_arg_node);
+    curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+  }
+
+  reply_data(reply, dbobj_shared_uint(deleted_count));
+}
+
+// Builds the reply of a blocking pop, taking ownership of `value`
+static DBObj *core_blocked_pop_reply(const char *key, char *value)
+{
+  DBList *result = create_dblist();
+  rpush(result, create_dblistnode(dbobj_create_string_with_dup(key)));
+  rpush(result, create_dblistnode(dbobj_create_string(value)));
+  return dbobj_create_list(result);
+}
+
+// Completes a blocked pop whose reply is set and unlinks it; `link` points to it and `prev` precedes it
+static void core_finish_blocked_pop(CoreBlockedPop **link, CoreBlockedPop *prev)
+{
+  CoreBlockedPop *blocked = *link;
+
+  blocked->reply->done = true;
+  *link = blocked->next;
+  if (blocked_pops_tail == blocked)
+    blocked_pops_tail = prev;
+  free(blocked);
+}
+
+static db_bool_t core_blocked_pop_waits_on(const CoreBlockedPop *blocked, const char *key)
+{
+  const DBListNode *timeout_node = blocked->request->args->tail;
+
+  for (DBListNode *node = blocked->request->args->head; node != timeout_node; node = node->next)
+    if (strcmp(get_string_arg(node), key) == 0)
+      return true;
+
+  return false;
+}
+
+// Hands the elements of a list that just received some to the pops blocked on its key, oldest first
+static void core_serve_blocked_pops(const char *key, DBQuicklist *list)
+{
+  CoreBlockedPop **link = &blocked_pops_head, *blocked, *prev = NULL;
+
+  while (list->length && (blocked = *link))
+  {
+    if (!core_blocked_pop_waits_on(blocked, key))
+    {
+      prev = blocked;
+      link = &blocked->next;
+      continue;
+    }
+    reply_data(blocked->reply, core_blocked_pop_reply(key, blocked->from_tail ? quicklist_pop_tail(list) : quicklist_pop_head(list)));
+    core_finish_blocked_pop(link, prev);
+  }
+}
+
+static db_bool_t core_expire_blocked_pops(db_mstime_t now)
+{
+  CoreBlockedPop **link = &blocked_pops_head, *blocked, *prev = NULL;
+  db_bool_t expired = false;
+
+  while ((blocked = *link))
+  {
+    if (!blocked->deadline || blocked->deadline > now)
+    {
+      prev = blocked;
+      link = &blocked->next;
+      continue;
+    }
+    reply_data(blocked->reply, dbobj_shared_null());
+    core_finish_blocked_pop(link, prev);
+    expired = true;
+  }
+
+  return expired;
+}
+
+// Shared by BLPOP and BRPOP, the last argument is the timeout
+static void core_blocking_pop(DBRequest *request, DBReply *reply, db_bool_t from_tail)
+{
+  DBListNode *first_key_node = get_arg_head_node(request), *node;
+  DBListNode *timeout_node = first_key_node ? request->args->tail : NULL;
+  db_double_t timeout;
+  DBQuicklist *list;
+  db_bool_t wrongtype;
+  char *key;
+
+  // the timeout is in seconds, and the deadline in milliseconds must fit in db_mstime_t
+  if (!first_key_node || first_key_node == timeout_node || !parse_double_arg(timeout_node, &timeout) ||
+      timeout < 0 || timeout > (db_double_t)(INT64_MAX / 2000))
+  {
+    reply_error(reply, DB_ERR_ARG_ERROR);
+    return;
+  }
+
+  for (node = first_key_node; node != timeout_node; node = node->next)
+  {
+    if (!(key = get_string_arg(node)))
+    {
+      reply_error(reply, DB_ERR_ARG_ERROR);
+      return;
+    }
+    list = core_lookup_list(key, &wrongtype);
+    if (wrongtype)
+    {
+      reply_error(reply, DB_ERR_WRONGTYPE);
+      return;
+    }
+    if (list && list->length)
+    {
+      reply_data(reply, core_blocked_pop_reply(key, from_tail ? quicklist_pop_tail(list) : quicklist_pop_head(list)));
+      return;
+    }
+  }
+
+  // every list is empty, the request waits for a push
+  CoreBlockedPop *blocked = (CoreBlockedPop *)malloc(sizeof(CoreBlockedPop));
+  if (!blocked)
+    EXIT_ON_MEMORY_ERROR();
+
+  blocked->request = request;
+  blocked->reply = reply;
+  blocked->from_tail = from_tail;
+  blocked->deadline = timeout > 0 ? dbutil_mstime() + (db_mstime_t)ceil(timeout * 1000) : 0;
+  blocked->next = NULL;
+
+  if (blocked_pops_tail)
+    blocked_pops_tail->next = blocked;
+  else
+    blocked_pops_head = blocked;
+  blocked_pops_tail = blocked;
+
+  request_blocked = true;
+}
+
+void db_blpop(DBRequest *request, DBReply *reply)
+{
+  core_blocking_pop(request, reply, false);
+}
+
+void db_brpop(DBRequest *request, DBReply *reply)
+{
+  core_blocking_pop(request, reply, true);
+}
+
+void db_lpush(DBRequest *request, DBReply *reply)
+{
+  DBListNode *curr_arg_node = get_arg_head_node(request);
+  char *key = get_string_arg(curr_arg_node);
+  curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+  char *member = get_string_arg(curr_arg_node);
+  curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+
+  if (!key || !member)
+  {
+    reply_error(reply, DB_ERR_ARG_ERROR);
+    return;
+  }
+
+  DBQuicklist *list = core_retrieve_list(key, true);
+
+  if (!list)
+  {
+    reply_error(reply, DB_ERR_WRONGTYPE);
+    return;
+  }
+
+  while (member)
+  {
+    quicklist_push_head(list, member);
+    member = get_string_arg(curr_arg_node);
+    curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+  }
+
+  reply_data(reply, dbobj_shared_uint(list->length));
+
+  if (blocked_pops_head)
+    core_serve_blocked_pops(key, list);
+}
+
+void db_lpop(DBRequest *request, DBReply *reply)
+{
+  DBListNode *curr_arg_node = get_arg_head_node(request);
+  char *key = get_string_arg(curr_arg_node);
+  curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+  db_uint_t count = curr_arg_node ? get_uint_arg(curr_arg_node) : 1;
+  curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+
+  if (!key || !count || curr_arg_node)
+  {
+    reply_error(reply, DB_ERR_ARG_ERROR);
+    return;
+  }
+
+  DBQuicklist *list = core_retrieve_list(key, false);
+
+  if (!list)
+  {
+    reply_data(reply, dbobj_shared_null());
+    return;
+  }
+
+  if (count == 1)
+  {
+    reply_data(reply, dbobj_create_string(quicklist_pop_head(list)));
+  }
+  else if (count)
+  {
+    reply_data(reply, dbobj_create_list(core_pop_list(list, count, false)));
+  }
+}
+
+void db_rpush(DBRequest *request, DBReply *reply)
+{
+  DBListNode *curr_arg_node = get_arg_head_node(request);
+  char *key = get_string_arg(curr_arg_node);
+  curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+  char *member = get_string_arg(curr_arg_node);
+  curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+
+  if (!key || !member)
+  {
+    reply_error(reply, DB_ERR_ARG_ERROR);
+    return;
+  }
+
+  DBQuicklist *list = core_retrieve_list(key, true);
+
+  if (!list)
+  {
+    reply_error(reply, DB_ERR_WRONGTYPE);
+    return;
+  }
+
+  while (member)
+  {
+    quicklist_push_tail(list, member);
+    member = get_string_arg(curr_arg_node);
+    curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+  }
+
+  reply_data(reply, dbobj_shared_uint(list->length));
+
+  if (blocked_pops_head)
+    core_serve_blocked_pops(key, list);
+}
+
+void db_rpop(DBRequest *request, DBReply *reply)
+{
+  DBListNode *curr_arg_node = get_arg_head_node(request);
+  char *key = get_string_arg(curr_arg_node);
+  curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+  db_uint_t count = curr_arg_node ? get_uint_arg(curr_arg_node) : 1;
+  curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+
+  if (!key || !count || curr_arg_node)
+  {
+    reply_error(reply, DB_ERR_ARG_ERROR);
+    return;
+  }
+
+  DBQuicklist *list = core_retrieve_list(key, false);
+
+  if (!list)
+  {
+    reply_data(reply, dbobj_shared_null());
+    return;
+  }
+
+  if (count == 1)
+  {
+    reply_data(reply, dbobj_create_string(quicklist_pop_tail(list)));
+  }
+  else if (count)
+  {
+    reply_data(reply, dbobj_create_list(core_pop_list(list, count, true)));
+  }
+}
+
+void db_llen(DBRequest *request, DBReply *reply)
+{
+  DBListNode *curr_arg_node = get_arg_head_node(request);
+  char *key = get_string_arg(curr_arg_node);
+  curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+
+  if (!key || curr_arg_node)
+  {
+    reply_error(reply, DB_ERR_ARG_ERROR);
+    return;
+  }
+
+  const DBQuicklist *list = core_retrieve_list(key, false);
+
+  reply_data(reply, dbobj_shared_uint(list ? list->length : 0));
+}
+
+void db_lrange(DBRequest *request, DBReply *reply)
+{
+  DBListNode *curr_arg_node = get_arg_head_node(request);
+  char *key = get_string_arg(curr_arg_node);
+  curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+  db_uint_t start = curr_arg_node ? get_uint_arg(curr_arg_node) : 0;
+  curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+  db_uint_t stop = curr_arg_node ? get_uint_arg(curr_arg_node) : DB_UINT_MAX;
+  curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+
+  if (!key || curr_arg_node)
+  {
+    reply_error(reply, DB_ERR_ARG_ERROR);
+    return;
+  }
+
+  DBList *list = quicklist_range(core_retrieve_list(key, false), start, stop);
+
+  if (!list)
+  {
+    reply_error(reply, DB_ERR_WRONGTYPE);
+    return;
+  }
+
+  reply_data(reply, dbobj_create_list(list));
+}
+
+void db_mlrange(DBRequest *request, DBReply *reply)
+{
+  DBListNode *curr_arg_node = get_arg_head_node(request);
+  db_uint_t start = curr_arg_node ? get_uint_arg(curr_arg_node) : 0;
+  curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+  db_uint_t stop = curr_arg_node ? get_uint_arg(curr_arg_node) : DB_UINT_MAX;
+  curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+  db_uint_t count, i;
+  const char **keys = get_string_args(request, curr_arg_node, &count);
+
+  if (!keys || !count)
+  {
+    reply_error(reply, DB_ERR_ARG_ERROR);
+    return;
+  }
+
+  DBHashEntry **entries = core_retrieve_entries(request, keys, count);
+  DBList *lists = create_dblist(), *range;
+
+  for (i = 0; i < count; ++i)
+  {
+    // missing keys and out of range indexes give an empty list, other types give null
+    if (entries[i] && !dbobj_is_list(entries[i]->data))
+    {
+      rpush(lists, create_dblistnode(dbobj_shared_null()));
+      continue;
+    }
+    range = quicklist_range(entries[i] ? entries[i]->data->value.quicklist : NULL, start, stop);
+    rpush(lists, create_dblistnode(dbobj_create_list(range ? range : create_dblist())));
+  }
+
+  reply_data(reply, dbobj_create_list(lists));
+}
+
+void db_lindex(DBRequest *request, DBReply *reply)
+{
+  DBListNode *curr_arg_node = get_arg_head_node(request);
+  char *key = get_string_arg(curr_arg_node);
+  curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+  db_bool_t has_index = curr_arg_node != NULL, wrongtype;
+  db_int_t index = get_int_arg(curr_arg_node);
+  curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+
+  if (!key || !has_index || curr_arg_node)
+  {
+    reply_error(reply, DB_ERR_ARG_ERROR);
+    return;
+  }
+
+  DBQuicklist *list = core_lookup_list(key, &wrongtype);
+
+  if (wrongtype)
+  {
+    reply_error(reply, DB_ERR_WRONGTYPE);
+    return;
+  }
+
+  const char *value = quicklist_index(list, index);
+
+  reply_data(reply, value ? dbobj_create_string_with_dup(value) : dbobj_shared_null());
+}
+
+void db_lset(DBRequest *request, DBReply *reply)
+{
+  DBListNode *curr_arg_node = get_arg_head_node(request);
+  char *key = get_string_arg(curr_arg_node);
+  curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+  db_int_t index = get_int_arg(curr_arg_node);
+  curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+  char *value = get_string_arg(curr_arg_node);
+  curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+  db_bool_t wrongtype;
+
+  if (!key || !value || curr_arg_node)
+  {
+    reply_error(reply, DB_ERR_ARG_ERROR);
+    return;
+  }
+
+  DBQuicklist *list = core_lookup_list(key, &wrongtype);
+
+  if (wrongtype)
+  {
+    reply_error(reply, DB_ERR_WRONGTYPE);
+    return;
+  }
+
+  if (!list)
+  {
+    reply_error(reply, DB_ERR_NONEXISTENT_KEY);
+    return;
+  }
+
+  if (!quicklist_replace(list, index, value))
+  {
+    reply_error(reply, DB_ERR_INDEX_OUT_OF_RANGE);
+    return;
+  }
+
+  reply_data(reply, dbobj_shared_ok());
+}
+
+void db_ltrim(DBRequest *request, DBReply *reply)
+{
+  DBListNode *curr_arg_node = get_arg_head_node(request);
+  char *key = get_string_arg(curr_arg_node);
+  curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+  db_int_t start = get_int_arg(curr_arg_node);
+  curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+  db_bool_t has_stop = curr_arg_node != NULL, wrongtype;
+  db_int_t stop = get_int_arg(curr_arg_node);
+  curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+
+  if (!key || !has_stop || curr_arg_node)
+  {
+    reply_error(reply, DB_ERR_ARG_ERROR);
+    return;
+  }
+
+  DBQuicklist *list = core_lookup_list(key, &wrongtype);
+
+  if (wrongtype)
+  {
+    reply_error(reply, DB_ERR_WRONGTYPE);
+    return;
+  }
+
+  quicklist_trim(list, start, stop);
+  reply_data(reply, dbobj_shared_ok());
+}
+
+void db_linsert(DBRequest *request, DBReply *reply)
+{
+  DBListNode *curr_arg_node = get_arg_head_node(request);
+  char *key = get_string_arg(curr_arg_node);
+  curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+  char *where = get_string_arg(curr_arg_node);
+  curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+  char *pivot = get_string_arg(curr_arg_node);
+  curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+  char *value = get_string_arg(curr_arg_node);
+  curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+  db_bool_t after = where && strcasecmp(where, "AFTER") == 0, wrongtype;
+
+  if (!key || !where || (!after && strcasecmp(where, "BEFORE") != 0) || !pivot || !value || curr_arg_node)
+  {
+    reply_error(reply, DB_ERR_ARG_ERROR);
+    return;
+  }
+
+  DBQuicklist *list = core_lookup_list(key, &wrongtype);
+
+  if (wrongtype)
+  {
+    reply_error(reply, DB_ERR_WRONGTYPE);
+    return;
+  }
+
+  reply_data(reply, dbobj_shared_int(list ? quicklist_insert(list, pivot, value, after) : 0));
+}
+
+void db_lrem(DBRequest *request, DBReply *reply)
+{
+  DBListNode *curr_arg_node = get_arg_head_node(request);
+  char *key = get_string_arg(curr_arg_node);
+  curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+  db_int_t count = get_int_arg(curr_arg_node);
+  curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+  char *value = get_string_arg(curr_arg_node);
+  curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+  db_bool_t wrongtype;
+
+  if (!key || !value || curr_arg_node)
+  {
+    reply_error(reply, DB_ERR_ARG_ERROR);
+    return;
+  }
+
+  DBQuicklist *list = core_lookup_list(key, &wrongtype);
+
+  if (wrongtype)
+  {
+    reply_error(reply, DB_ERR_WRONGTYPE);
+    return;
+  }
+
+  reply_data(reply, dbobj_shared_uint(quicklist_remove(list, value, count)));
+}
+
+void db_lpos(DBRequest *request, DBReply *reply)
+{
+  DBListNode *curr_arg_node = get_arg_head_node(request);
+  char *key = get_string_arg(curr_arg_node);
+  curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+  char *value = get_string_arg(curr_arg_node);
+  curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+  db_int_t rank = 1, count = 0, maxlen = 0;
+  db_bool_t has_count = false, valid = key && value, wrongtype;
+  char *option;
+
+  // RANK, COUNT and MAXLEN may come in any order, each followed by its value
+  while (valid && curr_arg_node)
+  {
+    option = get_string_arg(curr_arg_node);
+    curr_arg_node = curr_arg_node->next;
+    if (!option || !curr_arg_node)
+      valid = false;
+    else if (strcasecmp(option, "RANK") == 0)
+      valid = (rank = get_int_arg(curr_arg_node)) != 0;
+    else if (strcasecmp(option, "COUNT") == 0)
+    {
+      has_count = true;
+      valid = (count = get_int_arg(curr_arg_node)) >= 0;
+    }
+    else if (strcasecmp(option, "MAXLEN") == 0)
+      valid = (maxlen = get_int_arg(curr_arg_node)) >= 0;
+    else
+      valid = false;
+    curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+  }
+
+  if (!valid)
+  {
+    reply_error(reply, DB_ERR_ARG_ERROR);
+    return;
+  }
+
+  DBQuicklist *list = core_lookup_list(key, &wrongtype);
+
+  if (wrongtype)
+  {
+    reply_error(reply, DB_ERR_WRONGTYPE);
+    return;
+  }
+
+  // without COUNT only the first match is needed
+  DBList *positions = quicklist_positions(list, value, rank, has_count ? count : 1, maxlen);
+
+  if (has_count)
+  {
+    reply_data(reply, dbobj_create_list(positions));
+    return;
+  }
+
+  reply_data(reply, positions->head ? dbobj_shared_uint(positions->head->data->value.uint_value) : dbobj_shared_null());
+  free_dblist(positions);
+}
+
+static void core_hash_convert_pair(const char *field, const char *value, void *context)
+{
+  hset((DBHash *)context, field, dbobj_try_encode_number(dbobj_create_string_with_dup(value)));
+}
+
+// Converts a hash object from the listpack encoding to a hash table
+static void core_hash_convert(DBObj *obj)
+{
+  DBHash *hash = ht_create();
+  // hashes of the same kind of record share their field names
+  ht_enable_key_interning(hash);
+  lp_foreach(obj->value.listpack, core_hash_convert_pair, hash);
+  lp_free(obj->value.listpack);
+  obj->encoding = DB_ENC_DEFAULT;
+  obj->value.hash = hash;
+}
+
+// Retrieves the value of a field of a hash object, numbers are formatted into `buffer`; returns NULL if not found
+static const char *core_hash_get(DBObj *obj, const char *field, char *buffer)
+{
+  if (obj->encoding == DB_ENC_LISTPACK)
+    return lp_get(obj->value.listpack, field);
+
+  DBHashEntry *entry = hget(obj->value.hash, field);
+  return entry ? dbobj_string_view(entry->data, buffer) : NULL;
+}
+
+// Sets a field of a hash object, converting it to a hash table once it outgrows the listpack limits
+// If `value_arg` is the argument holding `value`, a hash table takes it instead of a copy
+static db_bool_t core_hash_set(DBObj *obj, const char *field, const char *value, DBListNode *value_arg)
+{
+  if (obj->encoding == DB_ENC_LISTPACK)
+  {
+    DBListpack *lp = obj->value.listpack;
+    if (strlen(field) <= HASH_MAX_LISTPACK_VALUE && strlen(value) <= HASH_MAX_LISTPACK_VALUE &&
+        (lp->length < HASH_MAX_LISTPACK_ENTRIES || lp_get(lp, field)))
+    {
+      lp_set(lp, field, value);
+      return true;
+    }
+    core_hash_convert(obj);
+  }
+
+  DBObj *stored = value_arg ? take_string_arg(value_arg) : dbobj_create_string_with_dup(value);
+  return hset(obj->value.hash, field, dbobj_try_encode_number(stored));
+}
+
+static db_bool_t core_hash_del(DBObj *obj, const char *field)
+{
+  if (obj->encoding == DB_ENC_LISTPACK)
+    return lp_del(obj->value.listpack, field);
+  return hdel(obj->value.hash, field);
+}
+
+// Adds `value` to the integer held by a field, a missing field counts as 0
+// Returns false if the field does not hold an integer or the result overflows
+static db_bool_t core_hash_incrby(DBObj *obj, const char *field, db_int_t value, db_int_t *result)
+{
+  if (obj->encoding != DB_ENC_LISTPACK)
+  {
+    DBHashEntry *entry = hget(obj->value.hash, field);
+    if (entry)
+      return dbobj_string_incrby(entry->data, value, result);
+    hset(obj->value.hash, field, dbobj_create_int_string(value));
+    return *result = value, true;
+  }
+
+  // the listpack keeps its values as text, the number only lives on the stack
+  DBObj number = {.type = DB_TYPE_STRING, .encoding = DB_ENC_DEFAULT};
+  char buffer[DBOBJ_NUMBER_BUFFER_SIZE];
+  db_int_t current = 0;
+
+  number.value.string = (char *)lp_get(obj->value.listpack, field);
+  if (number.value.string && !dbobj_string_get_int(&number, &current))
+    return false;
+  number.encoding = DB_ENC_INT;
+  number.value.int_value = current;
+  if (!dbobj_string_incrby(&number, value, result))
+    return false;
+
+  core_hash_set(obj, field, dbobj_string_view(&number, buffer), NULL);
+  return true;
+}
+
+// Same as `core_hash_incrby` for any number
+static db_bool_t core_hash_incrbyfloat(DBObj *obj, const char *field, db_double_t value, db_double_t *result)
+{
+  if (obj->encoding != DB_ENC_LISTPACK)
+  {
+    DBHashEntry *entry = hget(obj->value.hash, field);
+    if (entry)
+      return dbobj_string_incrbyfloat(entry->data, value, result);
+    hset(obj->value.hash, field, dbobj_create_double_string(value));
+    return *result = value, true;
+  }
+
+  DBObj number = {.type = DB_TYPE_STRING, .encoding = DB_ENC_DEFAULT};
+  char buffer[DBOBJ_NUMBER_BUFFER_SIZE];
+  db_double_t current = 0;
+
+  number.value.string = (char *)lp_get(obj->value.listpack, field);
+  if (number.value.string && !dbobj_string_get_double(&number, &current))
+    return false;
+  number.encoding = DB_ENC_DOUBLE;
+  number.value.double_value = current;
+  if (!dbobj_string_incrbyfloat(&number, value, result))
+    return false;
+
+  core_hash_set(obj, field, dbobj_string_view(&number, buffer), NULL);
+  return true;
+}
+
+void db_hget(DBRequest *request, DBReply *reply)
+{
+  DBListNode *curr_arg_node = get_arg_head_node(request);
+  char *key = get_string_arg(curr_arg_node);
+  curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+  char *field = get_string_arg(curr_arg_node);
+  curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+
+  if (!key || !field || curr_arg_node)
+  {
+    reply_error(reply, DB_ERR_ARG_ERROR);
+    return;
+  }
+
+  DBHashEntry *entry = hget(main_ht, key);
+
+  if (!entry)
+  {
+    reply_data(reply, dbobj_shared_null());
+    return;
+  }
+
+  if (!dbobj_is_hash(entry->data))
+  {
+    reply_error(reply, DB_ERR_WRONGTYPE);
+    return;
+  }
+
+  char buffer[DBOBJ_NUMBER_BUFFER_SIZE];
+  const char *field_value = core_hash_get(entry->data, field, buffer);
+
+  if (!field_value)
+    reply_data(reply, dbobj_shared_null());
+  else
+    reply_data(reply, dbobj_create_string_with_dup(field_value));
+}
+
+void db_hset(DBRequest *request, DBReply *reply)
+{
+  DBListNode *key_node = get_arg_head_node(request);
+  DBListNode *curr_arg_node = key_node;
+  char *key = get_string_arg(curr_arg_node);
+  curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+  char *field = get_string_arg(curr_arg_node);
+  curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+  DBListNode *value_node = curr_arg_node;
+  char *value = get_string_arg(curr_arg_node);
+  curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+
+  if (!key || !field || !value)
+  {
+    reply_error(reply, DB_ERR_ARG_ERROR);
+    return;
+  }
+
+  DBHashEntry *entry = hget(main_ht, key);
+
+  if (entry && !dbobj_is_hash(entry->data))
+  {
+    reply_error(reply, DB_ERR_WRONGTYPE);
+    return;
+  }
+
+  // new hashes start in the listpack encoding
+  DBObj *hash = entry ? entry->data : dbobj_create_listpack_hash(lp_create());
+  if (!entry)
+    hset_move(main_ht, take_string_arg_chars(key_node), hash);
+
+  db_uint_t set_count = 0;
+
+  while (field && value)
+  {
+    if (core_hash_set(hash, field, value, value_node))
+      ++set_count;
+    field = get_string_arg(curr_arg_node);
+    curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+    value_node = curr_arg_node;
+    value = get_string_arg(curr_arg_node);
+    curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+  }
+
+  reply_data(reply, dbobj_shared_uint(set_count));
+}
+
+void db_hmget(DBRequest *request, DBReply *reply)
+{
+  DBListNode *curr_arg_node = get_arg_head_node(request);
+  char *key = get_string_arg(curr_arg_node);
+  curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+  db_uint_t count, i;
+  const char **fields = get_string_args(request, curr_arg_node, &count);
+
+  if (!key || !fields || !count)
+  {
+    reply_error(reply, DB_ERR_ARG_ERROR);
+    return;
+  }
+
+  DBHashEntry *entry = hget(main_ht, key);
+
+  if (entry && !dbobj_is_hash(entry->data))
+  {
+    reply_error(reply, DB_ERR_WRONGTYPE);
+    return;
+  }
+
+  DBList *values = create_dblist();
+  const char *value;
+  char buffer[DBOBJ_NUMBER_BUFFER_SIZE];
+
+  if (entry && entry->data->encoding != DB_ENC_LISTPACK)
+  {
+    DBHashEntry **field_entries = (DBHashEntry **)arena_alloc(&request->arena, count * sizeof(DBHashEntry *));
+    ht_get_many(entry->data->value.hash, fields, count, field_entries);
+    for (i = 0; i < count; ++i)
+    {
+      if (field_entries[i] && dbobj_is_string(field_entries[i]->data))
+        rpush(values, create_dblistnode_with_string(dbobj_string_view(field_entries[i]->data, buffer)));
+      else
+        rpush(values, create_dblistnode(dbobj_shared_null()));
+    }
+  }
+  else
+  {
+    for (i = 0; i < count; ++i)
+    {
+      value = entry ? core_hash_get(entry->data, fields[i], buffer) : NULL;
+      rpush(values, value ? create_dblistnode_with_string(value) : create_dblistnode(dbobj_shared_null()));
+    }
+  }
+
+  reply_data(reply, dbobj_create_list(values));
+}
+
+static void core_hgetall_pair(const char *field, const char *value, void *context)
+{
+  rpush((DBList *)context, create_dblistnode_with_string(field));
+  rpush((DBList *)context, create_dblistnode_with_string(value));
+}
+
+static void core_hgetall_entry(DBHashEntry *entry, void *context)
+{
+  char buffer[DBOBJ_NUMBER_BUFFER_SIZE];
+  if (dbobj_is_string(entry->data))
+    core_hgetall_pair(entry->key, dbobj_string_view(entry->data, buffer), context);
+}
+
+void db_hgetall(DBRequest *request, DBReply *reply)
+{
+  DBListNode *curr_arg_node = get_arg_head_node(request);
+  char *key = get_string_arg(curr_arg_node);
+  curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+
+  if (!key || curr_arg_node)
+  {
+    reply_error(reply, DB_ERR_ARG_ERROR);
+    return;
+  }
+
+  DBHashEntry *entry = hget(main_ht, key);
+
+  if (entry && !dbobj_is_hash(entry->data))
+  {
+    reply_error(reply, DB_ERR_WRONGTYPE);
+    return;
+  }
+
+  DBList *pairs = create_dblist();
+  db_uint_t cursor = 0;
+
+  if (entry && entry->data->encoding == DB_ENC_LISTPACK)
+  {
+    lp_foreach(entry->data->value.listpack, core_hgetall_pair, pairs);
+  }
+  else if (entry)
+  {
+    // the table does not change between the calls, so every field is visited exactly once
+    do
+      cursor = ht_scan(entry->data->value.hash, cursor, SCAN_DEFAULT_COUNT, core_hgetall_entry, pairs);
+    while (cursor);
+  }
+
+  reply_data(reply, dbobj_create_list(pairs));
+}
+
+void db_hdel(DBRequest *request, DBReply *reply)
+{
+  DBListNode *curr_arg_node = get_arg_head_node(request);
+  char *key = get_string_arg(curr_arg_node);
+  curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+  char *field = get_string_arg(curr_arg_node);
+  curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+
+  if (!key || !field)
+  {
+    reply_error(reply, DB_ERR_ARG_ERROR);
+    return;
+  }
+
+  DBHashEntry *entry = hget(main_ht, key);
+
+  if (!entry)
+  {
+    reply_data(reply, dbobj_shared_uint(0));
+    return;
+  }
+
+  if (!dbobj_is_hash(entry->data))
+  {
+    reply_error(reply, DB_ERR_WRONGTYPE);
+    return;
+  }
+
+  db_uint_t deleted_count = 0;
+
+  while (field)
+  {
+    if (core_hash_del(entry->data, field))
+      ++deleted_count;
+    field = get_string_arg(curr_arg_node);
+    curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+  }
+
+  reply_data(reply, dbobj_shared_uint(deleted_count));
+}
+
+void db_hincrby(DBRequest *request, DBReply *reply)
+{
+  DBListNode *curr_arg_node = get_arg_head_node(request);
+  char *key = get_string_arg(curr_arg_node);
+  curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+  char *field = get_string_arg(curr_arg_node);
+  curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+  DBListNode *value_node = curr_arg_node;
+  db_int_t value;
+  curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+
+  if (!key || !field || !value_node || curr_arg_node)
+  {
+    reply_error(reply, DB_ERR_ARG_ERROR);
+    return;
+  }
+
+  if (!parse_int_arg(value_node, &value))
+  {
+    reply_error(reply, DB_ERR_NOT_INTEGER);
+    return;
+  }
+
+  DBHashEntry *entry = hget(main_ht, key);
+
+  if (!entry)
+  {
+    reply_error(reply, DB_ERR_NONEXISTENT_KEY);
+    return;
+  }
+
+  if (!dbobj_is_hash(entry->data))
+  {
+    reply_error(reply, DB_ERR_WRONGTYPE);
+    return;
+  }
+
+  db_int_t result;
+
+  if (!core_hash_incrby(entry->data, field, value, &result))
+  {
+    reply_error(reply, DB_ERR_NOT_INTEGER);
+    return;
+  }
+
+  reply_data(reply, dbobj_shared_int(result));
+}
+
+void db_hincrbyfloat(DBRequest *request, DBReply *reply)
+{
+  DBListNode *curr_arg_node = get_arg_head_node(request);
+  char *key = get_string_arg(curr_arg_node);
+  curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+  char *field = get_string_arg(curr_arg_node);
+  curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+  DBListNode *value_node = curr_arg_node;
+  db_double_t value;
+  curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+
+  if (!key || !field || !value_node || curr_arg_node)
+  {
+    reply_error(reply, DB_ERR_ARG_ERROR);
+    return;
+  }
+
+  if (!parse_double_arg(value_node, &value) || !isfinite(value))
+  {
+    reply_error(reply, DB_ERR_NOT_FLOAT);
+    return;
+  }
+
+  DBHashEntry *entry = hget(main_ht, key);
+
+  if (!entry)
+  {
+    reply_error(reply, DB_ERR_NONEXISTENT_KEY);
+    return;
+  }
+
+  if (!dbobj_is_hash(entry->data))
+  {
+    reply_error(reply, DB_ERR_WRONGTYPE);
+    return;
+  }
+
+  db_double_t result;
+
+  if (!core_hash_incrbyfloat(entry->data, field, value, &result))
+  {
+    reply_error(reply, DB_ERR_NOT_FLOAT);
+    return;
+  }
+
+  reply_data(reply, dbobj_create_double(result));
+}
+
+// Sets the expiration time of a key to `now + ttl * unit_ms`
+static void core_expire(DBRequest *request, DBReply *reply, db_mstime_t unit_ms)
+{
+  DBListNode *curr_arg_node = get_arg_head_node(request);
+  char *key = get_string_arg(curr_arg_node);
+  curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+  DBListNode *ttl_node = curr_arg_node;
+  db_uint_t ttl;
+  curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+
+  if (!key || !parse_uint_arg(ttl_node, &ttl) || curr_arg_node)
+  {
+    reply_error(reply, DB_ERR_ARG_ERROR);
+    return;
+  }
+
+  db_bool_t is_set = ht_set_expire(main_ht, key, dbutil_mstime() + (db_mstime_t)ttl * unit_ms);
+  reply_data(reply, dbobj_shared_int(is_set ? 1 : 0));
+}
+
+// Replies the remaining time to live of a key in `unit_ms`
+// -2 if the key does not exist, -1 if the key has no expiration time
+static void core_ttl(DBRequest *request, DBReply *reply, db_mstime_t unit_ms)
+{
+  DBListNode *curr_arg_node = get_arg_head_node(request);
+  char *key = get_string_arg(curr_arg_node);
+  curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+
+  if (!key || curr_arg_node)
+  {
+    reply_error(reply, DB_ERR_ARG_ERROR);
+    return;
+  }
+
+  DBHashEntry *entry = hget(main_ht, key);
+
+  if (!entry)
+  {
+    reply_data(reply, dbobj_shared_int(-2));
+    return;
+  }
+
+  if (!(entry->flags & DB_ENTRY_FLAG_VOLATILE))
+  {
+    reply_data(reply, dbobj_shared_int(-1));
+    return;
+  }
+
+  // round to the nearest unit, and clamp to the range of the reply integer
+  db_mstime_t ttl = (entry->expires_at - dbutil_mstime() + unit_ms / 2) / unit_ms;
+  if (ttl < 0)
+    ttl = 0;
+  if (ttl > INT32_MAX)
+    ttl = INT32_MAX;
+
+  reply_data(reply, dbobj_shared_int((db_int_t)ttl));
+}
+
+void db_expire(DBRequest *request, DBReply *reply)
+{
+  core_expire(request, reply, 1000);
+}
+
+void db_pexpire(DBRequest *request, DBReply *reply)
+{
+  core_expire(request, reply, 1);
+}
+
+void db_ttl(DBRequest *request, DBReply *reply)
+{
+  core_ttl(request, reply, 1000);
+}
+
+void db_pttl(DBRequest *request, DBReply *reply)
+{
+  core_ttl(request, reply, 1);
+}
+
+void db_persist(DBRequest *request, DBReply *reply)
+{
+  DBListNode *curr_arg_node = get_arg_head_node(request);
+  char *key = get_string_arg(curr_arg_node);
+  curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+
+  if (!key || curr_arg_node)
+  {
+    reply_error(reply, DB_ERR_ARG_ERROR);
+    return;
+  }
+
+  reply_data(reply, dbobj_shared_int(ht_persist(main_ht, key) ? 1 : 0));
+}
+
+// Parses a score bound of ZCOUNT and ZRANGEBYSCORE, a leading '(' excludes it and "-inf" or "+inf" are accepted
+static db_bool_t core_parse_score_bound(DBListNode *arg_node, db_double_t *value, db_bool_t *included)
+{
+  if (!arg_node)
+    return false;
+
+  char *bound = get_string_arg(arg_node), *end;
+  *included = true;
+
+  if (!bound)
+  {
+    *value = get_double_arg(arg_node);
+    return !isnan(*value);
+  }
+
+  if (*bound == '(')
+  {
+    *included = false;
+    ++bound;
+  }
+
+  *value = strtod(bound, &end);
+  return end != bound && !*end && !isnan(*value);
+}
+
+// Retrieves a zset by key, `wrongtype` is set if the key holds another type
+static DBZSet *core_retrieve_zset(const char *key, db_bool_t *wrongtype)
+{
+  DBHashEntry *entry = hget(main_ht, key);
+
+  *wrongtype = entry && !dbobj_is_zset(entry->data);
+  return entry && !*wrongtype ? entry->data->value.zset : NULL;
+}
+
+// Parses the leading options of ZADD, returns the first node after them
+static DBListNode *core_parse_zadd_flags(DBListNode *curr_arg_node, db_uint8_t *flags, db_bool_t *changed)
+{
+  char *option;
+
+  for (; (option = get_string_arg(curr_arg_node)); curr_arg_node = curr_arg_node->next)
+  {
+    if (strcasecmp(option, "NX") == 0)
+      *flags |= DB_ZADD_FLAG_NX;
+    else if (strcasecmp(option, "XX") == 0)
+      *flags |= DB_ZADD_FLAG_XX;
+    else if (strcasecmp(option, "GT") == 0)
+      *flags |= DB_ZADD_FLAG_GT;
+    else if (strcasecmp(option, "LT") == 0)
+      *flags |= DB_ZADD_FLAG_LT;
+    else if (strcasecmp(option, "INCR") == 0)
+      *flags |= DB_ZADD_FLAG_INCR;
+    else if (strcasecmp(option, "CH") == 0)
+      *changed = true;
+    else
+      break;
+  }
+
+  return curr_arg_node;
+}
+
+// Adds members to a zset, or increments the score of a member; creates the zset unless nothing can be added
+static void core_zadd(DBReply *reply, const char *key, DBListNode *pairs_node, db_uint8_t flags, db_bool_t changed)
+{
+  DBListNode *curr_arg_node;
+  db_double_t score;
+  db_bool_t wrongtype;
+  DBZSet *zset = core_retrieve_zset(key, &wrongtype);
+
+  if (wrongtype)
+  {
+    reply_error(reply, DB_ERR_WRONGTYPE);
+    return;
+  }
+
+  if (!zset && (flags & DB_ZADD_FLAG_XX))
+  {
+    reply_data(reply, flags & DB_ZADD_FLAG_INCR ? dbobj_shared_null() : dbobj_shared_uint(0));
+    return;
+  }
+
+  if (!zset)
+  {
+    zset = zset_create();
+    hset(main_ht, key, dbobj_create_zset(zset));
+  }
+
+  if (flags & DB_ZADD_FLAG_INCR)
+  {
+    switch (zadd_with_flags(zset, get_double_arg(pairs_node), get_string_arg(pairs_node->next), flags, &score))
+    {
+    case DB_ZADD_ABORTED:
+      reply_data(reply, dbobj_shared_null());
+      break;
+    case DB_ZADD_NAN:
+      reply_error(reply, DB_ERR_SCORE_NAN);
+      break;
+    default:
+      reply_data(reply, dbobj_create_double(score));
+    }
+    return;
+  }
+
+  db_uint_t added_count = 0, updated_count = 0;
+
+  for (curr_arg_node = pairs_node; curr_arg_node; curr_arg_node = curr_arg_node->next->next)
+  {
+    switch (zadd_with_flags(zset, get_double_arg(curr_arg_node), get_string_arg(curr_arg_node->next), flags, NULL))
+    {
+    case DB_ZADD_ADDED:
+      ++added_count;
+      break;
+    case DB_ZADD_UPDATED:
+      ++updated_count;
+      break;
+    default:
+      break;
+    }
+  }
+
+  reply_data(reply, dbobj_shared_uint(changed ? added_count + updated_count : added_count));
+}
+
+void db_zadd(DBRequest *request, DBReply *reply)
+{
+  DBListNode *curr_arg_node = get_arg_head_node(request);
+  char *key = get_string_arg(curr_arg_node);
+  curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+  db_uint8_t flags = 0;
+  db_bool_t changed = false;
+  curr_arg_node = core_parse_zadd_flags(curr_arg_node, &flags, &changed);
+  DBListNode *pairs_node = curr_arg_node;
+
+  if (!key || !curr_arg_node)
+  {
+    reply_error(reply, DB_ERR_ARG_ERROR);
+    return;
+  }
+
+  // NX cannot be combined with the options restricting updates, nor GT with LT
+  if (((flags & DB_ZADD_FLAG_NX) && (flags & (DB_ZADD_FLAG_XX | DB_ZADD_FLAG_GT | DB_ZADD_FLAG_LT))) ||
+      ((flags & DB_ZADD_FLAG_GT) && (flags & DB_ZADD_FLAG_LT)))
+  {
+    reply_error(reply, DB_ERR_SYNTAX_ERROR);
+    return;
+  }
+
+  // validate every pair first, so a bad score does not leave the zset half updated
+  for (db_double_t score; curr_arg_node; curr_arg_node = curr_arg_node->next->next)
+  {
+    if (!curr_arg_node->next || !get_string_arg(curr_arg_node->next) || !parse_double_arg(curr_arg_node, &score))
+    {
+      reply_error(reply, DB_ERR_ARG_ERROR);
+      return;
+    }
+  }
+
+  // INCR takes a single increment and member
+  if ((flags & DB_ZADD_FLAG_INCR) && pairs_node->next->next)
+  {
+    reply_error(reply, DB_ERR_SYNTAX_ERROR);
+    return;
+  }
+
+  core_zadd(reply, key, pairs_node, flags, changed);
+}
+
+void db_zincrby(DBRequest *request, DBReply *reply)
+{
+  DBListNode *curr_arg_node = get_arg_head_node(request);
+  char *key = get_string_arg(curr_arg_node);
+  curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+  DBListNode *pair_node = curr_arg_node;
+  db_double_t increment;
+
+  if (!key || !pair_node || !pair_node->next || !get_string_arg(pair_node->next) || pair_node->next->next ||
+      !parse_double_arg(pair_node, &increment))
+  {
+    reply_error(reply, DB_ERR_ARG_ERROR);
+    return;
+  }
+
+  core_zadd(reply, key, pair_node, DB_ZADD_FLAG_INCR, false);
+}
+
+void db_zscore(DBRequest *request, DBReply *reply)
+{
+  DBListNode *curr_arg_node = get_arg_head_node(request);
+  char *key = get_string_arg(curr_arg_node);
+  curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+  char *member = get_string_arg(curr_arg_node);
+  curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+  db_bool_t wrongtype;
+
+  if (!key || !member || curr_arg_node)
+  {
+    reply_error(reply, DB_ERR_ARG_ERROR);
+    return;
+  }
+
+  DBZSet *zset = core_retrieve_zset(key, &wrongtype);
+
+  if (wrongtype)
+    reply_error(reply, DB_ERR_WRONGTYPE);
+  else
+    reply_data(reply, zscore(zset, member));
+}
+
+void db_zcard(DBRequest *request, DBReply *reply)
+{
+  DBListNode *curr_arg_node = get_arg_head_node(request);
+  char *key = get_string_arg(curr_arg_node);
+  curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+  db_bool_t wrongtype;
+
+  if (!key || curr_arg_node)
+  {
+    reply_error(reply, DB_ERR_ARG_ERROR);
     return;
   }
 
-  if (!dbobj_is_hash(entry->data))
-  {
+  DBZSet *zset = core_retrieve_zset(key, &wrongtype);
+
+  if (wrongtype)
     reply_error(reply, DB_ERR_WRONGTYPE);
+  else
+    reply_data(reply, dbobj_shared_uint(zcard(zset)));
+}
+
+void db_zcount(DBRequest *request, DBReply *reply)
+{
+  DBListNode *curr_arg_node = get_arg_head_node(request);
+  char *key = get_string_arg(curr_arg_node);
+  curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+  db_double_t min, max;
+  db_bool_t included_min, included_max, wrongtype;
+  db_bool_t has_min = core_parse_score_bound(curr_arg_node, &min, &included_min);
+  curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+  db_bool_t has_max = core_parse_score_bound(curr_arg_node, &max, &included_max);
+  curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+
+  if (!key || !has_min || !has_max || curr_arg_node)
+  {
+    reply_error(reply, DB_ERR_ARG_ERROR);
     return;
   }
 
-  DBHashEntry *field_entry = hget(entry->data->value.hash, field, NULL);
+  DBZSet *zset = core_retrieve_zset(key, &wrongtype);
 
-  if (!field_entry || !dbobj_is_string(field_entry->data))
-    reply_data(reply, dbobj_create_null());
+  if (wrongtype)
+    reply_error(reply, DB_ERR_WRONGTYPE);
   else
-    reply_data(reply, dbobj_create_string_with_dup(field_entry->data->value.string));
+    reply_data(reply, dbobj_shared_uint(zcount(zset, min, included_min, max, included_max)));
 }
 
-void db_hset(DBRequest *request, DBReply *reply)
+// Shared by ZRANGE and ZREVRANGE
+static void core_zrange(DBRequest *request, DBReply *reply, db_bool_t reverse)
 {
   DBListNode *curr_arg_node = get_arg_head_node(request);
   char *key = get_string_arg(curr_arg_node);
   curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
-  char *field = get_string_arg(curr_arg_node);
+  db_uint_t start = curr_arg_node ? get_uint_arg(curr_arg_node) : 0;
   curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
-  char *value = get_string_arg(curr_arg_node);
+  db_uint_t stop = curr_arg_node ? get_uint_arg(curr_arg_node) : DB_UINT_MAX;
   curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+  char *option = get_string_arg(curr_arg_node);
+  db_bool_t withscores = option && strcasecmp(option, "WITHSCORES") == 0;
+  curr_arg_node = withscores ? curr_arg_node->next : curr_arg_node;
+  db_bool_t wrongtype;
 
-  if (!key || !field || !value)
+  if (!key || curr_arg_node)
   {
     reply_error(reply, DB_ERR_ARG_ERROR);
     return;
   }
 
-  DBHash *hash = NULL;
-  DBHashEntry *entry = hget(main_ht, key, expr_ht);
+  DBZSet *zset = core_retrieve_zset(key, &wrongtype);
 
-  if (!entry)
+  if (wrongtype)
+    reply_error(reply, DB_ERR_WRONGTYPE);
+  else if (!zset)
+    reply_data(reply, dbobj_create_list(create_dblist()));
+  else
+    reply_data(reply, dbobj_create_list(reverse ? zrevrange(zset, start, stop, withscores) : zrange(zset, start, stop, withscores)));
+}
+
+void db_zrange(DBRequest *request, DBReply *reply)
+{
+  core_zrange(request, reply, false);
+}
+
+void db_zrevrange(DBRequest *request, DBReply *reply)
+{
+  core_zrange(request, reply, true);
+}
+
+// Shared by ZRANGEBYSCORE and ZREVRANGEBYSCORE, the reverse variant takes `max` before `min`
+static void core_zrangebyscore(DBRequest *request, DBReply *reply, db_bool_t reverse)
+{
+  DBListNode *curr_arg_node = get_arg_head_node(request);
+  char *key = get_string_arg(curr_arg_node);
+  curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+  db_double_t min, max;
+  db_bool_t included_min, included_max, wrongtype;
+  db_bool_t has_min = core_parse_score_bound(curr_arg_node, reverse ? &max : &min, reverse ? &included_max : &included_min);
+  curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+  db_bool_t has_max = core_parse_score_bound(curr_arg_node, reverse ? &min : &max, reverse ? &included_min : &included_max);
+  curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+  db_bool_t withscores = false, has_limit = false, valid = key && has_min && has_max;
+  db_int_t offset = 0, count = -1;
+  char *option;
+
+  // WITHSCORES and LIMIT may come in any order
+  while (valid && curr_arg_node)
   {
-    hash = ht_create();
-    hset(main_ht, dbutil_strdup(key), dbobj_create_hash(hash), expr_ht);
+    option = get_string_arg(curr_arg_node);
+    curr_arg_node = curr_arg_node->next;
+    if (option && strcasecmp(option, "WITHSCORES") == 0 && !withscores)
+      withscores = true;
+    else if (option && strcasecmp(option, "LIMIT") == 0 && !has_limit && curr_arg_node && curr_arg_node->next)
+    {
+      has_limit = true;
+      offset = get_int_arg(curr_arg_node);
+      count = get_int_arg(curr_arg_node->next);
+      curr_arg_node = curr_arg_node->next->next;
+    }
+    else
+      valid = false;
   }
-  else
+
+  if (!valid)
   {
-    hash = entry->data->value.hash;
+    reply_error(reply, DB_ERR_ARG_ERROR);
+    return;
   }
 
-  if (entry && !dbobj_is_hash(entry->data))
+  DBZSet *zset = core_retrieve_zset(key, &wrongtype);
+
+  if (wrongtype)
   {
     reply_error(reply, DB_ERR_WRONGTYPE);
     return;
   }
 
-  db_uint_t set_count = 0;
-
-  while (field && value)
+  // a negative offset returns nothing, a negative count returns every member after the offset
+  if (!zset || offset < 0)
   {
-    if (hset(hash, dbutil_strdup(field), dbobj_create_string_with_dup(value), NULL))
-      ++set_count;
-    field = get_string_arg(curr_arg_node);
-    curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
-    value = get_string_arg(curr_arg_node);
-    curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+    reply_data(reply, dbobj_create_list(create_dblist()));
+    return;
   }
 
-  reply_data(reply, dbobj_create_uint(set_count));
+  db_uint_t limit = count < 0 ? DB_UINT_MAX : (db_uint_t)count;
+  reply_data(reply, dbobj_create_list(reverse ? zrevrangebyscore(zset, min, included_min, max, included_max, offset, limit, withscores)
+                                              : zrangebyscore(zset, min, included_min, max, included_max, offset, limit, withscores)));
 }
 
-void db_hdel(DBRequest *request, DBReply *reply)
+void db_zrangebyscore(DBRequest *request, DBReply *reply)
+{
+  core_zrangebyscore(request, reply, false);
+}
+
+void db_zrevrangebyscore(DBRequest *request, DBReply *reply)
+{
+  core_zrangebyscore(request, reply, true);
+}
+
+void db_zrank(DBRequest *request, DBReply *reply)
 {
   DBListNode *curr_arg_node = get_arg_head_node(request);
   char *key = get_string_arg(curr_arg_node);
   curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
-  char *field = get_string_arg(curr_arg_node);
+  char *member = get_string_arg(curr_arg_node);
   curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+  char *option = get_string_arg(curr_arg_node);
+  db_bool_t withscore = option && strcasecmp(option, "WITHSCORE") == 0;
+  curr_arg_node = withscore ? curr_arg_node->next : curr_arg_node;
+  db_bool_t wrongtype;
 
-  if (!key || !field)
+  if (!key || !member || curr_arg_node)
   {
     reply_error(reply, DB_ERR_ARG_ERROR);
     return;
   }
 
-  DBHashEntry *entry = hget(main_ht, key, expr_ht);
+  DBZSet *zset = core_retrieve_zset(key, &wrongtype);
 
-  if (!entry)
+  if (wrongtype)
+    reply_error(reply, DB_ERR_WRONGTYPE);
+  else
+    reply_data(reply, zrank(zset, member, withscore));
+}
+
+void db_zrem(DBRequest *request, DBReply *reply)
+{
+  DBListNode *curr_arg_node = get_arg_head_node(request);
+  char *key = get_string_arg(curr_arg_node);
+  curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+  char *member = get_string_arg(curr_arg_node);
+  curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+  db_bool_t wrongtype;
+
+  if (!key || !member)
   {
-    reply_data(reply, dbobj_create_uint(0));
+    reply_error(reply, DB_ERR_ARG_ERROR);
     return;
   }
 
-  if (!dbobj_is_hash(entry->data))
+  DBZSet *zset = core_retrieve_zset(key, &wrongtype);
+
+  if (wrongtype)
   {
     reply_error(reply, DB_ERR_WRONGTYPE);
     return;
   }
 
-  db_uint_t deleted_count = 0;
+  db_uint_t removed_count = 0;
 
-  while (field)
+  while (member)
   {
-    if (hdel(entry->data->value.hash, field, NULL))
-      ++deleted_count;
-    field = get_string_arg(curr_arg_node);
+    removed_count += zrem(zset, member);
+    member = get_string_arg(curr_arg_node);
     curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
   }
 
-  reply_data(reply, dbobj_create_uint(deleted_count));
+  reply_data(reply, dbobj_shared_uint(removed_count));
 }
 
-void db_hincrby(DBRequest *request, DBReply *reply)
+void db_zremrangebyscore(DBRequest *request, DBReply *reply)
 {
   DBListNode *curr_arg_node = get_arg_head_node(request);
   char *key = get_string_arg(curr_arg_node);
   curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
-  char *field = get_string_arg(curr_arg_node);
+  db_double_t min, max;
+  db_bool_t included_min, included_max, wrongtype;
+  db_bool_t has_min = core_parse_score_bound(curr_arg_node, &min, &included_min);
   curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
-  db_int_t value = get_int_arg(curr_arg_node);
+  db_bool_t has_max = core_parse_score_bound(curr_arg_node, &max, &included_max);
   curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
 
-  if (!key || !field || curr_arg_node)
+  if (!key || !has_min || !has_max || curr_arg_node)
   {
     reply_error(reply, DB_ERR_ARG_ERROR);
     return;
   }
 
-  DBHashEntry *entry = hget(main_ht, key, expr_ht);
+  DBZSet *zset = core_retrieve_zset(key, &wrongtype);
 
-  if (!entry)
+  if (wrongtype)
+    reply_error(reply, DB_ERR_WRONGTYPE);
+  else
+    reply_data(reply, dbobj_shared_uint(zremrangebyscore(zset, min, included_min, max, included_max)));
+}
+
+// Parses and runs ZINTERSTORE or ZUNIONSTORE, which share their arguments
+static void core_zstore(DBRequest *request, DBReply *reply, db_bool_t is_union)
+{
+  DBListNode *curr_arg_node = get_arg_head_node(request);
+  char *destination = get_string_arg(curr_arg_node);
+  curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+  db_uint_t keys_count = curr_arg_node ? get_uint_arg(curr_arg_node) : 0;
+  curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+  DBListNode *keys_node = curr_arg_node;
+  db_aggregate_t aggregate = DB_AGG_SUM;
+  db_double_t *weights = NULL;
+  char *option;
+  db_bool_t wrongtype;
+  db_uint_t i;
+
+  if (!destination || !keys_count)
   {
-    reply_error(reply, DB_ERR_NONEXISTENT_KEY);
+    reply_error(reply, DB_ERR_ARG_ERROR);
     return;
   }
 
-  if (!dbobj_is_hash(entry->data))
+  for (i = 0; i < keys_count; ++i, curr_arg_node = curr_arg_node->next)
   {
-    reply_error(reply, DB_ERR_WRONGTYPE);
+    if (!curr_arg_node || !get_string_arg(curr_arg_node))
+    {
+      reply_error(reply, DB_ERR_ARG_ERROR);
+      return;
+    }
+  }
+
+  while (curr_arg_node)
+  {
+    option = get_string_arg(curr_arg_node);
+    curr_arg_node = curr_arg_node->next;
+    if (option && strcasecmp(option, "WEIGHTS") == 0 && !weights)
+    {
+      weights = (db_double_t *)arena_alloc(&request->arena, keys_count * sizeof(db_double_t));
+      for (i = 0; i < keys_count; ++i, curr_arg_node = curr_arg_node->next)
+      {
+        if (!curr_arg_node || isnan(weights[i] = get_double_arg(curr_arg_node)))
+        {
+          reply_error(reply, DB_ERR_NOT_FLOAT);
+          return;
+        }
+      }
+    }
+    else if (option && strcasecmp(option, "AGGREGATE") == 0 && (option = get_string_arg(curr_arg_node)))
+    {
+      curr_arg_node = curr_arg_node->next;
+      if (strcasecmp(option, "SUM") == 0)
+        aggregate = DB_AGG_SUM;
+      else if (strcasecmp(option, "MIN") == 0)
+        aggregate = DB_AGG_MIN;
+      else if (strcasecmp(option, "MAX") == 0)
+        aggregate = DB_AGG_MAX;
+      else
+        option = NULL;
+    }
+    else
+      option = NULL;
+
+    if (!option)
+    {
+      reply_error(reply, DB_ERR_SYNTAX_ERROR);
+      return;
+    }
+  }
+
+  DBZSet **zsets = (DBZSet **)arena_alloc(&request->arena, keys_count * sizeof(DBZSet *));
+
+  // missing keys are passed as NULL, which counts as an empty zset
+  for (i = 0, curr_arg_node = keys_node; i < keys_count; ++i, curr_arg_node = curr_arg_node->next)
+  {
+    zsets[i] = core_retrieve_zset(get_string_arg(curr_arg_node), &wrongtype);
+    if (wrongtype)
+    {
+      reply_error(reply, DB_ERR_WRONGTYPE);
+      return;
+    }
+  }
+
+  DBZSet *result = is_union ? zunionstore(zsets, keys_count, weights, aggregate)
+                            : zinterstore(zsets, keys_count, weights, aggregate);
+  db_uint_t length = zcard(result);
+
+
+  // the destination is replaced even if it is one of the sources, an empty result deletes it
+  hdel(main_ht, destination);
+  if (length)
+    hset(main_ht, destination, dbobj_create_zset(result));
+  else
+    free_dbzset(result);
+
+  reply_data(reply, dbobj_shared_uint(length));
+}
+
+void db_zinterstore(DBRequest *request, DBReply *reply)
+{
+  core_zstore(request, reply, false);
+}
+
+void db_zunionstore(DBRequest *request, DBReply *reply)
+{
+  core_zstore(request, reply, true);
+}
+
+void db_keys(DBRequest *request, DBReply *reply)
+{
+  reply_data(reply, dbobj_create_list(ht_keys(main_ht)));
+}
+
+void db_match_keys(DBRequest *request, DBReply *reply)
+{
+  DBListNode *curr_arg_node = get_arg_head_node(request);
+  char *pattern = get_string_arg(curr_arg_node);
+  curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+
+  if (!pattern || curr_arg_node)
+  {
+    reply_error(reply, DB_ERR_ARG_ERROR);
     return;
   }
 
-  reply_data(reply, dbobj_create_int(hincrby(entry->data->value.hash, field, value, NULL)));
+  reply_data(reply, dbobj_create_list(ht_match_keys(main_ht, pattern)));
 }
 
-void db_expire(DBRequest *request, DBReply *reply)
+// Parses the optional `MATCH pattern` and `COUNT count` arguments of the SCAN family
+static db_bool_t core_parse_scan_options(DBListNode *curr_arg_node, char **pattern, db_uint_t *count)
+{
+  char *option;
+
+  while (curr_arg_node)
+  {
+    option = get_string_arg(curr_arg_node);
+    curr_arg_node = curr_arg_node->next;
+
+    if (!option || !curr_arg_node)
+      return false;
+
+    if (strcasecmp(option, "MATCH") == 0)
+    {
+      *pattern = get_string_arg(curr_arg_node);
+      if (!*pattern)
+        return false;
+    }
+    else if (strcasecmp(option, "COUNT") == 0)
+    {
+      *count = get_uint_arg(curr_arg_node);
+      if (!*count)
+        return false;
+    }
+    else
+    {
+      return false;
+    }
+
+    curr_arg_node = curr_arg_node->next;
+  }
+
+  return true;
+}
+
+static void core_scan_key(DBHashEntry *entry, void *context)
+{
+  CoreScanContext *scan_context = (CoreScanContext *)context;
+  if (scan_context->glob && !dbutil_glob_match(scan_context->glob, entry->key, strlen(entry->key)))
+    return;
+  rpush(scan_context->result, create_dblistnode_with_string(entry->key));
+}
+
+static void core_scan_field(DBHashEntry *entry, void *context)
+{
+  CoreScanContext *scan_context = (CoreScanContext *)context;
+  char buffer[DBOBJ_NUMBER_BUFFER_SIZE];
+  if (!dbobj_is_string(entry->data))
+    return;
+  if (scan_context->glob && !dbutil_glob_match(scan_context->glob, entry->key, strlen(entry->key)))
+    return;
+  rpush(scan_context->result, create_dblistnode_with_string(entry->key));
+  rpush(scan_context->result, create_dblistnode_with_string(dbobj_string_view(entry->data, buffer)));
+}
+
+static void core_scan_packed_field(const char *field, const char *value, void *context)
+{
+  CoreScanContext *scan_context = (CoreScanContext *)context;
+  if (scan_context->glob && !dbutil_glob_match(scan_context->glob, field, strlen(field)))
+    return;
+  rpush(scan_context->result, create_dblistnode_with_string(field));
+  rpush(scan_context->result, create_dblistnode_with_string(value));
+}
+
+void db_scan(DBRequest *request, DBReply *reply)
+{
+  DBListNode *curr_arg_node = get_arg_head_node(request);
+  db_uint_t cursor = curr_arg_node ? get_uint_arg(curr_arg_node) : 0;
+  curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+  char *pattern = NULL;
+  db_uint_t count = SCAN_DEFAULT_COUNT;
+
+  if (!get_arg_head_node(request) || !core_parse_scan_options(curr_arg_node, &pattern, &count))
+  {
+    reply_error(reply, DB_ERR_ARG_ERROR);
+    return;
+  }
+
+  CoreScanContext context = {dbutil_glob_compile(pattern), create_dblist()};
+  cursor = ht_scan(main_ht, cursor, count, core_scan_key, &context);
+  dbutil_glob_free((DBGlobPattern *)context.glob);
+  lpush(context.result, create_dblistnode(dbobj_shared_uint(cursor)));
+
+  reply_data(reply, dbobj_create_list(context.result));
+}
+
+void db_hscan(DBRequest *request, DBReply *reply)
 {
   DBListNode *curr_arg_node = get_arg_head_node(request);
   char *key = get_string_arg(curr_arg_node);
   curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
-  db_uint_t expire_seconds = curr_arg_node ? get_uint_arg(curr_arg_node) : 0;
+  db_uint_t cursor = curr_arg_node ? get_uint_arg(curr_arg_node) : 0;
+  DBListNode *cursor_arg_node = curr_arg_node;
   curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+  char *pattern = NULL;
+  db_uint_t count = SCAN_DEFAULT_COUNT;
 
-  if (!key || curr_arg_node)
+  if (!key || !cursor_arg_node || !core_parse_scan_options(curr_arg_node, &pattern, &count))
   {
     reply_error(reply, DB_ERR_ARG_ERROR);
     return;
   }
 
-  if (ht_has(main_ht, key, expr_ht))
+  DBHashEntry *entry = hget(main_ht, key);
+
+  if (entry && !dbobj_is_hash(entry->data))
+  {
+    reply_error(reply, DB_ERR_WRONGTYPE);
+    return;
+  }
+
+  CoreScanContext context = {dbutil_glob_compile(pattern), create_dblist()};
+  if (entry && entry->data->encoding == DB_ENC_LISTPACK)
   {
-    hset(expr_ht, key, dbobj_create_uint((db_uint_t)time(NULL) + expire_seconds), NULL);
-    reply_data(reply, dbobj_create_int(1));
+    // a listpack is small enough to be returned in one call
+    lp_foreach(entry->data->value.listpack, core_scan_packed_field, &context);
+    cursor = 0;
   }
   else
   {
-    reply_data(reply, dbobj_create_int(0));
+    cursor = entry ? ht_scan(entry->data->value.hash, cursor, count, core_scan_field, &context) : 0;
   }
-}
+  dbutil_glob_free((DBGlobPattern *)context.glob);
+  lpush(context.result, create_dblistnode(dbobj_shared_uint(cursor)));
 
-void db_keys(DBRequest *request, DBReply *reply)
-{
-  reply_data(reply, dbobj_create_list(ht_keys(main_ht, expr_ht)));
+  reply_data(reply, dbobj_create_list(context.result));
 }
 
-void db_match_keys(DBRequest *request, DBReply *reply)
+void db_zscan(DBRequest *request, DBReply *reply)
 {
   DBListNode *curr_arg_node = get_arg_head_node(request);
-  char *pattern = get_string_arg(curr_arg_node);
+  char *key = get_string_arg(curr_arg_node);
+  curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+  db_uint_t cursor = curr_arg_node ? get_uint_arg(curr_arg_node) : 0;
+  DBListNode *cursor_arg_node = curr_arg_node;
   curr_arg_node = curr_arg_node ? curr_arg_node->next : NULL;
+  char *pattern = NULL;
+  db_uint_t count = SCAN_DEFAULT_COUNT;
 
-  if (!pattern || curr_arg_node)
+  if (!key || !cursor_arg_node || !core_parse_scan_options(curr_arg_node, &pattern, &count))
   {
     reply_error(reply, DB_ERR_ARG_ERROR);
     return;
   }
 
-  reply_data(reply, dbobj_create_list(ht_match_keys(main_ht, pattern, expr_ht)));
+  DBHashEntry *entry = hget(main_ht, key);
+
+  if (entry && !dbobj_is_zset(entry->data))
+  {
+    reply_error(reply, DB_ERR_WRONGTYPE);
+    return;
+  }
+
+  DBList *result = create_dblist();
+  DBGlobPattern *glob = dbutil_glob_compile(pattern);
+  cursor = entry ? zscan(entry->data->value.zset, cursor, glob, count, result) : 0;
+  dbutil_glob_free(glob);
+  lpush(result, create_dblistnode(dbobj_shared_uint(cursor)));
+
+  reply_data(reply, dbobj_create_list(result));
 }
 
 void db_shutdown(DBRequest *request, DBReply *reply)
@@ -870,11 +2762,23 @@ void db_shutdown(DBRequest *request, DBReply *reply)
   is_running = false;
   thrd_join(core_worker_thread, NULL);
 
+  // blocked pops would never be served
+  while (blocked_pops_head)
+  {
+    reply_error(blocked_pops_head->reply, DB_ERR_DB_IS_CLOSED);
+    core_finish_blocked_pop(&blocked_pops_head, NULL);
+  }
+
   db_save(request, reply);
 
   ht_reset(main_ht);
 
-  reply_data(reply, dbobj_create_string_with_dup(OK));
+  reply_data(reply, dbobj_shared_ok());
+}
+
+static void core_save_list_entry(const char *value, void *context)
+{
+  cJSON_AddItemToArray((cJSON *)context, cJSON_CreateString(value));
 }
 
 void db_save(DBRequest *request, DBReply *reply)
@@ -887,8 +2791,8 @@ void db_save(DBRequest *request, DBReply *reply)
 
   cJSON *root = cJSON_CreateObject();
   DBHashEntry *entry;
-  DBListNode *dllnode;
   cJSON *cjson_list;
+  char buffer[DBOBJ_NUMBER_BUFFER_SIZE];
 
   FILE *file = fopen(persistence_filepath, "w");
   if (!file)
@@ -908,20 +2812,13 @@ void db_save(DBRequest *request, DBReply *reply)
         switch (entry->data->type)
         {
         case DB_TYPE_STRING:
-          cJSON_AddItemToObject(root, entry->key, cJSON_CreateString(entry->data->value.string));
+          cJSON_AddItemToObject(root, entry->key, cJSON_CreateString(dbobj_string_view(entry->data, buffer)));
           break;
         case DB_TYPE_LIST:
           cjson_list = cJSON_CreateArray();
-          dllnode = entry->data->value.list->head;
-          while (dllnode)
-          {
-            if (dbobj_is_string(dllnode->data))
-              cJSON_AddItemToArray(cjson_list, cJSON_CreateString(dllnode->data->value.string));
-            dllnode = dllnode->next;
-          }
+          quicklist_foreach(entry->data->value.quicklist, core_save_list_entry, cjson_list);
           cJSON_AddItemToObject(root, entry->key, cjson_list);
           cjson_list = NULL;
-          dllnode = NULL;
           break;
         default:
           break;
@@ -941,20 +2838,13 @@ void db_save(DBRequest *request, DBReply *reply)
         switch (entry->data->type)
         {
         case DB_TYPE_STRING:
-          cJSON_AddItemToObject(root, entry->key, cJSON_CreateString(entry->data->value.string));
+          cJSON_AddItemToObject(root, entry->key, cJSON_CreateString(dbobj_string_view(entry->data, buffer)));
           break;
         case DB_TYPE_LIST:
           cjson_list = cJSON_CreateArray();
-          dllnode = entry->data->value.list->head;
-          while (dllnode)
-          {
-            if (dbobj_is_string(dllnode->data))
-              cJSON_AddItemToArray(cjson_list, cJSON_CreateString(dllnode->data->value.string));
-            dllnode = dllnode->next;
-          }
+          quicklist_foreach(entry->data->value.quicklist, core_save_list_entry, cjson_list);
           cJSON_AddItemToObject(root, entry->key, cjson_list);
           cjson_list = NULL;
-          dllnode = NULL;
           break;
         default:
           break;
@@ -974,14 +2864,49 @@ void db_save(DBRequest *request, DBReply *reply)
   free(json_string);
   cJSON_Delete(root);
 
-  reply_data(reply, dbobj_create_string_with_dup(OK));
+  reply_data(reply, dbobj_shared_ok());
+}
+
+// Longest line of the INFO_DATASET_MEMORY report
+#define INFO_LINE_SIZE 128
+
+void db_info_dataset_memory(DBRequest *request, DBReply *reply)
+{
+  if (get_arg_head_node(request))
+  {
+    reply_error(reply, DB_ERR_ARG_ERROR);
+    return;
+  }
+
+  DBSlabStats stats[DBSLAB_CLASSES];
+  db_uint_t count = dbslab_stats(stats);
+  size_t capacity = (count + 4) * INFO_LINE_SIZE, length = 0;
+  char *info = malloc(capacity);
+  if (!info)
+    EXIT_ON_MEMORY_ERROR();
+
+  size_t allocated_bytes = 0, used_bytes = 0;
+  length += snprintf(info + length, capacity - length, "# Slabs\n");
+  for (db_uint_t i = 0; i < count; ++i)
+  {
+    allocated_bytes += (size_t)stats[i].slabs * DBSLAB_SIZE;
+    used_bytes += (size_t)stats[i].used_blocks * stats[i].block_size;
+    length += snprintf(info + length, capacity - length, "slab_class_%u:slabs=%u,used=%u,total=%u,fragmentation=%.2f\n",
+                       stats[i].block_size, stats[i].slabs, stats[i].used_blocks, stats[i].total_blocks,
+                       1.0 - (double)stats[i].used_blocks / stats[i].total_blocks);
+  }
+  // the fragmentation ratio counts free blocks and the tails of the slabs too short for a block
+  length += snprintf(info + length, capacity - length, "slab_allocated_bytes:%zu\nslab_used_bytes:%zu\nslab_fragmentation_ratio:%.2f\n",
+                     allocated_bytes, used_bytes, allocated_bytes ? 1.0 - (double)used_bytes / allocated_bytes : 0.0);
+
+  reply_data(reply, dbobj_create_string(info));
 }
 
 void db_flushall(DBRequest *request, DBReply *reply)
 {
   if (reply)
   {
-    reply_data(reply, dbobj_create_string_with_dup(OK));
+    reply_data(reply, dbobj_shared_ok());
   }
 
   ht_reset(main_ht);
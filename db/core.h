@@ -7,9 +7,25 @@
 
 #define NANOSECONDS_PER_SECOND 1000000000L
 
+// Maximum number of expired keys deleted by the worker in each cycle
+#define ACTIVE_EXPIRE_CYCLE_KEYS 64
+
+// Default number of entries visited by a command of the SCAN family
+#define SCAN_DEFAULT_COUNT 10
+
+// Hashes are stored in the listpack encoding until they have more fields than this
+#define HASH_MAX_LISTPACK_ENTRIES 128
+// or one of their fields or values is longer than this
+#define HASH_MAX_LISTPACK_VALUE 64
+
+// Longest time the idle worker sleeps while pops are blocked, so their timeouts fire about on time
+#define BLOCKED_POP_MAX_SLEEP_NS 10000000L
+
 int core_lock();
 int core_unlock();
 db_bool_t core_trylock_is_success();
+// Sleeps until the worker completes `reply`, the core lock must not be held
+void core_await_reply(DBReply *reply);
 
 // Starts the database and sets db_seed to a random number
 void db_start();
@@ -20,7 +36,24 @@ void db_config_hash_seed(db_uint_t _hash_seed);
 
 void db_config_persistence_filepath(const char *_persistence_filepath);
 
+// Sets the maximum number of bytes of entries in a list node, 0 restores QUICKLIST_DEFAULT_NODE_SIZE
+// Larger nodes use less memory per element, smaller ones make pushes and pops at the ends cheaper
+void db_config_list_node_size(db_uint_t _list_node_size);
+
 DBReply *db_handle_request(DBRequest *request);
+// Queues a request with a reply and a task provided by the caller, so nothing is allocated; they must outlive the reply
+// Returns false, leaving the reply untouched, if the database is closed
+db_bool_t db_queue_request(DBRequest *request, DBReply *reply, DBTask *task);
+
+// Borrowed reads, the caller must hold the core lock for as long as it uses the returned pointers
+
+// Returns the stored text of a string key without copying it, numbers are formatted into `buffer`
+// (DBOBJ_NUMBER_BUFFER_SIZE bytes); returns NULL if not found or type mismatch
+const char *db_view_string(const char *key, char *buffer);
+
+// Stores pointers to the elements of a list from `start` to `stop` in `views`, at most `capacity` of them
+// Returns the number of elements in the range, 0 if not found or type mismatch
+db_uint_t db_view_list_range(const char *key, db_uint_t start, db_uint_t stop, const char **views, db_uint_t capacity);
 
 // Retrieves a string from the database by key; returns NULL if not found or type mismatch
 void db_get(DBRequest *request, DBReply *reply);
@@ -30,6 +63,21 @@ void db_get(DBRequest *request, DBReply *reply);
 // Returns true if successful, false if type mismatch
 void db_set(DBRequest *request, DBReply *reply);
 
+// Retrieves the string values of several keys; the reply has a null for each missing or non-string key
+void db_mget(DBRequest *request, DBReply *reply);
+
+// Stores several key/value string pairs at once
+void db_mset(DBRequest *request, DBReply *reply);
+
+// Increments the integer held by a key, a missing key counts as 0
+void db_incr(DBRequest *request, DBReply *reply);
+
+void db_incrby(DBRequest *request, DBReply *reply);
+
+void db_decr(DBRequest *request, DBReply *reply);
+
+void db_decrby(DBRequest *request, DBReply *reply);
+
 // Renames an existing key to a new key in the database
 // Removes the old entry and inserts the new one with the updated key
 // Returns true if successful, false if type mismatch
@@ -57,26 +105,144 @@ void db_llen(DBRequest *request, DBReply *reply);
 // The `stop` index is inclusive, and if `stop` is -1, the entire list is returned
 void db_lrange(DBRequest *request, DBReply *reply);
 
+// Returns the same range of several lists: MLRANGE start stop key [key ...]
+// The reply has one list per key, empty for missing keys and null for keys of another type
+void db_mlrange(DBRequest *request, DBReply *reply);
+
+// Pops from the first non-empty list, blocking until one receives elements: BLPOP key [key ...] timeout
+// The timeout is in seconds, 0 blocks forever; replies the key and the element, or null on timeout
+void db_blpop(DBRequest *request, DBReply *reply);
+
+// Same as BLPOP, popping from the end of the list: BRPOP key [key ...] timeout
+void db_brpop(DBRequest *request, DBReply *reply);
+
+// Returns the element at an index of a list, negative indexes count from the end: LINDEX key index
+void db_lindex(DBRequest *request, DBReply *reply);
+
+// Replaces the element at an index of a list: LSET key index element
+void db_lset(DBRequest *request, DBReply *reply);
+
+// Keeps only the elements of a list from `start` to `stop` inclusive: LTRIM key start stop
+void db_ltrim(DBRequest *request, DBReply *reply);
+
+// Inserts an element next to the first occurrence of a pivot: LINSERT key BEFORE|AFTER pivot element
+// Replies the new length, 0 if the list does not exist or -1 if the pivot is not found
+void db_linsert(DBRequest *request, DBReply *reply);
+
+// Removes `count` occurrences of an element from the head, from the tail if negative, all if 0: LREM key count element
+void db_lrem(DBRequest *request, DBReply *reply);
+
+// Returns the index of an element: LPOS key element [RANK rank] [COUNT num-matches] [MAXLEN len]
+// A negative rank searches from the tail; with COUNT the reply is a list of indexes
+void db_lpos(DBRequest *request, DBReply *reply);
+
 void db_hget(DBRequest *request, DBReply *reply);
 
 void db_hset(DBRequest *request, DBReply *reply);
 
+// Retrieves several fields of a hash; the reply has a null for each missing field
+void db_hmget(DBRequest *request, DBReply *reply);
+
+// Retrieves all fields of a hash as a flat list of field/value pairs
+void db_hgetall(DBRequest *request, DBReply *reply);
+
 void db_hdel(DBRequest *request, DBReply *reply);
 
 void db_hincrby(DBRequest *request, DBReply *reply);
 
+// Increments a field of a hash by a floating point number
+void db_hincrbyfloat(DBRequest *request, DBReply *reply);
+
+// Sets a timeout in seconds on a key
 void db_expire(DBRequest *request, DBReply *reply);
 
+// Sets a timeout in milliseconds on a key
+void db_pexpire(DBRequest *request, DBReply *reply);
+
+// Returns the remaining time to live of a key in seconds
+void db_ttl(DBRequest *request, DBReply *reply);
+
+// Returns the remaining time to live of a key in milliseconds
+void db_pttl(DBRequest *request, DBReply *reply);
+
+// Removes the timeout of a key
+void db_persist(DBRequest *request, DBReply *reply);
+
+// Adds members with scores to a zset, updating the score of existing members
+// ZADD key [NX|XX] [GT|LT] [CH] [INCR] score member [score member ...]
+// Replies the number of added members, or of added and updated members with CH
+// With INCR, replies the new score of the member, or nil if the options prevented the change
+void db_zadd(DBRequest *request, DBReply *reply);
+
+// Increments the score of a member, which starts at 0; replies the new score
+// ZINCRBY key increment member
+void db_zincrby(DBRequest *request, DBReply *reply);
+
+void db_zscore(DBRequest *request, DBReply *reply);
+
+void db_zcard(DBRequest *request, DBReply *reply);
+
+// Counts the members within a score range, in O(log n) through the ranks of both ends
+// ZCOUNT key min max; a bound prefixed with '(' is excluded
+void db_zcount(DBRequest *request, DBReply *reply);
+
+// Returns the members from rank `start` to rank `stop`, in O(log n + k)
+// ZRANGE key start stop [WITHSCORES]
+void db_zrange(DBRequest *request, DBReply *reply);
+
+// Returns the members from rank `start` to rank `stop`, ranked from the highest score
+// ZREVRANGE key start stop [WITHSCORES]
+void db_zrevrange(DBRequest *request, DBReply *reply);
+
+// Returns the members within a score range, in O(log n + k) even with an offset
+// ZRANGEBYSCORE key min max [WITHSCORES] [LIMIT offset count]
+void db_zrangebyscore(DBRequest *request, DBReply *reply);
+
+// Same as ZRANGEBYSCORE from the highest score, for top-N queries
+// ZREVRANGEBYSCORE key max min [WITHSCORES] [LIMIT offset count]
+void db_zrevrangebyscore(DBRequest *request, DBReply *reply);
+
+// Returns the 0-based rank of a member, in O(log n)
+// ZRANK key member [WITHSCORE]
+void db_zrank(DBRequest *request, DBReply *reply);
+
+void db_zrem(DBRequest *request, DBReply *reply);
+
+void db_zremrangebyscore(DBRequest *request, DBReply *reply);
+
+// Stores the intersection of zsets in `destination`; replies the number of members stored
+// ZINTERSTORE destination numkeys key [key ...] [WEIGHTS weight [weight ...]] [AGGREGATE SUM|MIN|MAX]
+void db_zinterstore(DBRequest *request, DBReply *reply);
+
+// Stores the union of zsets in `destination`, with the same arguments as ZINTERSTORE
+void db_zunionstore(DBRequest *request, DBReply *reply);
+
 void db_keys(DBRequest *request, DBReply *reply);
 
 void db_match_keys(DBRequest *request, DBReply *reply);
 
+// Incrementally iterates the keys; replies the next cursor followed by the keys
+// SCAN cursor [MATCH pattern] [COUNT count]
+void db_scan(DBRequest *request, DBReply *reply);
+
+// Incrementally iterates the fields of a hash; replies the next cursor followed by field and value pairs
+// HSCAN key cursor [MATCH pattern] [COUNT count]
+void db_hscan(DBRequest *request, DBReply *reply);
+
+// Incrementally iterates the members of a zset; replies the next cursor followed by member and score pairs
+// ZSCAN key cursor [MATCH pattern] [COUNT count]
+void db_zscan(DBRequest *request, DBReply *reply);
+
 // Stops the database and saves data to a specified file
 void db_shutdown(DBRequest *request, DBReply *reply);
 
 // Saves the current state of the database to persistent storage
 void db_save(DBRequest *request, DBReply *reply);
 
+// Reports the occupancy of the slabs holding the objects, entries, list nodes and zset elements
+// One line per size class with its slabs, used and total blocks and the share of free blocks, then the totals
+void db_info_dataset_memory(DBRequest *request, DBReply *reply);
+
 // Deletes all item from all databases.
 void db_flushall(DBRequest *request, DBReply *reply);
 
@@ -3,7 +3,9 @@
 
 #include "utils.h"
 #include "list.h"
+#include "radix.h"
 #include "hash.h"
+#include "slab.h"
 
 db_uint_t hash_seed = 0;
 
@@ -27,6 +29,18 @@ static void _ht_clear(DBHash *ht);
 
 static DBHashEntry *_ht_create_entry(char *key);
 
+// Stores a copy of `key` in an entry, interned if the table interns its keys
+static void _ht_set_entry_key(DBHash *ht, DBHashEntry *entry, const char *key);
+static void _ht_free_entry_key(DBHashEntry *entry);
+
+static inline db_bool_t ht_entry_is_expired(const DBHashEntry *entry, db_mstime_t now);
+
+// Expires heap operations, all of them keep `expires_index` of the moved entries up to date
+static void _ht_expires_push(DBHash *ht, DBHashEntry *entry);
+static void _ht_expires_delete(DBHash *ht, DBHashEntry *entry);
+static void _ht_expires_sift_up(DBExpiresHeap *heap, db_uint_t index);
+static void _ht_expires_sift_down(DBExpiresHeap *heap, db_uint_t index);
+
 static db_uint_t murmurhash2(const void *key, db_uint_t len)
 {
   const db_uint_t m = 0x5bd1e995;
@@ -37,7 +51,9 @@ static db_uint_t murmurhash2(const void *key, db_uint_t len)
 
   while (len >= 4)
   {
-    db_uint_t k = *(db_uint_t *)data;
+    // keys sliced out of a command line are not aligned
+    db_uint_t k;
+    memcpy(&k, data, sizeof(k));
     k *= m, k ^= k >> r, k *= m;
     h *= m, h ^= k;
     data += 4, len -= 4;
@@ -107,6 +123,7 @@ static db_bool_t _ht_rehash_step(DBHash *ht)
   if (ht->rehashing_index == (int32_t)(-1))
   {
     // swap tables
+    free(ht->buckets0);
     ht->size0 = ht->size1;
     ht->count0 = ht->count1;
     ht->buckets0 = ht->buckets1;
@@ -204,6 +221,16 @@ static void _ht_clear(DBHash *ht)
   }
 
   ht->rehashing_index = -1;
+
+  if (ht->expires)
+  {
+    free(ht->expires->entries);
+    free(ht->expires);
+    ht->expires = NULL;
+  }
+
+  // the index stays enabled, only its keys are dropped
+  radix_clear(ht->prefix_index);
 }
 
 static DBHashEntry *ht_add(DBHash *ht, DBHashEntry *entry)
@@ -221,30 +248,163 @@ static DBHashEntry *ht_add(DBHash *ht, DBHashEntry *entry)
     entry->next = ht->buckets1[index];
     ht->buckets1[index] = entry;
     ++ht->count1;
-    return entry;
   }
+  else
+  {
+    index = murmurhash2(entry->key, strlen(entry->key)) % ht->size0;
+    entry->next = ht->buckets0[index];
+    ht->buckets0[index] = entry;
+    ++ht->count0;
+  }
+
+  if (entry->flags & DB_ENTRY_FLAG_VOLATILE)
+    _ht_expires_push(ht, entry);
+
+  if (ht->prefix_index)
+    radix_insert(ht->prefix_index, entry->key, entry);
 
-  index = murmurhash2(entry->key, strlen(entry->key)) % ht->size0;
-  entry->next = ht->buckets0[index];
-  ht->buckets0[index] = entry;
-  ++ht->count0;
   return entry;
 }
 
-static inline db_bool_t ht_entry_is_expire(DBHashEntry *entry, time_t expire)
+// Unlinks an entry from its bucket without touching the expires heap
+static DBHashEntry *_ht_unlink(DBHash *ht, const char *key)
 {
-  if (!entry || !dbobj_is_uint(entry->data))
-    return false;
+  DBHashEntry *curr_entry, *prev_entry = NULL;
+  db_uint_t hash = murmurhash2(key, strlen(key));
+  db_uint_t index;
+
+  if (ht_is_rehashing(ht))
+  {
+    index = hash % ht->size1;
+    curr_entry = ht->buckets1[index];
+    while (curr_entry)
+    {
+      if (strcmp(curr_entry->key, key) == 0)
+      {
+        if (prev_entry)
+          prev_entry->next = curr_entry->next;
+        else
+          ht->buckets1[index] = curr_entry->next;
+        --ht->count1;
+        curr_entry->next = NULL;
+        return curr_entry;
+      }
+      prev_entry = curr_entry;
+      curr_entry = curr_entry->next;
+    }
+  }
+
+  index = hash % ht->size0;
+  curr_entry = ht->buckets0[index];
+  prev_entry = NULL;
+  while (curr_entry)
+  {
+    if (strcmp(curr_entry->key, key) == 0)
+    {
+      if (prev_entry)
+        prev_entry->next = curr_entry->next;
+      else
+        ht->buckets0[index] = curr_entry->next;
+      --ht->count0;
+      curr_entry->next = NULL;
+      return curr_entry;
+    }
+    prev_entry = curr_entry;
+    curr_entry = curr_entry->next;
+  }
 
-  return entry->data->value.uint_value <= (db_int_t)expire;
+  return NULL;
 }
 
-static db_bool_t ht_is_expire(DBHash *expires_ht, const char *key)
+static inline db_bool_t ht_entry_is_expired(const DBHashEntry *entry, db_mstime_t now)
 {
-  if (!expires_ht)
-    return false;
+  return (entry->flags & DB_ENTRY_FLAG_VOLATILE) && entry->expires_at <= now;
+}
+
+static void _ht_expires_sift_up(DBExpiresHeap *heap, db_uint_t index)
+{
+  DBHashEntry *entry = heap->entries[index];
+  db_uint_t parent;
+
+  while (index > 0)
+  {
+    parent = (index - 1) / 2;
+    if (heap->entries[parent]->expires_at <= entry->expires_at)
+      break;
+    heap->entries[index] = heap->entries[parent];
+    heap->entries[index]->expires_index = index;
+    index = parent;
+  }
+
+  heap->entries[index] = entry;
+  entry->expires_index = index;
+}
+
+static void _ht_expires_sift_down(DBExpiresHeap *heap, db_uint_t index)
+{
+  DBHashEntry *entry = heap->entries[index];
+  db_uint_t child;
+
+  while ((child = index * 2 + 1) < heap->size)
+  {
+    if (child + 1 < heap->size && heap->entries[child + 1]->expires_at < heap->entries[child]->expires_at)
+      ++child;
+    if (entry->expires_at <= heap->entries[child]->expires_at)
+      break;
+    heap->entries[index] = heap->entries[child];
+    heap->entries[index]->expires_index = index;
+    index = child;
+  }
+
+  heap->entries[index] = entry;
+  entry->expires_index = index;
+}
 
-  return ht_entry_is_expire(hget(expires_ht, key, NULL), time(NULL));
+static void _ht_expires_push(DBHash *ht, DBHashEntry *entry)
+{
+  if (!ht->expires)
+  {
+    ht->expires = (DBExpiresHeap *)malloc(sizeof(DBExpiresHeap));
+    if (!ht->expires)
+      EXIT_ON_MEMORY_ERROR();
+    ht->expires->size = 0;
+    ht->expires->capacity = HT_EXPIRES_INITIAL_CAPACITY;
+    ht->expires->entries = (DBHashEntry **)malloc(HT_EXPIRES_INITIAL_CAPACITY * sizeof(DBHashEntry *));
+    if (!ht->expires->entries)
+      EXIT_ON_MEMORY_ERROR();
+  }
+
+  DBExpiresHeap *heap = ht->expires;
+
+  if (heap->size == heap->capacity)
+  {
+    heap->capacity *= 2;
+    heap->entries = (DBHashEntry **)realloc(heap->entries, heap->capacity * sizeof(DBHashEntry *));
+    if (!heap->entries)
+      EXIT_ON_MEMORY_ERROR();
+  }
+
+  heap->entries[heap->size] = entry;
+  _ht_expires_sift_up(heap, heap->size++);
+}
+
+static void _ht_expires_delete(DBHash *ht, DBHashEntry *entry)
+{
+  DBExpiresHeap *heap = ht->expires;
+  db_uint_t index = entry->expires_index;
+
+  if (!heap || index >= heap->size || heap->entries[index] != entry)
+    return;
+
+  DBHashEntry *last = heap->entries[--heap->size];
+
+  if (index == heap->size)
+    return;
+
+  heap->entries[index] = last;
+  last->expires_index = index;
+  _ht_expires_sift_down(heap, index);
+  _ht_expires_sift_up(heap, last->expires_index);
 }
 
 DBHash *ht_create()
@@ -261,6 +421,9 @@ DBHash *ht_create()
   ht->count1 = 0;
   ht->buckets1 = NULL;
   _ht_resize_table(ht, 1, 0);
+  ht->expires = NULL;
+  ht->prefix_index = NULL;
+  ht->intern_keys = false;
 
   return ht;
 }
@@ -268,9 +431,37 @@ DBHash *ht_create()
 void ht_free(DBHash *ht)
 {
   _ht_clear(ht);
+  if (ht)
+    radix_free(ht->prefix_index);
   free(ht);
 }
 
+void ht_enable_key_interning(DBHash *ht)
+{
+  if (ht)
+    ht->intern_keys = true;
+}
+
+void ht_enable_prefix_index(DBHash *ht)
+{
+  if (!ht || ht->prefix_index)
+    return;
+
+  DBHashEntry *entry;
+  db_uint_t bucket_index;
+
+  ht->prefix_index = radix_create();
+
+  for (bucket_index = 0; bucket_index < ht->size0; ++bucket_index)
+    for (entry = ht->buckets0[bucket_index]; entry; entry = entry->next)
+      radix_insert(ht->prefix_index, entry->key, entry);
+
+  if (ht_is_rehashing(ht))
+    for (bucket_index = 0; bucket_index < ht->size1; ++bucket_index)
+      for (entry = ht->buckets1[bucket_index]; entry; entry = entry->next)
+        radix_insert(ht->prefix_index, entry->key, entry);
+}
+
 void ht_reset(DBHash *ht)
 {
   if (!ht)
@@ -282,10 +473,7 @@ void ht_reset(DBHash *ht)
 
 static DBHashEntry *_ht_create_entry(char *key)
 {
-  if (!key)
-    return NULL;
-
-  DBHashEntry *entry = (DBHashEntry *)malloc(sizeof(DBHashEntry));
+  DBHashEntry *entry = (DBHashEntry *)dbslab_alloc(sizeof(DBHashEntry));
 
   if (!entry)
     EXIT_ON_MEMORY_ERROR();
@@ -293,26 +481,33 @@ static DBHashEntry *_ht_create_entry(char *key)
   entry->key = key;
   entry->next = NULL;
   entry->data = NULL;
+  entry->expires_at = 0;
+  entry->expires_index = 0;
+  entry->flags = 0;
 
   return entry;
 }
 
-void ht_maintain_expires(DBHash *ht, DBHash *expires_ht, db_uint8_t index)
+db_uint_t ht_maintain_expires(DBHash *ht, db_uint_t max_count)
 {
-  if (!ht || !expires_ht || index >= ht->size0)
-    return;
+  if (!ht || !ht->expires)
+    return 0;
 
-  DBHashEntry *entry = ht->buckets0[index];
-  DBHashEntry *next = NULL;
-  time_t now = time(NULL);
+  db_mstime_t now = dbutil_mstime();
+  db_uint_t deleted_count = 0;
+  DBHashEntry *entry;
 
-  while (entry)
+  while (deleted_count < max_count && ht->expires->size)
   {
-    next = entry->next;
-    if (ht_is_expire(expires_ht, entry->key))
-      hdel(ht, entry->key, expires_ht);
-    entry = next;
+    entry = ht->expires->entries[0];
+    if (!ht_entry_is_expired(entry, now))
+      break;
+    // The entry is expired, so removing it also frees it
+    ht_remove(ht, entry->key);
+    ++deleted_count;
   }
+
+  return deleted_count;
 }
 
 DBHashEntry *ht_create_entry(char *key, DBObj *obj)
@@ -320,13 +515,7 @@ DBHashEntry *ht_create_entry(char *key, DBObj *obj)
   if (!key || !obj)
     return NULL;
 
-  DBHashEntry *entry = (DBHashEntry *)malloc(sizeof(DBHashEntry));
-
-  if (!entry)
-    EXIT_ON_MEMORY_ERROR();
-
-  entry->key = key;
-  entry->next = NULL;
+  DBHashEntry *entry = _ht_create_entry(key);
   entry->data = obj;
 
   return entry;
@@ -340,8 +529,8 @@ DBObj *ht_extract_entry(DBHashEntry *entry)
   DBObj *data = entry->data;
   entry->data = NULL;
 
-  free(entry->key);
-  free(entry);
+  _ht_free_entry_key(entry);
+  dbslab_free(entry, sizeof(DBHashEntry));
 
   return data;
 }
@@ -351,56 +540,135 @@ db_bool_t ht_free_entry(DBHashEntry *entry)
   if (!entry)
     return false;
 
-  free(entry->key);
+  _ht_free_entry_key(entry);
   free_dbobj(entry->data);
-  free(entry);
+  dbslab_free(entry, sizeof(DBHashEntry));
 
   return true;
 }
 
-DBHashEntry *hget(DBHash *ht, const char *key, DBHash *expires_ht)
+static void _ht_set_entry_key(DBHash *ht, DBHashEntry *entry, const char *key)
+{
+  if (ht->intern_keys)
+  {
+    entry->key = (char *)dbobj_intern(key);
+    entry->flags |= DB_ENTRY_FLAG_INTERNED_KEY;
+  }
+  else
+  {
+    entry->key = dbutil_strdup(key);
+    entry->flags &= ~DB_ENTRY_FLAG_INTERNED_KEY;
+  }
+}
+
+static void _ht_free_entry_key(DBHashEntry *entry)
+{
+  if (entry->flags & DB_ENTRY_FLAG_INTERNED_KEY)
+    dbobj_release_interned(entry->key);
+  else
+    free(entry->key);
+  entry->key = NULL;
+}
+
+DBHashEntry *hget(DBHash *ht, const char *key)
 {
   if (!ht || !key)
     return NULL;
 
-  if (ht_is_expire(expires_ht, key))
+  _ht_maintenance(ht);
+
+  DBHashEntry *entry = NULL;
+  db_uint_t hash = murmurhash2(key, strlen(key));
+
+  if (ht_is_rehashing(ht))
+  {
+    entry = ht->buckets1[hash % ht->size1];
+    while (entry && strcmp(entry->key, key) != 0)
+      entry = entry->next;
+  }
+
+  if (!entry)
   {
-    hdel(ht, key, expires_ht);
+    entry = ht->buckets0[hash % ht->size0];
+    while (entry && strcmp(entry->key, key) != 0)
+      entry = entry->next;
+  }
+
+  // The clock is only read for volatile entries
+  if (entry && (entry->flags & DB_ENTRY_FLAG_VOLATILE) && entry->expires_at <= dbutil_mstime())
+  {
+    ht_remove(ht, key);
     return NULL;
   }
 
+  return entry;
+}
+
+void ht_get_many(DBHash *ht, const char **keys, db_uint_t count, DBHashEntry **entries)
+{
+  if (!ht || !keys || !entries)
+    return;
+
   _ht_maintenance(ht);
 
+  db_uint_t hashes[HT_PREFETCH_BATCH];
+  DBHashEntry *heads0[HT_PREFETCH_BATCH], *heads1[HT_PREFETCH_BATCH];
+  db_uint_t batch_start, batch_size, i;
+  db_bool_t rehashing = ht_is_rehashing(ht), has_expired = false;
+  db_mstime_t now = dbutil_mstime();
   DBHashEntry *entry;
 
-  if (ht_is_rehashing(ht))
+  for (batch_start = 0; batch_start < count; batch_start += batch_size)
   {
-    entry = ht->buckets1[murmurhash2(key, strlen(key)) % ht->size1];
-    while (entry)
+    batch_size = count - batch_start < HT_PREFETCH_BATCH ? count - batch_start : HT_PREFETCH_BATCH;
+
+    // hash the whole batch first so the bucket loads overlap instead of stalling one by one
+    for (i = 0; i < batch_size; ++i)
     {
-      if (strcmp(entry->key, key) == 0)
-        return entry;
-      entry = entry->next;
+      hashes[i] = murmurhash2(keys[batch_start + i], strlen(keys[batch_start + i]));
+      __builtin_prefetch(&ht->buckets0[hashes[i] % ht->size0]);
+      if (rehashing)
+        __builtin_prefetch(&ht->buckets1[hashes[i] % ht->size1]);
     }
-  }
 
-  entry = ht->buckets0[murmurhash2(key, strlen(key)) % ht->size0];
-  while (entry)
-  {
-    if (strcmp(entry->key, key) == 0)
-      return entry;
-    entry = entry->next;
+    for (i = 0; i < batch_size; ++i)
+    {
+      heads0[i] = ht->buckets0[hashes[i] % ht->size0];
+      __builtin_prefetch(heads0[i]);
+      heads1[i] = rehashing ? ht->buckets1[hashes[i] % ht->size1] : NULL;
+      __builtin_prefetch(heads1[i]);
+    }
+
+    for (i = 0; i < batch_size; ++i)
+    {
+      entry = heads1[i];
+      while (entry && strcmp(entry->key, keys[batch_start + i]) != 0)
+        entry = entry->next;
+      if (!entry)
+      {
+        entry = heads0[i];
+        while (entry && strcmp(entry->key, keys[batch_start + i]) != 0)
+          entry = entry->next;
+      }
+      if (entry && ht_entry_is_expired(entry, now))
+        entry = NULL, has_expired = true;
+      entries[batch_start + i] = entry;
+    }
   }
 
-  return NULL;
+  // expired entries are deleted after the lookups, so the tables do not change in between
+  if (has_expired)
+    for (i = 0; i < count; ++i)
+      if (!entries[i])
+        hget(ht, keys[i]);
 }
 
-db_bool_t hset(DBHash *ht, const char *key, DBObj *value, DBHash *expires_ht)
+db_bool_t hset(DBHash *ht, const char *key, DBObj *value)
 {
   if (!ht || !key || !value)
     return false;
 
-  DBHashEntry *entry = hget(ht, key, expires_ht);
+  DBHashEntry *entry = hget(ht, key);
 
   if (entry)
   {
@@ -410,124 +678,248 @@ db_bool_t hset(DBHash *ht, const char *key, DBObj *value, DBHash *expires_ht)
   }
   else
   {
-    ht_add(ht, ht_create_entry(dbutil_strdup(key), value));
+    entry = _ht_create_entry(NULL);
+    entry->data = value;
+    _ht_set_entry_key(ht, entry, key);
+    ht_add(ht, entry);
     return true;
   }
 }
 
-DBHashEntry *ht_remove(DBHash *ht, const char *key, DBHash *expires_ht)
+db_bool_t hset_move(DBHash *ht, char *key, DBObj *value)
 {
-  if (!ht || !key)
-    return NULL;
+  if (!ht || !key || !value)
+  {
+    free(key);
+    return false;
+  }
 
-  ht_free_entry(ht_remove(expires_ht, key, NULL));
+  DBHashEntry *entry = hget(ht, key);
 
-  if (ht_is_expire(expires_ht, key))
+  if (entry)
   {
-    ht_free_entry(ht_remove(ht, key, NULL));
-    return NULL;
+    free_dbobj(entry->data);
+    entry->data = value;
+    free(key);
+    return true;
   }
 
+  entry = _ht_create_entry(key);
+  entry->data = value;
+  // interned keys are shared with the pool instead
+  if (ht->intern_keys)
+  {
+    _ht_set_entry_key(ht, entry, key);
+    free(key);
+  }
+  ht_add(ht, entry);
+  return true;
+}
+
+DBHashEntry *ht_remove(DBHash *ht, const char *key)
+{
+  if (!ht || !key)
+    return NULL;
+
   _ht_maintenance(ht);
 
-  DBHashEntry *curr_entry, *prev_entry = NULL;
-  db_uint_t index;
+  DBHashEntry *entry = _ht_unlink(ht, key);
 
-  if (ht_is_rehashing(ht))
-  {
-    index = murmurhash2(key, strlen(key)) % ht->size1;
-    curr_entry = ht->buckets1[index];
-    while (curr_entry)
-    {
-      if (strcmp(curr_entry->key, key) == 0)
-      {
-        if (prev_entry)
-          prev_entry->next = curr_entry->next;
-        else
-          ht->buckets1[index] = curr_entry->next;
-        --ht->count1;
-        return curr_entry;
-      }
-      prev_entry = curr_entry;
-      curr_entry = curr_entry->next;
-    }
-  }
+  if (entry && ht->prefix_index)
+    radix_remove(ht->prefix_index, key);
 
-  index = murmurhash2(key, strlen(key)) % ht->size0;
-  curr_entry = ht->buckets0[index];
-  prev_entry = NULL;
-  while (curr_entry)
+  if (!entry || !(entry->flags & DB_ENTRY_FLAG_VOLATILE))
+    return entry;
+
+  _ht_expires_delete(ht, entry);
+
+  if (entry->expires_at <= dbutil_mstime())
   {
-    if (strcmp(curr_entry->key, key) == 0)
-    {
-      if (prev_entry)
-        prev_entry->next = curr_entry->next;
-      else
-        ht->buckets0[index] = curr_entry->next;
-      --ht->count0;
-      return curr_entry;
-    }
-    prev_entry = curr_entry;
-    curr_entry = curr_entry->next;
+    ht_free_entry(entry);
+    return NULL;
   }
 
-  return NULL;
+  return entry;
 }
 
-db_bool_t hdel(DBHash *ht, const char *key, DBHash *expires_ht)
+db_bool_t hdel(DBHash *ht, const char *key)
 {
   if (!ht || !key)
     return false;
-  return ht_free_entry(ht_remove(ht, key, expires_ht));
+  return ht_free_entry(ht_remove(ht, key));
 }
 
-db_int_t hincrby(DBHash *ht, const char *key, db_int_t value, DBHash *expires_ht)
+db_int_t hincrby(DBHash *ht, const char *key, db_int_t value)
 {
   if (!ht || !key)
     return 0;
 
-  DBHashEntry *entry = hget(ht, key, expires_ht);
+  DBHashEntry *entry = hget(ht, key);
 
   if (!entry)
   {
-    hset(ht, key, dbobj_int_to_string(dbobj_create_int(value)), expires_ht);
+    hset(ht, key, dbobj_create_int_string(value));
     return value;
   }
 
-  dbobj_string_to_int(entry->data);
-  if (!dbobj_is_int(entry->data))
-    return 0;
-
-  entry->data->value.int_value += value;
-  value = entry->data->value.int_value;
-  dbobj_int_to_string(entry->data);
-
-  return value;
+  // the counter stays a native integer, so repeated increments neither format nor allocate
+  db_int_t result;
+  return dbobj_string_incrby(entry->data, value, &result) ? result : 0;
 }
 
-db_bool_t ht_has(DBHash *ht, const char *key, DBHash *expires_ht)
+db_bool_t ht_has(DBHash *ht, const char *key)
 {
-  return hget(ht, key, expires_ht) ? true : false;
+  return hget(ht, key) ? true : false;
 }
 
-db_bool_t ht_rename(DBHash *ht, const char *old_key, const char *new_key, DBHash *expires_ht)
+db_bool_t ht_rename(DBHash *ht, const char *old_key, const char *new_key)
 {
   if (!ht || !old_key || !new_key)
     return false;
 
-  DBHashEntry *entry = ht_remove(ht, old_key, expires_ht);
+  DBHashEntry *entry = ht_remove(ht, old_key);
 
   if (!entry)
     return false;
 
-  free(entry->key);
-  entry->key = dbutil_strdup(new_key);
+  // the renamed entry replaces any entry already stored under the new key
+  hdel(ht, new_key);
+  _ht_free_entry_key(entry);
+  _ht_set_entry_key(ht, entry, new_key);
   ht_add(ht, entry);
 
   return true;
 }
 
-DBList *ht_keys(DBHash *ht, DBHash *expires_ht)
+db_bool_t ht_set_expire(DBHash *ht, const char *key, db_mstime_t expires_at)
+{
+  DBHashEntry *entry = hget(ht, key);
+
+  if (!entry)
+    return false;
+
+  if (entry->flags & DB_ENTRY_FLAG_VOLATILE)
+    _ht_expires_delete(ht, entry);
+
+  entry->flags |= DB_ENTRY_FLAG_VOLATILE;
+  entry->expires_at = expires_at;
+  _ht_expires_push(ht, entry);
+
+  return true;
+}
+
+db_bool_t ht_persist(DBHash *ht, const char *key)
+{
+  DBHashEntry *entry = hget(ht, key);
+
+  if (!entry || !(entry->flags & DB_ENTRY_FLAG_VOLATILE))
+    return false;
+
+  _ht_expires_delete(ht, entry);
+  entry->flags &= ~DB_ENTRY_FLAG_VOLATILE;
+  entry->expires_at = 0;
+
+  return true;
+}
+
+static inline db_uint_t reverse_bits(db_uint_t v)
+{
+  v = ((v >> 1) & 0x55555555) | ((v & 0x55555555) << 1);
+  v = ((v >> 2) & 0x33333333) | ((v & 0x33333333) << 2);
+  v = ((v >> 4) & 0x0F0F0F0F) | ((v & 0x0F0F0F0F) << 4);
+  v = ((v >> 8) & 0x00FF00FF) | ((v & 0x00FF00FF) << 8);
+  return (v >> 16) | (v << 16);
+}
+
+static db_uint_t _ht_scan_bucket(DBHashEntry *entry, db_mstime_t now, DBHashScanFunc callback, void *context)
+{
+  DBHashEntry *next;
+  db_uint_t visited_count = 0;
+  while (entry)
+  {
+    next = entry->next;
+    if (!ht_entry_is_expired(entry, now))
+      callback(entry, context), ++visited_count;
+    entry = next;
+  }
+  return visited_count;
+}
+
+// Visits one bucket group of the cursor and returns the next cursor
+static db_uint_t _ht_scan_step(DBHash *ht, db_uint_t cursor, db_mstime_t now, db_uint_t *visited_count, DBHashScanFunc callback, void *context)
+{
+  // table sizes are always powers of two, so `index % size` equals `index & mask`
+  db_uint_t mask0, mask1;
+  DBHashEntry **small_buckets, **large_buckets;
+
+  if (!ht_is_rehashing(ht))
+  {
+    mask0 = ht->size0 - 1;
+    *visited_count += _ht_scan_bucket(ht->buckets0[cursor & mask0], now, callback, context);
+
+    // increment the reversed cursor over the bits covered by the mask
+    cursor |= ~mask0;
+    cursor = reverse_bits(cursor);
+    ++cursor;
+    return reverse_bits(cursor);
+  }
+
+  if (ht->size0 <= ht->size1)
+  {
+    small_buckets = ht->buckets0, mask0 = ht->size0 - 1;
+    large_buckets = ht->buckets1, mask1 = ht->size1 - 1;
+  }
+  else
+  {
+    small_buckets = ht->buckets1, mask0 = ht->size1 - 1;
+    large_buckets = ht->buckets0, mask1 = ht->size0 - 1;
+  }
+
+  *visited_count += _ht_scan_bucket(small_buckets[cursor & mask0], now, callback, context);
+
+  // visit every bucket of the larger table that expands from the bucket of the smaller table
+  do
+  {
+    *visited_count += _ht_scan_bucket(large_buckets[cursor & mask1], now, callback, context);
+    cursor |= ~mask1;
+    cursor = reverse_bits(cursor);
+    ++cursor;
+    cursor = reverse_bits(cursor);
+  } while (cursor & (mask0 ^ mask1));
+
+  return cursor;
+}
+
+db_uint_t ht_scan(DBHash *ht, db_uint_t cursor, db_uint_t count, DBHashScanFunc callback, void *context)
+{
+  if (!ht || !callback || !ht->size0)
+    return 0;
+
+  db_mstime_t now = dbutil_mstime();
+  db_uint_t visited_count = 0;
+  db_uint_t max_steps = count ? count * HT_SCAN_BUCKETS_PER_COUNT : HT_SCAN_BUCKETS_PER_COUNT;
+
+  do
+    cursor = _ht_scan_step(ht, cursor, now, &visited_count, callback, context);
+  while (cursor && --max_steps && visited_count < count);
+
+  return cursor;
+}
+
+db_uint_t ht_next_cursor(db_uint_t cursor, db_uint_t size)
+{
+  cursor |= ~(size - 1);
+  cursor = reverse_bits(cursor);
+  ++cursor;
+  return reverse_bits(cursor);
+}
+
+db_uint_t ht_hash_key(const char *key)
+{
+  return murmurhash2(key, strlen(key));
+}
+
+DBList *ht_keys(DBHash *ht)
 {
   if (!ht)
     return NULL;
@@ -535,7 +927,7 @@ DBList *ht_keys(DBHash *ht, DBHash *expires_ht)
   DBHashEntry *entry;
   db_uint_t bucket_index;
   DBList *key_list = create_dblist();
-  time_t now = time(NULL);
+  db_mstime_t now = dbutil_mstime();
 
   if (ht->buckets0)
   {
@@ -544,7 +936,7 @@ DBList *ht_keys(DBHash *ht, DBHash *expires_ht)
       entry = ht->buckets0[bucket_index];
       while (entry)
       {
-        if (!ht_is_expire(expires_ht, entry->key))
+        if (!ht_entry_is_expired(entry, now))
           rpush(key_list, create_dblistnode_with_string(entry->key));
         entry = entry->next;
       }
@@ -558,7 +950,7 @@ DBList *ht_keys(DBHash *ht, DBHash *expires_ht)
       entry = ht->buckets1[bucket_index];
       while (entry)
       {
-        if (!ht_is_expire(expires_ht, entry->key))
+        if (!ht_entry_is_expired(entry, now))
           rpush(key_list, create_dblistnode_with_string(entry->key));
         entry = entry->next;
       }
@@ -568,44 +960,53 @@ DBList *ht_keys(DBHash *ht, DBHash *expires_ht)
   return key_list;
 }
 
-#include <stdio.h>
-DBList *ht_match_keys(DBHash *ht, const char *pattern, DBHash *expires_ht)
+typedef struct HTMatchContext
 {
-  if (!ht)
+  const DBGlobPattern *glob;
+  db_mstime_t now;
+  DBList *result;
+} HTMatchContext;
+
+static void _ht_match_entry(DBHashEntry *entry, HTMatchContext *context)
+{
+  if (!ht_entry_is_expired(entry, context->now) && dbutil_glob_match(context->glob, entry->key, strlen(entry->key)))
+    rpush(context->result, create_dblistnode_with_string(entry->key));
+}
+
+static void _ht_match_indexed_entry(void *value, void *context)
+{
+  _ht_match_entry((DBHashEntry *)value, (HTMatchContext *)context);
+}
+
+DBList *ht_match_keys(DBHash *ht, const char *pattern)
+{
+  if (!ht || !pattern)
     return NULL;
 
   DBHashEntry *entry;
   db_uint_t bucket_index;
-  DBList *key_list = create_dblist();
-  time_t now = time(NULL);
+  DBGlobPattern *glob = dbutil_glob_compile(pattern);
+  HTMatchContext context = {glob, dbutil_mstime(), create_dblist()};
+  const char *prefix;
+  db_uint_t prefix_length = dbutil_glob_prefix(glob, &prefix);
 
-  if (ht->buckets0)
+  if (ht->prefix_index && prefix_length)
   {
-    for (bucket_index = 0; bucket_index < ht->size0; ++bucket_index)
-    {
-      entry = ht->buckets0[bucket_index];
-      while (entry)
-      {
-        if (!ht_is_expire(expires_ht, entry->key) && dbutil_match_keys(entry->key, pattern))
-          rpush(key_list, create_dblistnode_with_string(entry->key));
-        entry = entry->next;
-      }
-    }
+    // only the keys sharing the literal prefix of the pattern are visited, in lexicographic order
+    radix_walk_prefix(ht->prefix_index, prefix, prefix_length, _ht_match_indexed_entry, &context);
+    dbutil_glob_free(glob);
+    return context.result;
   }
 
+  for (bucket_index = 0; bucket_index < ht->size0; ++bucket_index)
+    for (entry = ht->buckets0[bucket_index]; entry; entry = entry->next)
+      _ht_match_entry(entry, &context);
+
   if (ht->buckets1)
-  {
     for (bucket_index = 0; bucket_index < ht->size1; ++bucket_index)
-    {
-      entry = ht->buckets1[bucket_index];
-      while (entry)
-      {
-        if (!ht_is_expire(expires_ht, entry->key) && dbutil_match_keys(entry->key, pattern))
-          rpush(key_list, create_dblistnode_with_string(entry->key));
-        entry = entry->next;
-      }
-    }
-  }
+      for (entry = ht->buckets1[bucket_index]; entry; entry = entry->next)
+        _ht_match_entry(entry, &context);
 
-  return key_list;
+  dbutil_glob_free(glob);
+  return context.result;
 }
@@ -1,3 +1,6 @@
+#ifndef DB_HASH_H
+#define DB_HASH_H
+
 #include "types.h"
 
 // Initial size of the hash table
@@ -6,6 +9,15 @@
 #define HT_LOAD_FACTOR_EXPAND 0.7
 // Load factor threshold for shrinking the hash table
 #define HT_LOAD_FACTOR_SHRINK 0.1
+// Maximum number of buckets visited by `ht_scan` per requested entry
+#define HT_SCAN_BUCKETS_PER_COUNT 10
+// Initial capacity of the expires heap
+#define HT_EXPIRES_INITIAL_CAPACITY 16
+// Number of keys hashed and prefetched together by `ht_get_many`
+#define HT_PREFETCH_BATCH 16
+
+// Called for each live entry visited by `ht_scan`, must not modify the table
+typedef void (*DBHashScanFunc)(DBHashEntry *entry, void *context);
 
 // Seed for the hash function, affecting hash distribution
 extern db_uint_t hash_seed;
@@ -18,7 +30,16 @@ void ht_free(DBHash *ht);
 
 void ht_reset(DBHash *ht);
 
-void ht_maintain_expires(DBHash *ht, DBHash *expires_ht, db_uint8_t index);
+// Shares the keys added from now on through the intern pool, for tables whose keys repeat across tables
+void ht_enable_key_interning(DBHash *ht);
+
+// Maintains an ordered index of the keys, so `ht_match_keys` only visits the keys
+// sharing the literal prefix of the pattern; costs one radix tree node per key
+void ht_enable_prefix_index(DBHash *ht);
+
+// Deletes at most `max_count` expired entries, earliest expiration first
+// Returns the number of deleted entries
+db_uint_t ht_maintain_expires(DBHash *ht, db_uint_t max_count);
 
 DBHashEntry *ht_create_entry(char *key, DBObj *obj);
 
@@ -26,22 +47,52 @@ DBObj *ht_extract_entry(DBHashEntry *entry);
 
 db_bool_t ht_free_entry(DBHashEntry *entry);
 
-// Retrieves an entry by key; returns NULL if not found
-DBHashEntry *hget(DBHash *ht, const char *key, DBHash *expires_ht);
+// Retrieves an entry by key; returns NULL if not found or expired
+DBHashEntry *hget(DBHash *ht, const char *key);
+
+// Looks up `count` keys at once, storing the entry of each key (NULL if not found or expired) in `entries`
+// The buckets of a batch of keys are prefetched together to hide the cache misses on large tables
+void ht_get_many(DBHash *ht, const char **keys, db_uint_t count, DBHashEntry **entries);
+
+db_bool_t hset(DBHash *ht, const char *key, DBObj *value);
+
+// Same as `hset`, taking ownership of `key`: a new entry keeps it, otherwise it is freed
+db_bool_t hset_move(DBHash *ht, char *key, DBObj *value);
+
+// Removes an entry by key; returns NULL if not found or expired
+// The expiration time is kept on the returned entry and restored when it is added back
+DBHashEntry *ht_remove(DBHash *ht, const char *key);
+
+db_bool_t hdel(DBHash *ht, const char *key);
+
+db_int_t hincrby(DBHash *ht, const char *key, db_int_t value);
+
+db_bool_t ht_has(DBHash *ht, const char *key);
+
+db_bool_t ht_rename(DBHash *ht, const char *old_key, const char *new_key);
 
-db_bool_t hset(DBHash *ht, const char *key, DBObj *value, DBHash *expires_ht);
+// Sets the absolute expiration time (in milliseconds) of a key; returns false if not found
+db_bool_t ht_set_expire(DBHash *ht, const char *key, db_mstime_t expires_at);
 
-// Removes an entry by key; returns NULL if not found
-DBHashEntry *ht_remove(DBHash *ht, const char *key, DBHash *expires_ht);
+// Removes the expiration time of a key; returns false if not found or not volatile
+db_bool_t ht_persist(DBHash *ht, const char *key);
 
-db_bool_t hdel(DBHash *ht, const char *key, DBHash *expires_ht);
+// Visits buckets starting from `cursor` until about `count` entries have been visited
+// Returns the next cursor, or 0 when the whole table has been visited
+// The cursor is incremented in reverse binary order, so every entry present during the whole
+// iteration is visited at least once, even if the table is resized between calls
+db_uint_t ht_scan(DBHash *ht, db_uint_t cursor, db_uint_t count, DBHashScanFunc callback, void *context);
 
-db_int_t hincrby(DBHash *ht, const char *key, db_int_t value, DBHash *expires_ht);
+// Advances a scan cursor over a table of `size` buckets, `size` being a power of two
+// Also used by the structures that keep their own buckets, so they can be scanned like a table
+db_uint_t ht_next_cursor(db_uint_t cursor, db_uint_t size);
 
-db_bool_t ht_has(DBHash *ht, const char *key, DBHash *expires_ht);
+// Hashes a key with the seeded hash function of the tables
+db_uint_t ht_hash_key(const char *key);
 
-db_bool_t ht_rename(DBHash *ht, const char *old_key, const char *new_key, DBHash *expires_ht);
+DBList *ht_keys(DBHash *ht);
 
-DBList *ht_keys(DBHash *ht, DBHash *expires_ht);
+// Lists the keys matching a glob pattern, using the prefix index if it is enabled
+DBList *ht_match_keys(DBHash *ht, const char *pattern);
 
-DBList *ht_match_keys(DBHash *ht, const char *pattern, DBHash *expires_ht);
+#endif
@@ -1,9 +1,13 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
 
 #include "utils.h"
 #include "obj.h"
 #include "list.h"
+#include "arena.h"
 #include "interaction.h"
 
 DBRequest *create_request(db_action_t action)
@@ -13,6 +17,7 @@ DBRequest *create_request(db_action_t action)
     EXIT_ON_MEMORY_ERROR();
   request->action = action;
   request->args = NULL;
+  request->arena.chunks = NULL;
   return request;
 };
 
@@ -44,6 +49,18 @@ void add_request_arg(DBRequest *request, DBObj *arg)
   }
 };
 
+void add_request_string_arg(DBRequest *request, const char *value)
+{
+  if (!request)
+    return;
+  add_request_arg(request, dbobj_create_arena_string(value ? arena_strndup(&request->arena, value, strlen(value)) : NULL));
+}
+
+void add_request_moved_string_arg(DBRequest *request, const char *value)
+{
+  add_request_arg(request, dbobj_create_string_with_dup(value));
+}
+
 DBRequest *reset_request(DBRequest *request, db_action_t action)
 {
   if (!request)
@@ -54,6 +71,7 @@ DBRequest *reset_request(DBRequest *request, db_action_t action)
     free_dblist(request->args);
     request->args = NULL;
   }
+  arena_release(&request->arena);
   return request;
 };
 
@@ -63,6 +81,7 @@ void free_request(DBRequest *request)
     return;
 
   free_dblist(request->args);
+  arena_release(&request->arena);
   free(request);
 };
 
@@ -95,7 +114,10 @@ DBObj *print_dbobj(DBObj *obj)
     printf("(bool) %s\n", obj->value.bool_value ? "true" : "false");
     break;
   case DB_TYPE_INT:
-    printf("(int) %lu\n", obj->value.uint_value);
+    printf("(int) %d\n", obj->value.int_value);
+    break;
+  case DB_TYPE_DOUBLE:
+    printf("(double) %.15g\n", obj->value.double_value);
     break;
   case DB_TYPE_UINT:
     printf("(uint) %lu\n", obj->value.uint_value);
@@ -132,6 +154,21 @@ DBObj *print_dbobj(DBObj *obj)
       case DB_TYPE_UINT:
         printf("  %u) %lu\n", i, node->data->value.uint_value);
         break;
+      case DB_TYPE_LIST:
+        // nested lists, such as the replies of MLRANGE, are printed inline
+        printf("  %u) (list) length: %u\n", i, node->data->value.list->length);
+        db_uint_t j = 0;
+        DBListNode *child = node->data->value.list->head;
+        while (child)
+        {
+          ++j;
+          if (dbobj_is_string(child->data))
+            printf("     %u) \"%s\"\n", j, child->data->value.string);
+          else
+            printf("     %u) (nil)\n", j);
+          child = child->next;
+        }
+        break;
       default:
         printf("  %u) Unknown List Node", i);
         break;
@@ -140,7 +177,7 @@ DBObj *print_dbobj(DBObj *obj)
     }
     break;
   default:
-    printf("(unknown) type=%lu\n", obj->type);
+    printf("(unknown) type=%u\n", (unsigned)obj->type);
     break;
   }
 
@@ -205,3 +242,112 @@ db_int_t get_int_arg(DBListNode *curr_node)
     return curr_node->data->value.int_value;
   return 0;
 }
+
+db_double_t get_double_arg(DBListNode *curr_node)
+{
+  if (!curr_node || !curr_node->data)
+    return 0;
+  if (dbobj_is_string(curr_node->data))
+    dbobj_string_to_double(curr_node->data);
+  if (dbobj_is_int(curr_node->data))
+    return curr_node->data->value.int_value;
+  if (dbobj_is_double(curr_node->data))
+    return curr_node->data->value.double_value;
+  return 0;
+}
+
+db_bool_t parse_uint_arg(DBListNode *curr_node, db_uint_t *value)
+{
+  if (!curr_node || !curr_node->data)
+    return false;
+
+  DBObj *obj = curr_node->data;
+  if (dbobj_is_uint(obj))
+    *value = obj->value.uint_value;
+  else if (dbobj_is_int(obj) && obj->value.int_value >= 0)
+    *value = (db_uint_t)obj->value.int_value;
+  else if (dbobj_is_string(obj))
+  {
+    char buffer[DBOBJ_NUMBER_BUFFER_SIZE], *end;
+    const char *string = dbobj_string_view(obj, buffer);
+    // digits only, strtoul would take a sign
+    if (!string || *string < '0' || *string > '9')
+      return false;
+    errno = 0;
+    unsigned long parsed = strtoul(string, &end, 10);
+    if (*end || errno == ERANGE || parsed > DB_UINT_MAX)
+      return false;
+    *value = (db_uint_t)parsed;
+  }
+  else
+    return false;
+
+  return true;
+}
+
+db_bool_t parse_int_arg(DBListNode *curr_node, db_int_t *value)
+{
+  if (!curr_node || !curr_node->data)
+    return false;
+
+  DBObj *obj = curr_node->data;
+  if (dbobj_is_int(obj))
+    *value = obj->value.int_value;
+  else if (dbobj_is_uint(obj) && obj->value.uint_value <= INT32_MAX)
+    *value = (db_int_t)obj->value.uint_value;
+  else
+    return dbobj_string_get_int(obj, value);
+
+  return true;
+}
+
+db_bool_t parse_double_arg(DBListNode *curr_node, db_double_t *value)
+{
+  if (!curr_node || !curr_node->data)
+    return false;
+
+  DBObj *obj = curr_node->data;
+  if (dbobj_is_int(obj))
+    *value = obj->value.int_value;
+  else if (dbobj_is_uint(obj))
+    *value = obj->value.uint_value;
+  else if (dbobj_is_double(obj))
+    *value = obj->value.double_value;
+  else if (dbobj_is_string(obj))
+  {
+    char buffer[DBOBJ_NUMBER_BUFFER_SIZE], *end;
+    const char *string = dbobj_string_view(obj, buffer);
+    if (!string || !*string || *string == ' ')
+      return false;
+    *value = strtod(string, &end);
+    if (*end)
+      return false;
+  }
+  else
+    return false;
+
+  return !isnan(*value);
+}
+
+DBObj *take_string_arg(DBListNode *curr_node)
+{
+  char *string = get_string_arg(curr_node);
+  if (!string)
+    return NULL;
+  if (curr_node->data->encoding != DB_ENC_DEFAULT || dbobj_is_shared(curr_node->data))
+    return dbobj_create_string_with_dup(string);
+  DBObj *obj = curr_node->data;
+  curr_node->data = NULL;
+  return obj;
+}
+
+char *take_string_arg_chars(DBListNode *curr_node)
+{
+  char *string = get_string_arg(curr_node);
+  if (!string)
+    return NULL;
+  if (curr_node->data->encoding != DB_ENC_DEFAULT || dbobj_is_shared(curr_node->data))
+    return dbutil_strdup(string);
+  curr_node->data->value.string = NULL;
+  return string;
+}
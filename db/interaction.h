@@ -11,6 +11,11 @@ DBReply *create_reply();
 
 void add_request_arg(DBRequest *request, DBObj *arg);
 
+// Adds a string argument, copied into the arena of the request instead of its own allocation
+void add_request_string_arg(DBRequest *request, const char *value);
+// Adds a string argument in its own allocation, for values the handler moves into the database
+void add_request_moved_string_arg(DBRequest *request, const char *value);
+
 DBRequest *reset_request(DBRequest *request, db_action_t action);
 
 void free_request(DBRequest *request);
@@ -28,5 +33,18 @@ DBReply *reply_data(DBReply *reply, DBObj *data);
 char *get_string_arg(DBListNode *curr_node);
 db_uint_t get_uint_arg(DBListNode *curr_node);
 db_int_t get_int_arg(DBListNode *curr_node);
+db_double_t get_double_arg(DBListNode *curr_node);
+
+// Strict forms of the number getters, false unless the argument is a number as a whole
+// Strings are only read, so the argument keeps its encoding
+db_bool_t parse_uint_arg(DBListNode *curr_node, db_uint_t *value);
+db_bool_t parse_int_arg(DBListNode *curr_node, db_int_t *value);
+db_bool_t parse_double_arg(DBListNode *curr_node, db_double_t *value);
+
+// Takes a string argument out of the request, so a handler can store it without copying it
+// Arguments the request does not own on their own, such as arena strings, are copied; NULL if not a string
+DBObj *take_string_arg(DBListNode *curr_node);
+// Same as `take_string_arg`, returning only the characters
+char *take_string_arg_chars(DBListNode *curr_node);
 
 #endif
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "utils.h"
 #include "obj.h"
 #include "list.h"
+#include "slab.h"
 
 DBList *duplicate_string_dblist(DBList *list)
 {
@@ -18,7 +19,7 @@ DBList *duplicate_string_dblist(DBList *list)
 
 DBListNode *create_dblistnode(DBObj *data)
 {
-  DBListNode *node = malloc(sizeof(DBListNode));
+  DBListNode *node = dbslab_alloc(sizeof(DBListNode));
   if (!node)
     EXIT_ON_MEMORY_ERROR();
   node->data = data;
@@ -50,7 +51,7 @@ void free_dblistnode(DBListNode *node)
   break_dblistnodes(node, node->next);
   break_dblistnodes(node->prev, node);
   free_dbobj(node->data);
-  free(node);
+  dbslab_free(node, sizeof(DBListNode));
 }
 
 char *extract_dblistnode_string(DBListNode *node)
@@ -0,0 +1,168 @@
+#include <string.h>
+
+#include "utils.h"
+#include "listpack.h"
+
+// Bytes taken by a string of `length` bytes: the length byte, the bytes and the terminator
+#define LP_STRING_SIZE(length) ((length) + 2)
+
+// Returns the entry of `field`, or NULL if not found
+static unsigned char *_lp_find(DBListpack *lp, const char *field, db_uint_t field_length)
+{
+  unsigned char *p = lp->entries, *end = lp->entries + lp->size;
+
+  while (p < end)
+  {
+    // the length byte rejects most fields without touching their bytes
+    if (p[0] == field_length && memcmp(p + 1, field, field_length) == 0)
+      return p;
+    p += LP_STRING_SIZE(p[0]);
+    p += LP_STRING_SIZE(p[0]);
+  }
+
+  return NULL;
+}
+
+static void _lp_resize(DBListpack *lp, db_uint_t size)
+{
+  if (!size)
+  {
+    free(lp->entries);
+    lp->entries = NULL;
+    lp->size = 0;
+    return;
+  }
+
+  lp->entries = (unsigned char *)realloc(lp->entries, size);
+  if (!lp->entries)
+    EXIT_ON_MEMORY_ERROR();
+  lp->size = size;
+}
+
+static unsigned char *_lp_write_string(unsigned char *p, const char *string, db_uint_t length)
+{
+  p[0] = (unsigned char)length;
+  memcpy(p + 1, string, length);
+  p[length + 1] = '\0';
+  return p + LP_STRING_SIZE(length);
+}
+
+DBListpack *lp_create()
+{
+  DBListpack *lp = (DBListpack *)malloc(sizeof(DBListpack));
+
+  if (!lp)
+    EXIT_ON_MEMORY_ERROR();
+
+  lp->length = 0;
+  lp->size = 0;
+  lp->entries = NULL;
+
+  return lp;
+}
+
+void lp_free(DBListpack *lp)
+{
+  if (!lp)
+    return;
+
+  free(lp->entries);
+  free(lp);
+}
+
+const char *lp_get(DBListpack *lp, const char *field)
+{
+  if (!lp || !field)
+    return NULL;
+
+  unsigned char *p = _lp_find(lp, field, strlen(field));
+
+  if (!p)
+    return NULL;
+
+  p += LP_STRING_SIZE(p[0]);
+  return (const char *)(p + 1);
+}
+
+db_bool_t lp_set(DBListpack *lp, const char *field, const char *value)
+{
+  if (!lp || !field || !value)
+    return false;
+
+  db_uint_t field_length = strlen(field), value_length = strlen(value);
+
+  if (field_length > LP_MAX_STRING_LENGTH || value_length > LP_MAX_STRING_LENGTH)
+    EXIT_ON_ERROR("Listpack string is too long");
+
+  unsigned char *p = _lp_find(lp, field, field_length);
+
+  if (!p)
+  {
+    db_uint_t offset = lp->size;
+    _lp_resize(lp, lp->size + LP_STRING_SIZE(field_length) + LP_STRING_SIZE(value_length));
+    p = _lp_write_string(lp->entries + offset, field, field_length);
+    _lp_write_string(p, value, value_length);
+    ++lp->length;
+    return true;
+  }
+
+  p += LP_STRING_SIZE(field_length);
+  db_uint_t old_length = p[0];
+
+  if (old_length != value_length)
+  {
+    // move the following pairs so the new value fits in place
+    db_uint_t offset = p - lp->entries;
+    db_uint_t tail_offset = offset + LP_STRING_SIZE(old_length);
+    db_uint_t tail_size = lp->size - tail_offset;
+    db_uint_t new_size = lp->size - old_length + value_length;
+
+    if (value_length > old_length)
+      _lp_resize(lp, new_size);
+    memmove(lp->entries + offset + LP_STRING_SIZE(value_length), lp->entries + tail_offset, tail_size);
+    if (value_length < old_length)
+      _lp_resize(lp, new_size);
+    p = lp->entries + offset;
+  }
+
+  _lp_write_string(p, value, value_length);
+  return false;
+}
+
+db_bool_t lp_del(DBListpack *lp, const char *field)
+{
+  if (!lp || !field)
+    return false;
+
+  unsigned char *p = _lp_find(lp, field, strlen(field));
+
+  if (!p)
+    return false;
+
+  db_uint_t offset = p - lp->entries;
+  db_uint_t pair_size = LP_STRING_SIZE(p[0]);
+  pair_size += LP_STRING_SIZE(p[pair_size]);
+
+  memmove(p, p + pair_size, lp->size - offset - pair_size);
+  _lp_resize(lp, lp->size - pair_size);
+  --lp->length;
+
+  return true;
+}
+
+void lp_foreach(DBListpack *lp, DBListpackFunc callback, void *context)
+{
+  if (!lp || !callback)
+    return;
+
+  unsigned char *p = lp->entries, *end = lp->entries + lp->size;
+  const char *field;
+
+  while (p < end)
+  {
+    field = (const char *)(p + 1);
+    p += LP_STRING_SIZE(p[0]);
+    callback(field, (const char *)(p + 1), context);
+    p += LP_STRING_SIZE(p[0]);
+  }
+}
@@ -0,0 +1,30 @@
+#ifndef DB_LISTPACK_H
+#define DB_LISTPACK_H
+
+#include "types.h"
+
+// Maximum length of a field or a value stored in a listpack
+#define LP_MAX_STRING_LENGTH 255
+
+// Called for each field/value pair by `lp_foreach`, must not modify the listpack
+typedef void (*DBListpackFunc)(const char *field, const char *value, void *context);
+
+DBListpack *lp_create();
+
+void lp_free(DBListpack *lp);
+
+// Retrieves the value of a field, pointing into the listpack; returns NULL if not found
+// The pointer is invalidated by the next modification of the listpack
+const char *lp_get(DBListpack *lp, const char *field);
+
+// Sets the value of a field, strings must not be longer than LP_MAX_STRING_LENGTH
+// Returns true if the field is new
+db_bool_t lp_set(DBListpack *lp, const char *field, const char *value);
+
+// Removes a field; returns false if not found
+db_bool_t lp_del(DBListpack *lp, const char *field);
+
+// Calls `callback` for each field/value pair in insertion order
+void lp_foreach(DBListpack *lp, DBListpackFunc callback, void *context);
+
+#endif
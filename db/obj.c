@@ -1,12 +1,51 @@
 #include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <stdatomic.h>
+#include <threads.h>
 
 #include "types.h"
 #include "utils.h"
+#include "obj.h"
 #include "list.h"
 #include "zset.h"
+#include "hash.h"
+#include "listpack.h"
+#include "quicklist.h"
+#include "slab.h"
+#include "arena.h"
 
 static DBObj *_dbobj_create(db_type_t type);
-static void *_dbobj_extract_pointer(DBObj *obj);
+static void _dbobj_free_string(DBObj *obj);
+static void _dbobj_init_shared_integers();
+static DBArenaNumber *_dbobj_arena_number(DBObj *obj);
+static db_bool_t _dbobj_parse_int(const char *string, db_int_t *value);
+static db_bool_t _dbobj_parse_double(const char *string, db_double_t *value);
+
+// Initial number of slots of the intern pool
+#define INTERN_POOL_INITIAL_SIZE 64
+
+// Interned strings are allocated with their reference count in front of the characters
+typedef struct DBInternedString
+{
+  db_uint_t refcount;
+  db_uint_t hash;
+  char chars[];
+} DBInternedString;
+
+// Open addressing table with linear probing, its size is always a power of two
+static DBInternedString **intern_slots = NULL;
+static db_uint_t intern_size = 0;
+static db_uint_t intern_count = 0;
+
+// Shared replies, immortal so that freeing them does nothing
+static DBObj shared_ok = {.type = DB_TYPE_STRING, .refcount = DBOBJ_REFCOUNT_IMMORTAL, .value.string = "OK"};
+static DBObj shared_null = {.type = DB_TYPE_NULL, .refcount = DBOBJ_REFCOUNT_IMMORTAL};
+static DBObj shared_ints[DBOBJ_SHARED_INTEGERS];
+static DBObj shared_uints[DBOBJ_SHARED_INTEGERS];
+static once_flag shared_integers_once = ONCE_FLAG_INIT;
 
 db_bool_t dbobj_is_null(DBObj *obj)
 {
@@ -107,6 +146,85 @@ DBObj *dbobj_create_string_with_dup(const char *value)
   return obj;
 }
 
+DBObj *dbobj_create_int_string(db_int_t value)
+{
+  DBObj *obj = _dbobj_create(DB_TYPE_STRING);
+  obj->encoding = DB_ENC_INT;
+  obj->value.int_value = value;
+  return obj;
+}
+
+DBObj *dbobj_create_double_string(db_double_t value)
+{
+  DBObj *obj = _dbobj_create(DB_TYPE_STRING);
+  obj->encoding = DB_ENC_DOUBLE;
+  obj->value.double_value = value;
+  return obj;
+}
+
+DBObj *dbobj_create_arena_string(char *value)
+{
+  DBObj *obj = _dbobj_create(DB_TYPE_STRING);
+  obj->encoding = DB_ENC_ARENA;
+  obj->value.string = value;
+  return obj;
+}
+
+DBObj *dbobj_create_arena_number(DBArena *arena, const char *token, size_t length)
+{
+  char first = length ? token[0] : '\0';
+  if (!(first >= '0' && first <= '9') && first != '-' && first != '+' && first != '.')
+    return NULL;
+
+  // the values are those strtol and strtod give, so converting the argument later does not change
+  char *end;
+  errno = 0;
+  long int_value = strtol(token, &end, 10);
+  db_bool_t is_int = end == token + length && !errno && int_value >= INT32_MIN && int_value <= INT32_MAX;
+  db_double_t double_value = is_int ? (db_double_t)int_value : strtod(token, &end);
+  if (end != token + length)
+    return NULL;
+
+  DBArenaNumber *number = (DBArenaNumber *)arena_alloc(arena, sizeof(DBArenaNumber) + length + 1);
+  number->double_value = double_value;
+  number->int_value = is_int ? (db_int_t)int_value : 0;
+  number->is_int = is_int;
+  memcpy(number->text, token, length);
+  number->text[length] = '\0';
+
+  DBObj *obj = _dbobj_create(DB_TYPE_STRING);
+  obj->encoding = DB_ENC_ARENA_NUMBER;
+  obj->value.string = number->text;
+  return obj;
+}
+
+DBObj *dbobj_init_static_string(DBObj *obj, const char *value)
+{
+  obj->type = DB_TYPE_STRING;
+  obj->encoding = DB_ENC_ARENA;
+  atomic_init(&obj->refcount, DBOBJ_REFCOUNT_IMMORTAL);
+  obj->value.string = (char *)value;
+  return obj;
+}
+
+DBObj *dbobj_init_static_int(DBObj *obj, db_int_t value)
+{
+  obj->type = DB_TYPE_INT;
+  obj->encoding = DB_ENC_DEFAULT;
+  atomic_init(&obj->refcount, DBOBJ_REFCOUNT_IMMORTAL);
+  obj->value.int_value = value;
+  return obj;
+}
+
+DBObj *dbobj_init_static_uint(DBObj *obj, db_uint_t value)
+{
+  obj->type = DB_TYPE_UINT;
+  obj->encoding = DB_ENC_DEFAULT;
+  atomic_init(&obj->refcount, DBOBJ_REFCOUNT_IMMORTAL);
+  obj->value.uint_value = value;
+  return obj;
+}
+
 DBObj *dbobj_create_list(DBList *value)
 {
   DBObj *obj = _dbobj_create(DB_TYPE_LIST);
@@ -114,6 +232,14 @@ DBObj *dbobj_create_list(DBList *value)
   return obj;
 }
 
+DBObj *dbobj_create_quicklist(DBQuicklist *value)
+{
+  DBObj *obj = _dbobj_create(DB_TYPE_LIST);
+  obj->encoding = DB_ENC_QUICKLIST;
+  obj->value.quicklist = value;
+  return obj;
+}
+
 DBObj *dbobj_create_zset(DBZSet *value)
 {
   DBObj *obj = _dbobj_create(DB_TYPE_ZSET);
@@ -128,6 +254,14 @@ DBObj *dbobj_create_hash(DBHash *value)
   return obj;
 }
 
+DBObj *dbobj_create_listpack_hash(DBListpack *value)
+{
+  DBObj *obj = _dbobj_create(DB_TYPE_HASH);
+  obj->encoding = DB_ENC_LISTPACK;
+  obj->value.listpack = value;
+  return obj;
+}
+
 DBObj *_dbobj_create_zsetele(DBZSetElement *value)
 {
   DBObj *obj = _dbobj_create(DB_TYPE_ZSETELE);
@@ -139,19 +273,34 @@ void free_dbobj(DBObj *obj)
 {
   if (!obj)
     return;
+  db_uint_t refcount = atomic_load(&obj->refcount);
+  if (refcount == DBOBJ_REFCOUNT_IMMORTAL)
+    return;
+  // a sole owner cannot race with anyone, so the atomic decrement is only paid by shared objects
+  if (refcount != 1 && atomic_fetch_sub(&obj->refcount, 1) != 1)
+    return;
   switch (obj->type)
   {
+  case DB_TYPE_ERROR:
+    free(obj->value.message);
+    break;
   case DB_TYPE_STRING:
-    free(obj->value.string);
+    _dbobj_free_string(obj);
     break;
   case DB_TYPE_LIST:
-    free_dblist(obj->value.list);
+    if (obj->encoding == DB_ENC_QUICKLIST)
+      quicklist_free(obj->value.quicklist);
+    else
+      free_dblist(obj->value.list);
     break;
   case DB_TYPE_ZSET:
     free_dbzset(obj->value.zset);
     break;
   case DB_TYPE_HASH:
-    // free_dbhash(obj->value.hash);
+    if (obj->encoding == DB_ENC_LISTPACK)
+      lp_free(obj->value.listpack);
+    else
+      ht_free(obj->value.hash);
     break;
   case DB_TYPE_ZSETELE:
     // skip, this will process in zset module
@@ -159,7 +308,67 @@ void free_dbobj(DBObj *obj)
   default:
     break;
   }
-  free(obj);
+  dbslab_free(obj, sizeof(DBObj));
+}
+
+DBObj *dbobj_retain(DBObj *obj)
+{
+  if (obj && atomic_load(&obj->refcount) != DBOBJ_REFCOUNT_IMMORTAL)
+    atomic_fetch_add(&obj->refcount, 1);
+  return obj;
+}
+
+db_bool_t dbobj_is_shared(DBObj *obj)
+{
+  return atomic_load(&obj->refcount) != 1;
+}
+
+DBObj *dbobj_dup_string(DBObj *obj)
+{
+  switch (obj->encoding)
+  {
+  case DB_ENC_INT:
+    return dbobj_create_int_string(obj->value.int_value);
+  case DB_ENC_DOUBLE:
+    return dbobj_create_double_string(obj->value.double_value);
+  default:
+    return dbobj_create_string_with_dup(obj->value.string);
+  }
+}
+
+DBObj *dbobj_shared_ok()
+{
+  return &shared_ok;
+}
+
+DBObj *dbobj_shared_null()
+{
+  return &shared_null;
+}
+
+static void _dbobj_init_shared_integers()
+{
+  for (db_uint_t i = 0; i < DBOBJ_SHARED_INTEGERS; i++)
+  {
+    shared_ints[i] = (DBObj){.type = DB_TYPE_INT, .refcount = DBOBJ_REFCOUNT_IMMORTAL, .value.int_value = (db_int_t)i};
+    shared_uints[i] = (DBObj){.type = DB_TYPE_UINT, .refcount = DBOBJ_REFCOUNT_IMMORTAL, .value.uint_value = i};
+  }
+}
+
+DBObj *dbobj_shared_int(db_int_t value)
+{
+  if (value < 0 || value >= DBOBJ_SHARED_INTEGERS)
+    return dbobj_create_int(value);
+  call_once(&shared_integers_once, _dbobj_init_shared_integers);
+  return &shared_ints[value];
+}
+
+DBObj *dbobj_shared_uint(db_uint_t value)
+{
+  if (value >= DBOBJ_SHARED_INTEGERS)
+    return dbobj_create_uint(value);
+  call_once(&shared_integers_once, _dbobj_init_shared_integers);
+  return &shared_uints[value];
 }
 
 void *dbobj_extract_null(DBObj *obj)
@@ -169,7 +378,12 @@ void *dbobj_extract_null(DBObj *obj)
 }
 char *dbobj_extract_error(DBObj *obj)
 {
-  return dbobj_is_error(obj) ? _dbobj_extract_pointer(obj) : NULL;
+  if (!dbobj_is_error(obj))
+    return NULL;
+  char *message = obj->value.message;
+  obj->value.message = NULL;
+  free_dbobj(obj);
+  return message;
 }
 db_bool_t dbobj_extract_bool(DBObj *obj)
 {
@@ -199,13 +413,17 @@ char *dbobj_extract_string(DBObj *obj)
 {
   if (!dbobj_is_string(obj))
     return free_dbobj(obj), NULL;
-  char *string = obj->value.string;
-  obj->value.string = NULL;
+  // the caller owns the returned string, so shared, arena and number encoded strings are copied
+  char buffer[DBOBJ_NUMBER_BUFFER_SIZE];
+  db_bool_t steal = obj->encoding == DB_ENC_DEFAULT && !dbobj_is_shared(obj);
+  char *string = steal ? obj->value.string : dbutil_strdup(dbobj_string_view(obj, buffer));
+  if (steal)
+    obj->value.string = NULL;
   return free_dbobj(obj), string;
 }
 DBList *dbobj_extract_list(DBObj *obj)
 {
-  if (!dbobj_is_list(obj))
+  if (!dbobj_is_list(obj) || obj->encoding != DB_ENC_DEFAULT)
     return free_dbobj(obj), NULL;
   DBList *list = obj->value.list;
   obj->value.list = NULL;
@@ -221,7 +439,7 @@ DBZSet *dbobj_extract_zset(DBObj *obj)
 }
 DBHash *dbobj_extract_hash(DBObj *obj)
 {
-  if (!dbobj_is_hash(obj))
+  if (!dbobj_is_hash(obj) || obj->encoding != DB_ENC_DEFAULT)
     return free_dbobj(obj), NULL;
   DBHash *hash = obj->value.hash;
   obj->value.hash = NULL;
@@ -238,18 +456,282 @@ DBZSetElement *_dbobj_extract_zsetele(DBObj *obj)
 
 static DBObj *_dbobj_create(db_type_t type)
 {
-  DBObj *obj = malloc(sizeof(DBObj));
+  DBObj *obj = dbslab_alloc(sizeof(DBObj));
   if (!obj)
     EXIT_ON_MEMORY_ERROR();
   obj->type = type;
+  obj->encoding = DB_ENC_DEFAULT;
+  atomic_init(&obj->refcount, 1);
   return obj;
 }
 
-static void *_dbobj_extract_pointer(DBObj *obj)
+static void _dbobj_free_string(DBObj *obj)
 {
-  void *pointer = obj->value._pointer;
-  free_dbobj(obj);
-  return pointer;
+  if (obj->encoding == DB_ENC_DEFAULT)
+    free(obj->value.string);
+  obj->encoding = DB_ENC_DEFAULT;
+  obj->value.string = NULL;
+}
+
+// FNV-1a, unseeded so the pool does not depend on the hash seed of the tables
+static db_uint_t _dbobj_intern_hash(const char *string, db_uint_t length)
+{
+  db_uint_t hash = 2166136261u;
+  for (db_uint_t i = 0; i < length; ++i)
+    hash = (hash ^ (unsigned char)string[i]) * 16777619u;
+  return hash;
+}
+
+static inline DBInternedString *_dbobj_interned_header(const char *string)
+{
+  return (DBInternedString *)(string - offsetof(DBInternedString, chars));
+}
+
+static void _dbobj_intern_pool_resize(db_uint_t new_size)
+{
+  DBInternedString **old_slots = intern_slots;
+  db_uint_t old_size = intern_size, i, index;
+
+  intern_slots = (DBInternedString **)calloc(new_size, sizeof(DBInternedString *));
+  if (!intern_slots)
+    EXIT_ON_MEMORY_ERROR();
+  intern_size = new_size;
+
+  for (i = 0; i < old_size; ++i)
+  {
+    if (!old_slots[i])
+      continue;
+    index = old_slots[i]->hash & (new_size - 1);
+    while (intern_slots[index])
+      index = (index + 1) & (new_size - 1);
+    intern_slots[index] = old_slots[i];
+  }
+
+  free(old_slots);
+}
+
+const char *dbobj_intern(const char *string)
+{
+  if (!string)
+    return NULL;
+
+  if (intern_count >= HT_LOAD_FACTOR_EXPAND * intern_size)
+    _dbobj_intern_pool_resize(intern_size ? intern_size * 2 : INTERN_POOL_INITIAL_SIZE);
+
+  db_uint_t length = strlen(string);
+  db_uint_t hash = _dbobj_intern_hash(string, length);
+  db_uint_t index = hash & (intern_size - 1);
+  DBInternedString *interned;
+
+  while ((interned = intern_slots[index]))
+  {
+    if (interned->hash == hash && strcmp(interned->chars, string) == 0)
+    {
+      ++interned->refcount;
+      return interned->chars;
+    }
+    index = (index + 1) & (intern_size - 1);
+  }
+
+  interned = (DBInternedString *)malloc(sizeof(DBInternedString) + length + 1);
+  if (!interned)
+    EXIT_ON_MEMORY_ERROR();
+  interned->refcount = 1;
+  interned->hash = hash;
+  memcpy(interned->chars, string, length + 1);
+  intern_slots[index] = interned;
+  ++intern_count;
+
+  return interned->chars;
+}
+
+void dbobj_release_interned(const char *string)
+{
+  if (!string)
+    return;
+
+  DBInternedString *interned = _dbobj_interned_header(string);
+
+  if (--interned->refcount)
+    return;
+
+  db_uint_t mask = intern_size - 1;
+  db_uint_t index = interned->hash & mask, next, home;
+
+  while (intern_slots[index] != interned)
+    index = (index + 1) & mask;
+
+  // shift the following entries of the probe sequence back, so no tombstones are needed
+  intern_slots[index] = NULL;
+  next = index;
+  while (intern_slots[next = (next + 1) & mask])
+  {
+    home = intern_slots[next]->hash & mask;
+    // the entry stays if its home slot lies cyclically in (index, next]
+    if (index <= next ? (index < home && home <= next) : (index < home || home <= next))
+      continue;
+    intern_slots[index] = intern_slots[next];
+    intern_slots[next] = NULL;
+    index = next;
+  }
+
+  --intern_count;
+  free(interned);
+}
+
+// Returns the number in front of the characters of a numeric argument, NULL for other strings
+static DBArenaNumber *_dbobj_arena_number(DBObj *obj)
+{
+  if (obj->encoding != DB_ENC_ARENA_NUMBER || !obj->value.string)
+    return NULL;
+  return (DBArenaNumber *)(obj->value.string - offsetof(DBArenaNumber, text));
+}
+
+// Accepts only the text `%d` would print, so the integer can be formatted back to the same string
+static db_bool_t _dbobj_parse_int(const char *string, db_int_t *value)
+{
+  if (!string || ((*string < '0' || *string > '9') && *string != '-'))
+    return false;
+
+  char *end;
+  errno = 0;
+  long long parsed = strtoll(string, &end, 10);
+
+  if (*end || errno == ERANGE || parsed < INT32_MIN || parsed > INT32_MAX)
+    return false;
+  // no leading zeros and no negative zero
+  if (string[0] == '-' ? string[1] == '0' : string[0] == '0' && string[1])
+    return false;
+
+  *value = (db_int_t)parsed;
+  return true;
+}
+
+static db_bool_t _dbobj_parse_double(const char *string, db_double_t *value)
+{
+  if (!string || !*string || *string == ' ')
+    return false;
+
+  char *end;
+  db_double_t parsed = strtod(string, &end);
+
+  if (*end || !isfinite(parsed))
+    return false;
+
+  *value = parsed;
+  return true;
+}
+
+// Formats with the fewest digits that read back as the same double
+void dbobj_format_double(db_double_t value, char *buffer)
+{
+  snprintf(buffer, DBOBJ_NUMBER_BUFFER_SIZE, "%.15g", value);
+  if (strtod(buffer, NULL) != value)
+    snprintf(buffer, DBOBJ_NUMBER_BUFFER_SIZE, "%.17g", value);
+}
+
+DBObj *dbobj_try_encode_number(DBObj *obj)
+{
+  db_int_t value;
+
+  if (!dbobj_is_string(obj) || obj->encoding != DB_ENC_DEFAULT || !_dbobj_parse_int(obj->value.string, &value))
+    return obj;
+
+  free(obj->value.string);
+  obj->encoding = DB_ENC_INT;
+  obj->value.int_value = value;
+
+  return obj;
+}
+
+const char *dbobj_string_view(DBObj *obj, char *buffer)
+{
+  if (!dbobj_is_string(obj))
+    return NULL;
+
+  switch (obj->encoding)
+  {
+  case DB_ENC_INT:
+    snprintf(buffer, DBOBJ_NUMBER_BUFFER_SIZE, "%d", obj->value.int_value);
+    return buffer;
+  case DB_ENC_DOUBLE:
+    dbobj_format_double(obj->value.double_value, buffer);
+    return buffer;
+  default:
+    return obj->value.string;
+  }
+}
+
+db_bool_t dbobj_string_get_int(DBObj *obj, db_int_t *value)
+{
+  if (!dbobj_is_string(obj) || obj->encoding == DB_ENC_DOUBLE)
+    return false;
+
+  if (obj->encoding == DB_ENC_INT)
+  {
+    *value = obj->value.int_value;
+    return true;
+  }
+
+  return _dbobj_parse_int(obj->value.string, value);
+}
+
+db_bool_t dbobj_string_get_double(DBObj *obj, db_double_t *value)
+{
+  if (!dbobj_is_string(obj))
+    return false;
+
+  if (obj->encoding == DB_ENC_INT)
+    *value = obj->value.int_value;
+  else if (obj->encoding == DB_ENC_DOUBLE)
+    *value = obj->value.double_value;
+  else
+    return _dbobj_parse_double(obj->value.string, value);
+
+  return true;
+}
+
+db_bool_t dbobj_string_incrby(DBObj *obj, db_int_t increment, db_int_t *result)
+{
+  db_int_t value;
+
+  if (!dbobj_string_get_int(obj, &value))
+    return false;
+
+  if (increment > 0 ? value > INT32_MAX - increment : value < INT32_MIN - increment)
+    return false;
+
+  if (obj->encoding != DB_ENC_INT)
+  {
+    _dbobj_free_string(obj);
+    obj->encoding = DB_ENC_INT;
+  }
+  obj->value.int_value = value + increment;
+  *result = obj->value.int_value;
+
+  return true;
+}
+
+db_bool_t dbobj_string_incrbyfloat(DBObj *obj, db_double_t increment, db_double_t *result)
+{
+  db_double_t value;
+
+  if (!dbobj_string_get_double(obj, &value))
+    return false;
+
+  value += increment;
+  if (!isfinite(value))
+    return false;
+
+  if (obj->encoding != DB_ENC_DOUBLE)
+  {
+    _dbobj_free_string(obj);
+    obj->encoding = DB_ENC_DOUBLE;
+  }
+  obj->value.double_value = value;
+  *result = value;
+
+  return true;
 }
 
 DBObj *dbobj_string_to_uint(DBObj *obj)
@@ -257,12 +739,22 @@ DBObj *dbobj_string_to_uint(DBObj *obj)
   if (!obj || obj->type != DB_TYPE_STRING)
     return obj;
 
-  char *s = obj->value.string;
+  DBArenaNumber *number = _dbobj_arena_number(obj);
+  if (number && number->is_int)
+  {
+    obj->type = DB_TYPE_UINT;
+    obj->value.uint_value = (db_uint_t)number->int_value;
+    return obj;
+  }
+
+  char buffer[DBOBJ_NUMBER_BUFFER_SIZE];
+  const char *s = dbobj_string_view(obj, buffer);
   if (s)
   {
+    db_uint_t value = (db_uint_t)strtoul(s, NULL, 10);
+    _dbobj_free_string(obj);
     obj->type = DB_TYPE_UINT;
-    obj->value.uint_value = (db_uint_t)strtoul(s, NULL, 10),
-    free(s);
+    obj->value.uint_value = value;
   }
 
   return obj;
@@ -273,12 +765,48 @@ DBObj *dbobj_string_to_int(DBObj *obj)
   if (!obj || obj->type != DB_TYPE_STRING)
     return obj;
 
-  char *s = obj->value.string;
+  DBArenaNumber *number = _dbobj_arena_number(obj);
+  if (number && number->is_int)
+  {
+    obj->type = DB_TYPE_INT;
+    obj->value.int_value = number->int_value;
+    return obj;
+  }
+
+  char buffer[DBOBJ_NUMBER_BUFFER_SIZE];
+  const char *s = dbobj_string_view(obj, buffer);
   if (s)
   {
+    db_int_t value = (db_int_t)strtol(s, NULL, 10);
+    _dbobj_free_string(obj);
     obj->type = DB_TYPE_INT;
-    obj->value.int_value = (db_int_t)strtol(s, NULL, 10),
-    free(s);
+    obj->value.int_value = value;
+  }
+
+  return obj;
+}
+
+DBObj *dbobj_string_to_double(DBObj *obj)
+{
+  if (!obj || obj->type != DB_TYPE_STRING)
+    return obj;
+
+  DBArenaNumber *number = _dbobj_arena_number(obj);
+  if (number)
+  {
+    obj->type = DB_TYPE_DOUBLE;
+    obj->value.double_value = number->double_value;
+    return obj;
+  }
+
+  char buffer[DBOBJ_NUMBER_BUFFER_SIZE];
+  const char *s = dbobj_string_view(obj, buffer);
+  if (s)
+  {
+    db_double_t value = strtod(s, NULL);
+    _dbobj_free_string(obj);
+    obj->type = DB_TYPE_DOUBLE;
+    obj->value.double_value = value;
   }
 
   return obj;
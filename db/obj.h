@@ -23,12 +23,47 @@ DBObj *dbobj_create_uint(db_uint_t value);
 DBObj *dbobj_create_double(db_double_t value);
 DBObj *dbobj_create_string(char *value);
 DBObj *dbobj_create_string_with_dup(const char *value);
+// Creates a string holding a number, which is only formatted when the string is read
+DBObj *dbobj_create_int_string(db_int_t value);
+DBObj *dbobj_create_double_string(db_double_t value);
+// Creates a string over characters allocated in a request arena, they are not freed with the object
+DBObj *dbobj_create_arena_string(char *value);
+// Creates an arena string for a numeric token, keeping its value so reading it as a number does not parse it again
+// Returns NULL if the token is not a number as a whole
+DBObj *dbobj_create_arena_number(DBArena *arena, const char *token, size_t length);
+// Initializes an object in memory of the caller, for the arguments of requests built on the stack
+// The objects are immortal and a string keeps pointing to the characters of the caller, nothing is ever freed
+DBObj *dbobj_init_static_string(DBObj *obj, const char *value);
+DBObj *dbobj_init_static_int(DBObj *obj, db_int_t value);
+DBObj *dbobj_init_static_uint(DBObj *obj, db_uint_t value);
 DBObj *dbobj_create_list(DBList *value);
+DBObj *dbobj_create_quicklist(DBQuicklist *value);
 DBObj *dbobj_create_zset(DBZSet *value);
 DBObj *dbobj_create_hash(DBHash *value);
+DBObj *dbobj_create_listpack_hash(DBListpack *value);
 DBObj *_dbobj_create_zsetele(DBZSetElement *value);
 
+// Removes an owner of the object, the last one frees it
 void free_dbobj(DBObj *obj);
+
+// Objects with this reference count are never freed, see the shared objects below
+#define DBOBJ_REFCOUNT_IMMORTAL DB_UINT_MAX
+// Integers from 0 up to this are replied with shared objects
+#define DBOBJ_SHARED_INTEGERS 1024
+
+// Adds an owner to an object, so a stored value can be replied without being copied
+DBObj *dbobj_retain(DBObj *obj);
+// True if the object has other owners, it must then be copied before being modified
+db_bool_t dbobj_is_shared(DBObj *obj);
+// Returns an unshared copy of a string object, with the same encoding
+DBObj *dbobj_dup_string(DBObj *obj);
+// Preallocated replies, they must not be modified
+DBObj *dbobj_shared_ok();
+DBObj *dbobj_shared_null();
+// Returns a preallocated object for small integers, a new one otherwise
+DBObj *dbobj_shared_int(db_int_t value);
+DBObj *dbobj_shared_uint(db_uint_t value);
+
 void *dbobj_extract_null(DBObj *obj);
 char *dbobj_extract_error(DBObj *obj);
 db_bool_t dbobj_extract_bool(DBObj *obj);
@@ -36,13 +71,40 @@ db_int_t dbobj_extract_int(DBObj *obj);
 db_uint_t dbobj_extract_uint(DBObj *obj);
 db_double_t dbobj_extract_double(DBObj *obj);
 char *dbobj_extract_string(DBObj *obj);
+// Returns NULL for lists in the quicklist encoding
 DBList *dbobj_extract_list(DBObj *obj);
 DBZSet *dbobj_extract_zset(DBObj *obj);
+// Returns NULL for hashes in the listpack encoding
 DBHash *dbobj_extract_hash(DBObj *obj);
 DBZSetElement *_dbobj_extract_zsetele(DBObj *obj);
 
+// Returns the interned copy of a string, adding a reference to it
+// The pool is not thread-safe, it is only used by the database worker
+const char *dbobj_intern(const char *string);
+// Removes a reference to an interned string, freeing it with the last one
+void dbobj_release_interned(const char *string);
+
+// Longest text of a number encoded string, including the terminator
+#define DBOBJ_NUMBER_BUFFER_SIZE 32
+
+// Encodes a string holding a canonical integer, such as "42" but not "042" or "+42", as DB_ENC_INT
+DBObj *dbobj_try_encode_number(DBObj *obj);
+// Returns the text of a string object, numbers are formatted into `buffer` (DBOBJ_NUMBER_BUFFER_SIZE bytes)
+const char *dbobj_string_view(DBObj *obj, char *buffer);
+// Formats a double with the fewest digits that read back as the same value
+void dbobj_format_double(db_double_t value, char *buffer);
+// Reads the number held by a string object without changing its encoding; returns false if it is not one
+db_bool_t dbobj_string_get_int(DBObj *obj, db_int_t *value);
+db_bool_t dbobj_string_get_double(DBObj *obj, db_double_t *value);
+// Adds `increment` to the integer held by a string object, which keeps it as DB_ENC_INT from then on
+// Returns false, leaving the object untouched, if it does not hold an integer or the result overflows
+db_bool_t dbobj_string_incrby(DBObj *obj, db_int_t increment, db_int_t *result);
+// Same as `dbobj_string_incrby` for any number, the object is kept as DB_ENC_DOUBLE from then on
+db_bool_t dbobj_string_incrbyfloat(DBObj *obj, db_double_t increment, db_double_t *result);
+
 DBObj *dbobj_string_to_uint(DBObj *obj);
 DBObj *dbobj_string_to_int(DBObj *obj);
+DBObj *dbobj_string_to_double(DBObj *obj);
 DBObj *dbobj_int_to_string(DBObj *obj);
 
 #endif
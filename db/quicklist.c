@@ -0,0 +1,732 @@
+#include <string.h>
+
+#include "utils.h"
+#include "list.h"
+#include "quicklist.h"
+
+// Marks a length stored in the 4 bytes following it
+#define QL_LONG_LENGTH 0xFF
+
+// Smallest allocation of a node, so the first pushes do not reallocate it each time
+#define QL_MIN_NODE_CAPACITY 64
+
+// Bytes taken by an entry of `length` bytes: its length, the bytes and the terminator
+static inline db_uint_t _ql_entry_size(db_uint_t length)
+{
+  return (length < QL_LONG_LENGTH ? 1 : 5) + length + 1;
+}
+
+static db_uint_t _ql_read_length(const unsigned char *p)
+{
+  if (p[0] != QL_LONG_LENGTH)
+    return p[0];
+
+  uint32_t length;
+  memcpy(&length, p + 1, sizeof(length));
+  return length;
+}
+
+// Returns the bytes of the entry at `p`, they are terminated so they can be read in place
+static inline const char *_ql_entry_value(const unsigned char *p)
+{
+  return (const char *)(p + (p[0] == QL_LONG_LENGTH ? 5 : 1));
+}
+
+static inline unsigned char *_ql_next_entry(unsigned char *p)
+{
+  return p + _ql_entry_size(_ql_read_length(p));
+}
+
+static inline db_bool_t _ql_entry_equals(const unsigned char *p, const char *value, db_uint_t length)
+{
+  return _ql_read_length(p) == length && memcmp(_ql_entry_value(p), value, length) == 0;
+}
+
+static void _ql_write_entry(unsigned char *p, const char *value, db_uint_t length)
+{
+  if (length < QL_LONG_LENGTH)
+    *p++ = (unsigned char)length;
+  else
+  {
+    uint32_t long_length = length;
+    *p++ = QL_LONG_LENGTH;
+    memcpy(p, &long_length, sizeof(long_length));
+    p += sizeof(long_length);
+  }
+  memcpy(p, value, length);
+  p[length] = '\0';
+}
+
+static DBQuicklistNode *_ql_create_node(db_uint_t capacity)
+{
+  if (capacity < QL_MIN_NODE_CAPACITY)
+    capacity = QL_MIN_NODE_CAPACITY;
+
+  DBQuicklistNode *node = (DBQuicklistNode *)malloc(sizeof(DBQuicklistNode) + capacity);
+
+  if (!node)
+    EXIT_ON_MEMORY_ERROR();
+
+  node->prev = NULL;
+  node->next = NULL;
+  node->count = 0;
+  node->size = 0;
+  node->capacity = capacity;
+
+  return node;
+}
+
+// Grows a node to hold `size` bytes of entries, the node may move so its neighbours are relinked
+static DBQuicklistNode *_ql_reserve_node(DBQuicklist *ql, DBQuicklistNode *node, db_uint_t size)
+{
+  if (size <= node->capacity)
+    return node;
+
+  db_uint_t capacity = node->capacity * 2;
+  if (capacity < size)
+    capacity = size;
+  // a node is never filled past the node size, so it does not need more room than that
+  if (capacity > ql->node_size && size <= ql->node_size)
+    capacity = ql->node_size;
+
+  node = (DBQuicklistNode *)realloc(node, sizeof(DBQuicklistNode) + capacity);
+  if (!node)
+    EXIT_ON_MEMORY_ERROR();
+  node->capacity = capacity;
+
+  if (node->prev)
+    node->prev->next = node;
+  else
+    ql->head = node;
+  if (node->next)
+    node->next->prev = node;
+  else
+    ql->tail = node;
+
+  return node;
+}
+
+static void _ql_link_after(DBQuicklist *ql, DBQuicklistNode *node, DBQuicklistNode *new_node)
+{
+  new_node->prev = node;
+  new_node->next = node->next;
+  if (node->next)
+    node->next->prev = new_node;
+  else
+    ql->tail = new_node;
+  node->next = new_node;
+}
+
+static void _ql_link_before(DBQuicklist *ql, DBQuicklistNode *node, DBQuicklistNode *new_node)
+{
+  new_node->next = node;
+  new_node->prev = node->prev;
+  if (node->prev)
+    node->prev->next = new_node;
+  else
+    ql->head = new_node;
+  node->prev = new_node;
+}
+
+static void _ql_delete_node(DBQuicklist *ql, DBQuicklistNode *node)
+{
+  if (node->prev)
+    node->prev->next = node->next;
+  else
+    ql->head = node->next;
+  if (node->next)
+    node->next->prev = node->prev;
+  else
+    ql->tail = node->prev;
+  free(node);
+}
+
+DBQuicklist *quicklist_create(db_uint_t node_size)
+{
+  DBQuicklist *ql = (DBQuicklist *)malloc(sizeof(DBQuicklist));
+
+  if (!ql)
+    EXIT_ON_MEMORY_ERROR();
+
+  ql->head = NULL;
+  ql->tail = NULL;
+  ql->length = 0;
+  ql->node_size = node_size ? node_size : QUICKLIST_DEFAULT_NODE_SIZE;
+
+  return ql;
+}
+
+void quicklist_free(DBQuicklist *ql)
+{
+  if (!ql)
+    return;
+
+  DBQuicklistNode *node = ql->head, *next;
+
+  while (node)
+  {
+    next = node->next;
+    free(node);
+    node = next;
+  }
+
+  free(ql);
+}
+
+db_uint_t quicklist_push_head(DBQuicklist *ql, const char *value)
+{
+  if (!ql || !value)
+    return 0;
+
+  db_uint_t length = strlen(value), entry_size = _ql_entry_size(length);
+  DBQuicklistNode *node = ql->head;
+
+  if (!node || node->size + entry_size > ql->node_size)
+  {
+    node = _ql_create_node(entry_size);
+    node->next = ql->head;
+    if (ql->head)
+      ql->head->prev = node;
+    else
+      ql->tail = node;
+    ql->head = node;
+  }
+  else
+    node = _ql_reserve_node(ql, node, node->size + entry_size);
+
+  memmove(node->entries + entry_size, node->entries, node->size);
+  _ql_write_entry(node->entries, value, length);
+  node->size += entry_size;
+  ++node->count;
+
+  return ++ql->length;
+}
+
+db_uint_t quicklist_push_tail(DBQuicklist *ql, const char *value)
+{
+  if (!ql || !value)
+    return 0;
+
+  db_uint_t length = strlen(value), entry_size = _ql_entry_size(length);
+  DBQuicklistNode *node = ql->tail;
+
+  if (!node || node->size + entry_size > ql->node_size)
+  {
+    node = _ql_create_node(entry_size);
+    node->prev = ql->tail;
+    if (ql->tail)
+      ql->tail->next = node;
+    else
+      ql->head = node;
+    ql->tail = node;
+  }
+  else
+    node = _ql_reserve_node(ql, node, node->size + entry_size);
+
+  _ql_write_entry(node->entries + node->size, value, length);
+  node->size += entry_size;
+  ++node->count;
+
+  return ++ql->length;
+}
+
+char *quicklist_pop_head(DBQuicklist *ql)
+{
+  if (!ql || !ql->head)
+    return NULL;
+
+  DBQuicklistNode *node = ql->head;
+  db_uint_t entry_size = _ql_entry_size(_ql_read_length(node->entries));
+  char *value = dbutil_strdup(_ql_entry_value(node->entries));
+
+  --ql->length;
+  if (--node->count == 0)
+  {
+    _ql_delete_node(ql, node);
+    return value;
+  }
+
+  node->size -= entry_size;
+  memmove(node->entries, node->entries + entry_size, node->size);
+
+  return value;
+}
+
+char *quicklist_pop_tail(DBQuicklist *ql)
+{
+  if (!ql || !ql->tail)
+    return NULL;
+
+  DBQuicklistNode *node = ql->tail;
+  unsigned char *p = node->entries;
+
+  // entries only know their own length, so the last one is found from the start of the node
+  for (db_uint_t i = 1; i < node->count; ++i)
+    p = _ql_next_entry(p);
+
+  char *value = dbutil_strdup(_ql_entry_value(p));
+
+  --ql->length;
+  if (--node->count == 0)
+  {
+    _ql_delete_node(ql, node);
+    return value;
+  }
+
+  node->size = p - node->entries;
+
+  return value;
+}
+
+// Turns a negative index into one counted from the end; returns false if it is out of the quicklist
+static db_bool_t _ql_normalize_index(const DBQuicklist *ql, db_int_t index, db_uint_t *position)
+{
+  if (!ql)
+    return false;
+
+  if (index >= 0)
+  {
+    *position = (db_uint_t)index;
+    return *position < ql->length;
+  }
+
+  // -(index + 1) cannot overflow, unlike -index
+  db_uint_t from_tail = (db_uint_t)(-(index + 1));
+  *position = ql->length - 1 - from_tail;
+  return from_tail < ql->length;
+}
+
+// Finds the entry at `index` (less than the length), whole nodes are skipped from the nearest end
+// Stores the entry in `entry` and its index within the returned node in `offset`
+static DBQuicklistNode *_ql_seek(const DBQuicklist *ql, db_uint_t index, unsigned char **entry, db_uint_t *offset)
+{
+  DBQuicklistNode *node;
+  db_uint_t first;
+
+  if (index > ql->length / 2)
+  {
+    node = ql->tail;
+    first = ql->length - node->count;
+    while (first > index)
+    {
+      node = node->prev;
+      first -= node->count;
+    }
+  }
+  else
+  {
+    node = ql->head;
+    first = 0;
+    while (first + node->count <= index)
+    {
+      first += node->count;
+      node = node->next;
+    }
+  }
+
+  unsigned char *p = node->entries;
+  for (db_uint_t i = first; i < index; ++i)
+    p = _ql_next_entry(p);
+
+  *entry = p;
+  *offset = index - first;
+
+  return node;
+}
+
+// Removes `count` entries of a node starting at `p`, the node is deleted once it is empty
+static void _ql_node_remove(DBQuicklist *ql, DBQuicklistNode *node, unsigned char *p, db_uint_t count)
+{
+  ql->length -= count;
+
+  if (count == node->count)
+  {
+    _ql_delete_node(ql, node);
+    return;
+  }
+
+  unsigned char *end = p;
+  for (db_uint_t i = 0; i < count; ++i)
+    end = _ql_next_entry(end);
+
+  memmove(p, end, node->entries + node->size - end);
+  node->size -= end - p;
+  node->count -= count;
+}
+
+// Moves the entries of a node from byte `at` on into a new node following it
+static void _ql_split_node(DBQuicklist *ql, DBQuicklistNode *node, db_uint_t at)
+{
+  DBQuicklistNode *tail = _ql_create_node(node->size - at);
+  unsigned char *p, *end = node->entries + node->size;
+
+  for (p = node->entries + at; p < end; p = _ql_next_entry(p))
+    ++tail->count;
+
+  memcpy(tail->entries, node->entries + at, node->size - at);
+  tail->size = node->size - at;
+  node->size = at;
+  node->count -= tail->count;
+  _ql_link_after(ql, node, tail);
+}
+
+// Inserts `value` before the entry at `p` in `node`, `p` may also be the end of the node
+static void _ql_insert(DBQuicklist *ql, DBQuicklistNode *node, unsigned char *p, const char *value)
+{
+  db_uint_t length = strlen(value), entry_size = _ql_entry_size(length), at = p - node->entries;
+
+  // a full node passes the entry to a neighbour with room when it is at a boundary,
+  // otherwise it is split there and the entry joins the first half or gets a node of its own
+  if (node->size + entry_size > ql->node_size)
+  {
+    if (at == 0 && node->prev && node->prev->size + entry_size <= ql->node_size)
+    {
+      node = node->prev;
+      at = node->size;
+    }
+    else if (at == node->size && node->next && node->next->size + entry_size <= ql->node_size)
+    {
+      node = node->next;
+      at = 0;
+    }
+    else
+    {
+      if (at && at < node->size)
+        _ql_split_node(ql, node, at);
+      if (node->size + entry_size > ql->node_size)
+      {
+        DBQuicklistNode *new_node = _ql_create_node(entry_size);
+        if (at)
+          _ql_link_after(ql, node, new_node);
+        else
+          _ql_link_before(ql, node, new_node);
+        node = new_node;
+        at = 0;
+      }
+    }
+  }
+
+  node = _ql_reserve_node(ql, node, node->size + entry_size);
+  memmove(node->entries + at + entry_size, node->entries + at, node->size - at);
+  _ql_write_entry(node->entries + at, value, length);
+  node->size += entry_size;
+  ++node->count;
+  ++ql->length;
+}
+
+// Removes up to `limit` entries equal to `value` from a node, the last ones first if `from_tail`
+static db_uint_t _ql_node_remove_matches(DBQuicklist *ql, DBQuicklistNode *node, const char *value, db_uint_t length, db_uint_t limit, db_bool_t from_tail)
+{
+  unsigned char *p, *kept, *end = node->entries + node->size;
+  db_uint_t matches = 0, skipped, removed = 0, entry_size;
+
+  for (p = node->entries; p < end; p = _ql_next_entry(p))
+    matches += _ql_entry_equals(p, value, length);
+
+  if (!matches)
+    return 0;
+
+  // removing from the tail keeps the first matches of the node
+  skipped = from_tail && matches > limit ? matches - limit : 0;
+
+  for (p = kept = node->entries; p < end; p += entry_size)
+  {
+    entry_size = _ql_entry_size(_ql_read_length(p));
+    if (removed < limit && _ql_entry_equals(p, value, length))
+    {
+      if (skipped)
+        --skipped;
+      else
+      {
+        ++removed;
+        continue;
+      }
+    }
+    if (kept != p)
+      memmove(kept, p, entry_size);
+    kept += entry_size;
+  }
+
+  ql->length -= removed;
+  node->count -= removed;
+  node->size = kept - node->entries;
+  if (!node->count)
+    _ql_delete_node(ql, node);
+
+  return removed;
+}
+
+// Clamps `stop` to the last index; returns false if the range is empty
+static db_bool_t _ql_clamp_range(const DBQuicklist *ql, db_uint_t start, db_uint_t *stop)
+{
+  if (*stop == DB_UINT_MAX || *stop > ql->length - 1)
+    *stop = ql->length - 1;
+
+  return start <= *stop && start < ql->length;
+}
+
+// Calls `callback` for `count` entries from `start`, the range must be within the quicklist
+static void _ql_walk_range(const DBQuicklist *ql, db_uint_t start, db_uint_t count, DBQuicklistFunc callback, void *context)
+{
+  db_uint_t offset;
+  unsigned char *p;
+  DBQuicklistNode *node = _ql_seek(ql, start, &p, &offset);
+
+  for (; count; --count)
+  {
+    callback(_ql_entry_value(p), context);
+    p = _ql_next_entry(p);
+    if (p == node->entries + node->size && count > 1)
+    {
+      node = node->next;
+      p = node->entries;
+    }
+  }
+}
+
+static void _ql_push_copy(const char *value, void *list)
+{
+  rpush((DBList *)list, create_dblistnode_with_string(value));
+}
+
+static void _ql_store_view(const char *value, void *views)
+{
+  const char ***cursor = (const char ***)views;
+  *(*cursor)++ = value;
+}
+
+DBList *quicklist_range(DBQuicklist *ql, db_uint_t start, db_uint_t stop)
+{
+  if (!ql)
+    return create_dblist();
+
+  if (!_ql_clamp_range(ql, start, &stop))
+    return NULL;
+
+  DBList *list = create_dblist();
+  _ql_walk_range(ql, start, stop - start + 1, _ql_push_copy, list);
+
+  return list;
+}
+
+db_uint_t quicklist_view_range(const DBQuicklist *ql, db_uint_t start, db_uint_t stop, const char **views, db_uint_t capacity)
+{
+  if (!ql || !_ql_clamp_range(ql, start, &stop))
+    return 0;
+
+  db_uint_t count = stop - start + 1;
+  const char **cursor = views;
+
+  if (views && capacity)
+    _ql_walk_range(ql, start, count < capacity ? count : capacity, _ql_store_view, &cursor);
+
+  return count;
+}
+
+const char *quicklist_index(const DBQuicklist *ql, db_int_t index)
+{
+  db_uint_t position, offset;
+  unsigned char *p;
+
+  if (!_ql_normalize_index(ql, index, &position))
+    return NULL;
+
+  _ql_seek(ql, position, &p, &offset);
+
+  return _ql_entry_value(p);
+}
+
+db_bool_t quicklist_replace(DBQuicklist *ql, db_int_t index, const char *value)
+{
+  db_uint_t position, offset;
+  unsigned char *p;
+
+  if (!value || !_ql_normalize_index(ql, index, &position))
+    return false;
+
+  DBQuicklistNode *node = _ql_seek(ql, position, &p, &offset);
+  db_uint_t length = strlen(value), at = p - node->entries;
+  db_uint_t old_size = _ql_entry_size(_ql_read_length(p)), new_size = _ql_entry_size(length);
+
+  node = _ql_reserve_node(ql, node, node->size - old_size + new_size);
+  p = node->entries + at;
+  memmove(p + new_size, p + old_size, node->size - at - old_size);
+  _ql_write_entry(p, value, length);
+  node->size = node->size - old_size + new_size;
+
+  return true;
+}
+
+db_int_t quicklist_insert(DBQuicklist *ql, const char *pivot, const char *value, db_bool_t after)
+{
+  if (!ql || !pivot || !value)
+    return -1;
+
+  db_uint_t length = strlen(pivot);
+  unsigned char *p, *end;
+
+  for (DBQuicklistNode *node = ql->head; node; node = node->next)
+  {
+    end = node->entries + node->size;
+    for (p = node->entries; p < end; p = _ql_next_entry(p))
+    {
+      if (_ql_entry_equals(p, pivot, length))
+      {
+        _ql_insert(ql, node, after ? _ql_next_entry(p) : p, value);
+        return ql->length;
+      }
+    }
+  }
+
+  return -1;
+}
+
+db_uint_t quicklist_remove(DBQuicklist *ql, const char *value, db_int_t count)
+{
+  if (!ql || !value)
+    return 0;
+
+  db_bool_t from_tail = count < 0;
+  db_uint_t length = strlen(value), removed = 0;
+  db_uint_t limit = count > 0 ? (db_uint_t)count : count < 0 ? (db_uint_t)(-(count + 1)) + 1 : DB_UINT_MAX;
+  DBQuicklistNode *node = from_tail ? ql->tail : ql->head, *next;
+
+  while (node && removed < limit)
+  {
+    next = from_tail ? node->prev : node->next;
+    removed += _ql_node_remove_matches(ql, node, value, length, limit - removed, from_tail);
+    node = next;
+  }
+
+  return removed;
+}
+
+void quicklist_trim(DBQuicklist *ql, db_int_t start, db_int_t stop)
+{
+  if (!ql || !ql->length)
+    return;
+
+  db_int_t length = (db_int_t)ql->length;
+
+  if (start < 0)
+    start = start < -length ? 0 : start + length;
+  if (stop < 0)
+    stop += length;
+  if (stop >= length)
+    stop = length - 1;
+
+  if (start > stop)
+  {
+    quicklist_delete_range(ql, 0, ql->length);
+    return;
+  }
+
+  quicklist_delete_range(ql, stop + 1, ql->length - stop - 1);
+  quicklist_delete_range(ql, 0, start);
+}
+
+void quicklist_delete_range(DBQuicklist *ql, db_uint_t start, db_uint_t count)
+{
+  if (!ql || start >= ql->length || !count)
+    return;
+
+  if (count > ql->length - start)
+    count = ql->length - start;
+
+  db_uint_t offset, removed;
+  unsigned char *p;
+  DBQuicklistNode *node = _ql_seek(ql, start, &p, &offset), *next;
+
+  while (count)
+  {
+    next = node->next;
+    removed = node->count - offset < count ? node->count - offset : count;
+    _ql_node_remove(ql, node, p, removed);
+    count -= removed;
+    node = next;
+    p = node ? node->entries : NULL;
+    offset = 0;
+  }
+}
+
+DBList *quicklist_positions(const DBQuicklist *ql, const char *value, db_int_t rank, db_uint_t count, db_uint_t maxlen)
+{
+  DBList *positions = create_dblist();
+
+  if (!ql || !value || !rank)
+    return positions;
+
+  db_uint_t length = strlen(value), index, i, matches_count;
+  db_uint_t skipped = rank > 0 ? (db_uint_t)rank - 1 : (db_uint_t)(-(rank + 1));
+  db_uint_t limit = count ? count : DB_UINT_MAX;
+  unsigned char *p, *end;
+  DBQuicklistNode *node;
+
+  if (!maxlen || maxlen > ql->length)
+    maxlen = ql->length;
+
+  if (rank > 0)
+  {
+    for (node = ql->head, index = 0; node && index < maxlen && positions->length < limit; node = node->next)
+    {
+      end = node->entries + node->size;
+      for (p = node->entries; p < end && index < maxlen && positions->length < limit; p = _ql_next_entry(p), ++index)
+      {
+        if (!_ql_entry_equals(p, value, length))
+          continue;
+        if (skipped)
+          --skipped;
+        else
+          rpush(positions, create_dblistnode(dbobj_create_uint(index)));
+      }
+    }
+    return positions;
+  }
+
+  // entries of a node can only be walked forward, so its matches are collected before being read backward
+  db_uint_t lowest = ql->length - maxlen, *matches = NULL, matches_capacity = 0;
+
+  for (node = ql->tail, index = ql->length; node && index > lowest && positions->length < limit; node = node->prev)
+  {
+    index -= node->count;
+    if (node->count > matches_capacity)
+    {
+      matches_capacity = node->count;
+      matches = (db_uint_t *)realloc(matches, matches_capacity * sizeof(db_uint_t));
+      if (!matches)
+        EXIT_ON_MEMORY_ERROR();
+    }
+
+    end = node->entries + node->size;
+    for (p = node->entries, i = index, matches_count = 0; p < end; p = _ql_next_entry(p), ++i)
+      if (i >= lowest && _ql_entry_equals(p, value, length))
+        matches[matches_count++] = i;
+
+    while (matches_count-- && positions->length < limit)
+    {
+      if (skipped)
+        --skipped;
+      else
+        rpush(positions, create_dblistnode(dbobj_create_uint(matches[matches_count])));
+    }
+  }
+
+  free(matches);
+
+  return positions;
+}
+
+void quicklist_foreach(DBQuicklist *ql, DBQuicklistFunc callback, void *context)
+{
+  if (!ql || !callback)
+    return;
+
+  unsigned char *p, *end;
+
+  for (DBQuicklistNode *node = ql->head; node; node = node->next)
+  {
+    end = node->entries + node->size;
+    for (p = node->entries; p < end; p = _ql_next_entry(p))
+      callback(_ql_entry_value(p), context);
+  }
+}
@@ -0,0 +1,63 @@
+#ifndef DB_QUICKLIST_H
+#define DB_QUICKLIST_H
+
+#include "types.h"
+
+// Default maximum number of bytes of entries in a quicklist node
+#define QUICKLIST_DEFAULT_NODE_SIZE 8192
+
+// Called for each entry by `quicklist_foreach`, must not modify the quicklist
+typedef void (*DBQuicklistFunc)(const char *value, void *context);
+
+// Creates an empty quicklist, nodes are filled up to `node_size` bytes (QUICKLIST_DEFAULT_NODE_SIZE if 0)
+DBQuicklist *quicklist_create(db_uint_t node_size);
+
+void quicklist_free(DBQuicklist *ql);
+
+db_uint_t quicklist_push_head(DBQuicklist *ql, const char *value);
+
+db_uint_t quicklist_push_tail(DBQuicklist *ql, const char *value);
+
+// Removes the first entry, returning a copy of it; NULL if the quicklist is empty
+char *quicklist_pop_head(DBQuicklist *ql);
+
+// Removes the last entry, returning a copy of it; NULL if the quicklist is empty
+char *quicklist_pop_tail(DBQuicklist *ql);
+
+// Returns copies of the entries from `start` to `stop` (inclusive, DB_UINT_MAX for the end) in a new list
+// Returns NULL if the range is out of the quicklist, like `lrange`
+DBList *quicklist_range(DBQuicklist *ql, db_uint_t start, db_uint_t stop);
+
+// Stores pointers to the entries from `start` to `stop` in `views`, at most `capacity` of them
+// Returns the number of entries in the range, which may exceed `capacity`; the views are only valid until
+// the quicklist is modified
+db_uint_t quicklist_view_range(const DBQuicklist *ql, db_uint_t start, db_uint_t stop, const char **views, db_uint_t capacity);
+
+// Returns the entry at `index` (negative counts from the tail) without copying it, or NULL if out of range
+// The returned string is only valid until the quicklist is modified
+const char *quicklist_index(const DBQuicklist *ql, db_int_t index);
+
+// Replaces the entry at `index` (negative counts from the tail); returns false if out of range
+db_bool_t quicklist_replace(DBQuicklist *ql, db_int_t index, const char *value);
+
+// Inserts `value` before or after the first entry equal to `pivot`; returns the new length, or -1 if not found
+db_int_t quicklist_insert(DBQuicklist *ql, const char *pivot, const char *value, db_bool_t after);
+
+// Removes the first `count` entries equal to `value`, the last ones if `count` is negative, all if 0
+// Returns the number of removed entries
+db_uint_t quicklist_remove(DBQuicklist *ql, const char *value, db_int_t count);
+
+// Keeps only the entries from `start` to `stop` (inclusive, negative counts from the tail), like LTRIM
+void quicklist_trim(DBQuicklist *ql, db_int_t start, db_int_t stop);
+
+// Removes `count` entries from `start`, whole nodes in the range are freed without being walked
+void quicklist_delete_range(DBQuicklist *ql, db_uint_t start, db_uint_t count);
+
+// Returns the indexes of the entries equal to `value` as uint nodes, like LPOS
+// A negative `rank` searches from the tail and skips |rank| - 1 matches; `count` and `maxlen` are unlimited if 0
+DBList *quicklist_positions(const DBQuicklist *ql, const char *value, db_int_t rank, db_uint_t count, db_uint_t maxlen);
+
+// Calls `callback` for each entry from head to tail
+void quicklist_foreach(DBQuicklist *ql, DBQuicklistFunc callback, void *context);
+
+#endif
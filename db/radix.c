@@ -0,0 +1,331 @@
+#include <string.h>
+
+#include "utils.h"
+#include "radix.h"
+
+static DBRadixNode *_radix_create_node(const char *label, db_uint_t label_length)
+{
+  DBRadixNode *node = (DBRadixNode *)malloc(sizeof(DBRadixNode));
+
+  if (!node)
+    EXIT_ON_MEMORY_ERROR();
+
+  node->label = (char *)malloc(label_length + 1);
+  if (!node->label)
+    EXIT_ON_MEMORY_ERROR();
+  memcpy(node->label, label, label_length);
+  node->label[label_length] = '\0';
+  node->label_length = label_length;
+  node->value = NULL;
+  node->children_count = 0;
+  node->children = NULL;
+
+  return node;
+}
+
+static void _radix_free_node(DBRadixNode *node)
+{
+  if (!node)
+    return;
+
+  for (db_uint_t i = 0; i < node->children_count; ++i)
+    _radix_free_node(node->children[i]);
+
+  free(node->children);
+  free(node->label);
+  free(node);
+}
+
+// Finds the position of the child whose label starts with `c`
+// Returns true if found, otherwise `position` is where such a child would be inserted
+static db_bool_t _radix_find_child(DBRadixNode *node, unsigned char c, db_uint_t *position)
+{
+  db_uint_t low = 0, high = node->children_count, middle;
+  unsigned char first;
+
+  while (low < high)
+  {
+    middle = (low + high) / 2;
+    first = (unsigned char)node->children[middle]->label[0];
+    if (first == c)
+    {
+      *position = middle;
+      return true;
+    }
+    if (first < c)
+      low = middle + 1;
+    else
+      high = middle;
+  }
+
+  *position = low;
+  return false;
+}
+
+static void _radix_insert_child(DBRadixNode *node, db_uint_t position, DBRadixNode *child)
+{
+  node->children = (DBRadixNode **)realloc(node->children, (node->children_count + 1) * sizeof(DBRadixNode *));
+  if (!node->children)
+    EXIT_ON_MEMORY_ERROR();
+
+  memmove(node->children + position + 1, node->children + position, (node->children_count - position) * sizeof(DBRadixNode *));
+  node->children[position] = child;
+  ++node->children_count;
+}
+
+static void _radix_remove_child(DBRadixNode *node, db_uint_t position)
+{
+  --node->children_count;
+  memmove(node->children + position, node->children + position + 1, (node->children_count - position) * sizeof(DBRadixNode *));
+
+  if (!node->children_count)
+  {
+    free(node->children);
+    node->children = NULL;
+  }
+}
+
+// Splits the label of `node` after `length` bytes, the tail moves to a new child
+static void _radix_split_node(DBRadixNode *node, db_uint_t length)
+{
+  DBRadixNode *tail = _radix_create_node(node->label + length, node->label_length - length);
+
+  tail->value = node->value;
+  tail->children_count = node->children_count;
+  tail->children = node->children;
+
+  node->label[length] = '\0';
+  node->label_length = length;
+  node->value = NULL;
+  node->children_count = 0;
+  node->children = NULL;
+  _radix_insert_child(node, 0, tail);
+}
+
+// Merges a node without value with its only child
+static void _radix_merge_child(DBRadixNode *node)
+{
+  DBRadixNode *child = node->children[0];
+  char *label = (char *)malloc(node->label_length + child->label_length + 1);
+
+  if (!label)
+    EXIT_ON_MEMORY_ERROR();
+
+  memcpy(label, node->label, node->label_length);
+  memcpy(label + node->label_length, child->label, child->label_length + 1);
+
+  free(node->label);
+  free(node->children);
+  node->label = label;
+  node->label_length += child->label_length;
+  node->value = child->value;
+  node->children_count = child->children_count;
+  node->children = child->children;
+
+  free(child->label);
+  free(child);
+}
+
+DBRadixTree *radix_create()
+{
+  DBRadixTree *tree = (DBRadixTree *)malloc(sizeof(DBRadixTree));
+
+  if (!tree)
+    EXIT_ON_MEMORY_ERROR();
+
+  tree->root = _radix_create_node("", 0);
+  tree->size = 0;
+
+  return tree;
+}
+
+void radix_clear(DBRadixTree *tree)
+{
+  if (!tree)
+    return;
+
+  _radix_free_node(tree->root);
+  tree->root = _radix_create_node("", 0);
+  tree->size = 0;
+}
+
+void radix_free(DBRadixTree *tree)
+{
+  if (!tree)
+    return;
+
+  _radix_free_node(tree->root);
+  free(tree);
+}
+
+db_bool_t radix_insert(DBRadixTree *tree, const char *key, void *value)
+{
+  if (!tree || !key || !value)
+    return false;
+
+  DBRadixNode *node = tree->root, *child;
+  db_uint_t key_length = strlen(key), position, common;
+
+  while (key_length)
+  {
+    if (!_radix_find_child(node, (unsigned char)*key, &position))
+    {
+      child = _radix_create_node(key, key_length);
+      child->value = value;
+      _radix_insert_child(node, position, child);
+      ++tree->size;
+      return true;
+    }
+
+    child = node->children[position];
+    common = 1;
+    while (common < child->label_length && common < key_length && child->label[common] == key[common])
+      ++common;
+
+    if (common < child->label_length)
+      _radix_split_node(child, common);
+
+    node = child;
+    key += common;
+    key_length -= common;
+  }
+
+  if (node->value)
+  {
+    node->value = value;
+    return false;
+  }
+
+  node->value = value;
+  ++tree->size;
+  return true;
+}
+
+// Removes `key` below `node`, compacting the nodes on the way back
+static db_bool_t _radix_remove(DBRadixNode *node, const char *key, db_uint_t key_length)
+{
+  db_uint_t position;
+
+  if (!_radix_find_child(node, (unsigned char)*key, &position))
+    return false;
+
+  DBRadixNode *child = node->children[position];
+
+  if (child->label_length > key_length || memcmp(child->label, key, child->label_length) != 0)
+    return false;
+
+  if (child->label_length == key_length)
+  {
+    if (!child->value)
+      return false;
+    child->value = NULL;
+  }
+  else if (!_radix_remove(child, key + child->label_length, key_length - child->label_length))
+  {
+    return false;
+  }
+
+  if (child->value)
+    return true;
+
+  if (!child->children_count)
+  {
+    _radix_remove_child(node, position);
+    free(child->label);
+    free(child);
+  }
+  else if (child->children_count == 1)
+  {
+    _radix_merge_child(child);
+  }
+
+  return true;
+}
+
+db_bool_t radix_remove(DBRadixTree *tree, const char *key)
+{
+  if (!tree || !key)
+    return false;
+
+  db_uint_t key_length = strlen(key);
+
+  if (!key_length)
+  {
+    if (!tree->root->value)
+      return false;
+    tree->root->value = NULL;
+    --tree->size;
+    return true;
+  }
+
+  if (!_radix_remove(tree->root, key, key_length))
+    return false;
+
+  --tree->size;
+  return true;
+}
+
+void *radix_get(DBRadixTree *tree, const char *key)
+{
+  if (!tree || !key)
+    return NULL;
+
+  DBRadixNode *node = tree->root, *child;
+  db_uint_t key_length = strlen(key), position;
+
+  while (key_length)
+  {
+    if (!_radix_find_child(node, (unsigned char)*key, &position))
+      return NULL;
+
+    child = node->children[position];
+    if (child->label_length > key_length || memcmp(child->label, key, child->label_length) != 0)
+      return NULL;
+
+    node = child;
+    key += child->label_length;
+    key_length -= child->label_length;
+  }
+
+  return node->value;
+}
+
+static db_uint_t _radix_walk(DBRadixNode *node, DBRadixWalkFunc callback, void *context)
+{
+  db_uint_t visited_count = 0;
+
+  if (node->value)
+    callback(node->value, context), ++visited_count;
+
+  for (db_uint_t i = 0; i < node->children_count; ++i)
+    visited_count += _radix_walk(node->children[i], callback, context);
+
+  return visited_count;
+}
+
+db_uint_t radix_walk_prefix(DBRadixTree *tree, const char *prefix, db_uint_t prefix_length, DBRadixWalkFunc callback, void *context)
+{
+  if (!tree || !prefix || !callback)
+    return 0;
+
+  DBRadixNode *node = tree->root, *child;
+  db_uint_t position, common;
+
+  while (prefix_length)
+  {
+    if (!_radix_find_child(node, (unsigned char)*prefix, &position))
+      return 0;
+
+    child = node->children[position];
+    common = prefix_length < child->label_length ? prefix_length : child->label_length;
+    if (memcmp(child->label, prefix, common) != 0)
+      return 0;
+
+    // the prefix may end inside the label, then every key below the child matches
+    node = child;
+    prefix += common;
+    prefix_length -= common;
+  }
+
+  return _radix_walk(node, callback, context);
+}
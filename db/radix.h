@@ -0,0 +1,31 @@
+#ifndef DB_RADIX_H
+#define DB_RADIX_H
+
+#include "types.h"
+
+// Called for each key found by `radix_walk_prefix` with the value stored under the key
+typedef void (*DBRadixWalkFunc)(void *value, void *context);
+
+// Creates an empty radix tree
+DBRadixTree *radix_create();
+
+// Removes all keys from a radix tree
+void radix_clear(DBRadixTree *tree);
+
+// Frees a radix tree, the stored values are not freed
+void radix_free(DBRadixTree *tree);
+
+// Inserts a key or replaces its value; returns true if the key is new
+db_bool_t radix_insert(DBRadixTree *tree, const char *key, void *value);
+
+// Removes a key; returns true if the key was found
+db_bool_t radix_remove(DBRadixTree *tree, const char *key);
+
+// Retrieves the value stored under a key; returns NULL if not found
+void *radix_get(DBRadixTree *tree, const char *key);
+
+// Calls `callback` for every key starting with `prefix` in lexicographic order
+// Returns the number of visited keys
+db_uint_t radix_walk_prefix(DBRadixTree *tree, const char *prefix, db_uint_t prefix_length, DBRadixWalkFunc callback, void *context);
+
+#endif
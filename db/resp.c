@@ -0,0 +1,454 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#include "utils.h"
+#include "obj.h"
+#include "list.h"
+#include "arena.h"
+#include "interaction.h"
+#include "resp.h"
+
+// Smallest capacity of a buffer, it doubles from there
+#define RESP_BUFFER_MIN_CAPACITY 256
+// Longest line of a number, including its type byte
+#define RESP_NUMBER_LINE_SIZE 48
+
+void resp_buffer_init(DBRespBuffer *buffer)
+{
+  buffer->data = NULL;
+  buffer->length = 0;
+  buffer->capacity = 0;
+}
+
+void resp_buffer_free(DBRespBuffer *buffer)
+{
+  free(buffer->data);
+  resp_buffer_init(buffer);
+}
+
+char *resp_buffer_take(DBRespBuffer *buffer, size_t *length)
+{
+  char *data = buffer->data;
+  if (!data)
+  {
+    data = (char *)malloc(1);
+    if (!data)
+      EXIT_ON_MEMORY_ERROR();
+  }
+  data[buffer->length] = '\0';
+  if (length)
+    *length = buffer->length;
+  resp_buffer_init(buffer);
+  return data;
+}
+
+// Makes room for `extra` bytes and a terminator
+static void resp_buffer_reserve(DBRespBuffer *buffer, size_t extra)
+{
+  if (buffer->length + extra < buffer->capacity)
+    return;
+
+  size_t capacity = buffer->capacity ? buffer->capacity : RESP_BUFFER_MIN_CAPACITY;
+  while (buffer->length + extra >= capacity)
+    capacity *= 2;
+  char *data = (char *)realloc(buffer->data, capacity);
+  if (!data)
+    EXIT_ON_MEMORY_ERROR();
+  buffer->data = data;
+  buffer->capacity = capacity;
+}
+
+static void resp_buffer_append(DBRespBuffer *buffer, const char *data, size_t length)
+{
+  resp_buffer_reserve(buffer, length);
+  memcpy(buffer->data + buffer->length, data, length);
+  buffer->length += length;
+}
+
+static void resp_append_number(DBRespBuffer *buffer, char type, long long value)
+{
+  char line[RESP_NUMBER_LINE_SIZE];
+  int length = snprintf(line, sizeof(line), "%c%lld\r\n", type, value);
+  resp_buffer_append(buffer, line, (size_t)length);
+}
+
+static void resp_append_bulk(DBRespBuffer *buffer, const char *string, size_t length)
+{
+  resp_append_number(buffer, '$', (long long)length);
+  resp_buffer_reserve(buffer, length + 2);
+  memcpy(buffer->data + buffer->length, string, length);
+  memcpy(buffer->data + buffer->length + length, "\r\n", 2);
+  buffer->length += length + 2;
+}
+
+// Simple strings and errors cannot hold line breaks, they are replaced with spaces
+static void resp_append_simple(DBRespBuffer *buffer, char type, const char *string)
+{
+  size_t length = strlen(string);
+  resp_buffer_reserve(buffer, length + 3);
+  char *out = buffer->data + buffer->length;
+  *out++ = type;
+  for (size_t i = 0; i < length; ++i)
+    *out++ = string[i] == '\r' || string[i] == '\n' ? ' ' : string[i];
+  *out++ = '\r';
+  *out++ = '\n';
+  buffer->length += length + 3;
+}
+
+void resp_encode_reply(DBRespBuffer *buffer, DBObj *obj, db_uint8_t protocol)
+{
+  char number[DBOBJ_NUMBER_BUFFER_SIZE];
+
+  switch (obj ? obj->type : DB_TYPE_NULL)
+  {
+  case DB_TYPE_NULL:
+    resp_buffer_append(buffer, protocol >= RESP_PROTOCOL_3 ? "_\r\n" : "$-1\r\n", protocol >= RESP_PROTOCOL_3 ? 3 : 5);
+    break;
+  case DB_TYPE_ERROR:
+    resp_append_simple(buffer, '-', obj->value.message && *obj->value.message ? obj->value.message : "ERR");
+    break;
+  case DB_TYPE_BOOL:
+    if (protocol >= RESP_PROTOCOL_3)
+      resp_buffer_append(buffer, obj->value.bool_value ? "#t\r\n" : "#f\r\n", 4);
+    else
+      resp_append_number(buffer, ':', obj->value.bool_value ? 1 : 0);
+    break;
+  case DB_TYPE_INT:
+    resp_append_number(buffer, ':', obj->value.int_value);
+    break;
+  case DB_TYPE_UINT:
+    resp_append_number(buffer, ':', obj->value.uint_value);
+    break;
+  case DB_TYPE_DOUBLE:
+    dbobj_format_double(obj->value.double_value, number);
+    if (protocol >= RESP_PROTOCOL_3)
+      resp_append_simple(buffer, ',', number);
+    else
+      resp_append_bulk(buffer, number, strlen(number));
+    break;
+  case DB_TYPE_STRING:
+  {
+    // status replies are simple strings, as clients expect `+OK`
+    if (obj == dbobj_shared_ok())
+    {
+      resp_buffer_append(buffer, "+OK\r\n", 5);
+      break;
+    }
+    const char *string = dbobj_string_view(obj, number);
+    if (string)
+      resp_append_bulk(buffer, string, strlen(string));
+    else
+      resp_encode_reply(buffer, NULL, protocol);
+    break;
+  }
+  case DB_TYPE_LIST:
+  {
+    // replies are built as linked lists, stored quicklists never leave the database
+    DBList *list = obj->encoding == DB_ENC_DEFAULT ? obj->value.list : NULL;
+    resp_append_number(buffer, '*', list ? list->length : 0);
+    for (DBListNode *node = list ? list->head : NULL; node; node = node->next)
+      resp_encode_reply(buffer, node->data, protocol);
+    break;
+  }
+  default:
+    resp_append_simple(buffer, '-', "ERR reply cannot be encoded");
+    break;
+  }
+}
+
+void resp_encode_command(DBRespBuffer *buffer, db_uint_t argc, const char *const *argv)
+{
+  resp_append_number(buffer, '*', argc);
+  for (db_uint_t i = 0; i < argc; ++i)
+    resp_append_bulk(buffer, argv[i], strlen(argv[i]));
+}
+
+// Finds the CR of the line break ending the line at `data`, the next line starts 2 bytes later
+// Returns NULL if the input ends before it
+static const char *resp_find_line(const char *data, const char *end, db_resp_status_t *status)
+{
+  const char *p = data;
+  while ((p = memchr(p, '\r', end - p)))
+  {
+    if (p + 1 == end)
+      break;
+    if (p[1] == '\n')
+      return p;
+    ++p;
+  }
+  *status = DB_RESP_INCOMPLETE;
+  return NULL;
+}
+
+// Parses a whole line as a decimal integer
+static db_bool_t resp_parse_integer(const char *start, const char *end, long long *value)
+{
+  db_bool_t negative = start < end && *start == '-';
+  const char *p = negative || (start < end && *start == '+') ? start + 1 : start;
+  unsigned long long result = 0;
+
+  if (p == end)
+    return false;
+  for (; p < end; ++p)
+  {
+    if (*p < '0' || *p > '9' || result > (unsigned long long)LLONG_MAX / 10)
+      return false;
+    result = result * 10 + (unsigned long long)(*p - '0');
+    if (result > (unsigned long long)LLONG_MAX)
+      return false;
+  }
+  *value = negative ? -(long long)result : (long long)result;
+  return true;
+}
+
+// Reads the length line of a bulk string or an aggregate; returns false on a protocol error or an incomplete line
+static db_bool_t resp_read_length(const char **pos, const char *end, long long max, long long *length, db_resp_status_t *status)
+{
+  const char *line_end = resp_find_line(*pos, end, status);
+  if (!line_end)
+    return false;
+  if (!resp_parse_integer(*pos, line_end, length) || *length < -1 || *length > max)
+  {
+    *status = DB_RESP_PROTOCOL_ERROR;
+    return false;
+  }
+  *pos = line_end + 2;
+  return true;
+}
+
+// Reads the payload of a bulk string of `length` bytes and its line break
+static const char *resp_read_bulk(const char **pos, const char *end, long long length, db_resp_status_t *status)
+{
+  const char *bulk = *pos;
+  if (end - bulk < length + 2)
+  {
+    *status = DB_RESP_INCOMPLETE;
+    return NULL;
+  }
+  if (bulk[length] != '\r' || bulk[length + 1] != '\n')
+  {
+    *status = DB_RESP_PROTOCOL_ERROR;
+    return NULL;
+  }
+  *pos = bulk + length + 2;
+  return bulk;
+}
+
+static char *resp_strndup(const char *string, size_t length)
+{
+  char *copy = (char *)malloc(length + 1);
+  if (!copy)
+    EXIT_ON_MEMORY_ERROR();
+  memcpy(copy, string, length);
+  copy[length] = '\0';
+  return copy;
+}
+
+static DBObj *resp_decode_value(const char **pos, const char *end, db_uint_t depth, db_resp_status_t *status);
+
+// Decodes `count` values into a list, maps have two values per entry
+static DBObj *resp_decode_aggregate(const char **pos, const char *end, long long count, db_uint_t depth, db_resp_status_t *status)
+{
+  DBList *list = create_dblist();
+  for (long long i = 0; i < count; ++i)
+  {
+    DBObj *element = resp_decode_value(pos, end, depth + 1, status);
+    if (!element)
+    {
+      free_dblist(list);
+      return NULL;
+    }
+    rpush(list, create_dblistnode(element));
+  }
+  return dbobj_create_list(list);
+}
+
+static DBObj *resp_decode_value(const char **pos, const char *end, db_uint_t depth, db_resp_status_t *status)
+{
+  const char *p = *pos, *line_end, *bulk;
+  long long length;
+  char number[RESP_NUMBER_LINE_SIZE];
+  DBObj *obj;
+
+  if (p == end)
+  {
+    *status = DB_RESP_INCOMPLETE;
+    return NULL;
+  }
+  if (depth > RESP_MAX_DEPTH)
+  {
+    *status = DB_RESP_PROTOCOL_ERROR;
+    return NULL;
+  }
+
+  char type = *p++;
+  switch (type)
+  {
+  case '+':
+  case '-':
+  case '(':
+    // big numbers are kept as their text
+    if (!(line_end = resp_find_line(p, end, status)))
+      return NULL;
+    *pos = line_end + 2;
+    if (type == '-')
+      return dbobj_create_error(resp_strndup(p, line_end - p));
+    return dbobj_create_string(resp_strndup(p, line_end - p));
+  case ':':
+    if (!(line_end = resp_find_line(p, end, status)))
+      return NULL;
+    if (!resp_parse_integer(p, line_end, &length))
+      break;
+    *pos = line_end + 2;
+    if (length >= INT32_MIN && length <= INT32_MAX)
+      return dbobj_create_int((db_int_t)length);
+    if (length >= 0 && length <= UINT32_MAX)
+      return dbobj_create_uint((db_uint_t)length);
+    return dbobj_create_double((db_double_t)length);
+  case ',':
+  {
+    if (!(line_end = resp_find_line(p, end, status)))
+      return NULL;
+    if (line_end == p || line_end - p >= RESP_NUMBER_LINE_SIZE)
+      break;
+    memcpy(number, p, line_end - p);
+    number[line_end - p] = '\0';
+    char *number_end;
+    db_double_t value = strtod(number, &number_end);
+    if (number_end != number + (line_end - p))
+      break;
+    *pos = line_end + 2;
+    return dbobj_create_double(value);
+  }
+  case '#':
+    if (!(line_end = resp_find_line(p, end, status)))
+      return NULL;
+    if (line_end - p != 1 || (*p != 't' && *p != 'f'))
+      break;
+    *pos = line_end + 2;
+    return dbobj_create_bool(*p == 't');
+  case '_':
+    if (!(line_end = resp_find_line(p, end, status)))
+      return NULL;
+    if (line_end != p)
+      break;
+    *pos = line_end + 2;
+    return dbobj_create_null();
+  case '$':
+  case '!':
+  case '=':
+    if (!resp_read_length(&p, end, RESP_MAX_BULK_LENGTH, &length, status))
+      return NULL;
+    if (length == -1)
+    {
+      *pos = p;
+      return dbobj_create_null();
+    }
+    if (!(bulk = resp_read_bulk(&p, end, length, status)))
+      return NULL;
+    // verbatim strings start with their format, such as "txt:"
+    if (type == '=')
+    {
+      if (length < 4 || bulk[3] != ':')
+        break;
+      bulk += 4;
+      length -= 4;
+    }
+    *pos = p;
+    if (type == '!')
+      return dbobj_create_error(resp_strndup(bulk, length));
+    return dbobj_create_string(resp_strndup(bulk, length));
+  case '*':
+  case '~':
+  case '>':
+  case '%':
+  case '|':
+    if (!resp_read_length(&p, end, RESP_MAX_ARRAY_LENGTH, &length, status))
+      return NULL;
+    if (length == -1)
+    {
+      if (type != '*')
+        break;
+      *pos = p;
+      return dbobj_create_null();
+    }
+    if (!(obj = resp_decode_aggregate(&p, end, type == '%' || type == '|' ? length * 2 : length, depth, status)))
+      return NULL;
+    // attributes describe the value that follows them, which is the one returned
+    if (type == '|')
+    {
+      free_dbobj(obj);
+      if (!(obj = resp_decode_value(&p, end, depth, status)))
+        return NULL;
+    }
+    *pos = p;
+    return obj;
+  }
+
+  *status = DB_RESP_PROTOCOL_ERROR;
+  return NULL;
+}
+
+DBObj *resp_decode(const char *data, size_t length, size_t *consumed, db_resp_status_t *status)
+{
+  const char *pos = data;
+  DBObj *obj = resp_decode_value(&pos, data + length, 0, status);
+  if (!obj)
+    return NULL;
+  *status = DB_RESP_OK;
+  *consumed = pos - data;
+  return obj;
+}
+
+db_resp_status_t resp_decode_command(const char *data, size_t length, size_t *consumed, DBRequest *request, const char **name)
+{
+  const char *pos = data, *end = data + length, *bulk;
+  long long count, bulk_length;
+  db_resp_status_t status = DB_RESP_OK;
+
+  *name = NULL;
+  if (pos == end)
+    return DB_RESP_INCOMPLETE;
+  if (*pos++ != '*')
+    return DB_RESP_PROTOCOL_ERROR;
+  if (!resp_read_length(&pos, end, RESP_MAX_ARRAY_LENGTH, &count, &status))
+    return status;
+
+  // the whole command is checked before anything is added, so an incomplete one can be decoded again later
+  const char *args = pos;
+  for (long long i = 0; i < count; ++i)
+  {
+    if (pos == end)
+      return DB_RESP_INCOMPLETE;
+    if (*pos++ != '$')
+      return DB_RESP_PROTOCOL_ERROR;
+    if (!resp_read_length(&pos, end, RESP_MAX_BULK_LENGTH, &bulk_length, &status))
+      return status;
+    if (bulk_length < 0)
+      return DB_RESP_PROTOCOL_ERROR;
+    if (!resp_read_bulk(&pos, end, bulk_length, &status))
+      return status;
+  }
+  *consumed = pos - data;
+
+  // the lengths were checked above, so the second pass only slices the arguments
+  pos = args;
+  for (long long i = 0; i < count; ++i)
+  {
+    bulk_length = strtoll(pos + 1, NULL, 10);
+    bulk = (const char *)memchr(pos, '\n', end - pos) + 1;
+    pos = bulk + bulk_length + 2;
+    if (i == 0)
+    {
+      *name = arena_strndup(&request->arena, bulk, bulk_length);
+      continue;
+    }
+    // the bulk is followed by its line break, which ends the number for strtol and strtod
+    DBObj *arg = dbobj_create_arena_number(&request->arena, bulk, bulk_length);
+    add_request_arg(request, arg ? arg : dbobj_create_arena_string(arena_strndup(&request->arena, bulk, bulk_length)));
+  }
+
+  return DB_RESP_OK;
+}
@@ -0,0 +1,37 @@
+#ifndef DB_RESP_H
+#define DB_RESP_H
+
+#include <stddef.h>
+
+#include "types.h"
+
+// Protocol versions of the encoder, RESP3 adds typed nulls, booleans and doubles
+#define RESP_PROTOCOL_2 2
+#define RESP_PROTOCOL_3 3
+// Longest bulk string and largest array accepted by the decoder
+#define RESP_MAX_BULK_LENGTH (512 * 1024 * 1024)
+#define RESP_MAX_ARRAY_LENGTH (1024 * 1024)
+// Deepest nesting of aggregates accepted by the decoder
+#define RESP_MAX_DEPTH 32
+
+void resp_buffer_init(DBRespBuffer *buffer);
+void resp_buffer_free(DBRespBuffer *buffer);
+// Gives the data of the buffer to the caller, terminated so it can be printed, and empties the buffer
+char *resp_buffer_take(DBRespBuffer *buffer, size_t *length);
+
+// Appends a reply object to `buffer`, lists become arrays and nested lists nested arrays
+// With RESP2, nulls are null bulk strings, booleans integers and doubles bulk strings
+void resp_encode_reply(DBRespBuffer *buffer, DBObj *obj, db_uint8_t protocol);
+
+// Appends a command as an array of bulk strings, the form clients send
+void resp_encode_command(DBRespBuffer *buffer, db_uint_t argc, const char *const *argv);
+
+// Decodes one value of either protocol from the `length` bytes at `data` and stores the number of bytes it took in `consumed`
+// Arrays, sets and pushes become lists, maps flat lists of keys and values, and attributes are skipped
+DBObj *resp_decode(const char *data, size_t length, size_t *consumed, db_resp_status_t *status);
+
+// Decodes one command sent as an array of bulk strings, adding its arguments to `request` and pointing `name` to the command name
+// Arguments are copied into the request arena, numeric ones as arena numbers, see `dbobj_create_arena_number`
+db_resp_status_t resp_decode_command(const char *data, size_t length, size_t *consumed, DBRequest *request, const char **name);
+
+#endif
@@ -0,0 +1,176 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+#include "utils.h"
+#include "slab.h"
+
+// Header at the start of each slab, the blocks follow it
+// A block is found back from its address by masking it with the slab size
+typedef struct DBSlab
+{
+  struct DBSlab *prev;
+  struct DBSlab *next;
+  // Freed blocks, linked through their first bytes
+  void *free_blocks;
+  // Offset of the first block never handed out, new slabs are carved in address order
+  db_uint_t unused_offset;
+  db_uint_t used;
+  db_uint_t capacity;
+  db_uint_t block_size;
+} DBSlab;
+
+typedef struct DBSlabClass
+{
+  // Slabs with at least one free block, allocations are served from the head
+  DBSlab *available;
+  db_uint_t slabs;
+  db_uint_t used;
+  db_uint_t capacity;
+  // Client threads also free objects (replies, request arguments), the critical sections are a few instructions
+  atomic_bool locked;
+} DBSlabClass;
+
+// Blocks start after the header, at an aligned offset
+#define DBSLAB_HEADER_SIZE ((sizeof(DBSlab) + DBSLAB_ALIGNMENT - 1) / DBSLAB_ALIGNMENT * DBSLAB_ALIGNMENT)
+
+static DBSlabClass slab_classes[DBSLAB_CLASSES];
+
+static inline db_uint_t _dbslab_class_index(size_t size)
+{
+  return size ? (db_uint_t)((size - 1) / DBSLAB_ALIGNMENT) : 0;
+}
+
+static inline void _dbslab_lock(DBSlabClass *class)
+{
+  while (atomic_exchange_explicit(&class->locked, true, memory_order_acquire))
+    ;
+}
+
+static inline void _dbslab_unlock(DBSlabClass *class)
+{
+  atomic_store_explicit(&class->locked, false, memory_order_release);
+}
+
+static void _dbslab_link(DBSlabClass *class, DBSlab *slab)
+{
+  slab->prev = NULL;
+  slab->next = class->available;
+  if (class->available)
+    class->available->prev = slab;
+  class->available = slab;
+}
+
+static void _dbslab_unlink(DBSlabClass *class, DBSlab *slab)
+{
+  if (slab->prev)
+    slab->prev->next = slab->next;
+  else
+    class->available = slab->next;
+  if (slab->next)
+    slab->next->prev = slab->prev;
+  slab->prev = slab->next = NULL;
+}
+
+static DBSlab *_dbslab_create(DBSlabClass *class, db_uint_t block_size)
+{
+  DBSlab *slab = (DBSlab *)aligned_alloc(DBSLAB_SIZE, DBSLAB_SIZE);
+  if (!slab)
+    EXIT_ON_MEMORY_ERROR();
+  slab->free_blocks = NULL;
+  slab->unused_offset = DBSLAB_HEADER_SIZE;
+  slab->used = 0;
+  slab->capacity = (DBSLAB_SIZE - DBSLAB_HEADER_SIZE) / block_size;
+  slab->block_size = block_size;
+  _dbslab_link(class, slab);
+  ++class->slabs;
+  class->capacity += slab->capacity;
+  return slab;
+}
+
+void *dbslab_alloc(size_t size)
+{
+  if (size > DBSLAB_MAX_BLOCK_SIZE)
+  {
+    void *block = malloc(size);
+    if (!block)
+      EXIT_ON_MEMORY_ERROR();
+    return block;
+  }
+
+  db_uint_t index = _dbslab_class_index(size);
+  DBSlabClass *class = &slab_classes[index];
+  void *block;
+
+  _dbslab_lock(class);
+  DBSlab *slab = class->available ? class->available : _dbslab_create(class, (index + 1) * DBSLAB_ALIGNMENT);
+  if (slab->free_blocks)
+  {
+    block = slab->free_blocks;
+    slab->free_blocks = *(void **)block;
+  }
+  else
+  {
+    block = (unsigned char *)slab + slab->unused_offset;
+    slab->unused_offset += slab->block_size;
+  }
+  ++class->used;
+  // a full slab leaves the available list until one of its blocks is freed
+  if (++slab->used == slab->capacity)
+    _dbslab_unlink(class, slab);
+  _dbslab_unlock(class);
+
+  return block;
+}
+
+void dbslab_free(void *block, size_t size)
+{
+  if (!block)
+    return;
+  if (size > DBSLAB_MAX_BLOCK_SIZE)
+  {
+    free(block);
+    return;
+  }
+
+  DBSlabClass *class = &slab_classes[_dbslab_class_index(size)];
+  DBSlab *slab = (DBSlab *)((uintptr_t)block & ~(uintptr_t)(DBSLAB_SIZE - 1));
+
+  _dbslab_lock(class);
+  *(void **)block = slab->free_blocks;
+  slab->free_blocks = block;
+  --class->used;
+  if (slab->used-- == slab->capacity)
+    _dbslab_link(class, slab);
+  // an empty slab goes back to the system, unless it is the last one with free blocks
+  if (!slab->used && (class->available != slab || slab->next))
+  {
+    _dbslab_unlink(class, slab);
+    --class->slabs;
+    class->capacity -= slab->capacity;
+    free(slab);
+  }
+  _dbslab_unlock(class);
+}
+
+db_uint_t dbslab_stats(DBSlabStats *stats)
+{
+  db_uint_t count = 0;
+
+  for (db_uint_t i = 0; i < DBSLAB_CLASSES; ++i)
+  {
+    DBSlabClass *class = &slab_classes[i];
+    _dbslab_lock(class);
+    if (class->slabs)
+    {
+      stats[count].block_size = (i + 1) * DBSLAB_ALIGNMENT;
+      stats[count].slabs = class->slabs;
+      stats[count].used_blocks = class->used;
+      stats[count].total_blocks = class->capacity;
+      ++count;
+    }
+    _dbslab_unlock(class);
+  }
+
+  return count;
+}
@@ -0,0 +1,26 @@
+#ifndef DB_SLAB_H
+#define DB_SLAB_H
+
+#include <stddef.h>
+
+#include "types.h"
+
+// Bytes of a slab, slabs are aligned to their size
+#define DBSLAB_SIZE 65536
+// Block sizes are rounded up to a multiple of this
+#define DBSLAB_ALIGNMENT 8
+// Larger blocks are allocated with malloc
+#define DBSLAB_MAX_BLOCK_SIZE 256
+#define DBSLAB_CLASSES (DBSLAB_MAX_BLOCK_SIZE / DBSLAB_ALIGNMENT)
+
+// Allocates a block from the slabs of its size class, blocks of the same class are packed together
+// Used for the small structures of the engine: DBObj, DBListNode, DBHashEntry and DBZSetElement
+void *dbslab_alloc(size_t size);
+
+// Returns a block to its slab, `size` must be the size it was allocated with
+void dbslab_free(void *block, size_t size);
+
+// Fills `stats` (DBSLAB_CLASSES entries) with the classes that have slabs; returns the number of entries
+db_uint_t dbslab_stats(DBSlabStats *stats);
+
+#endif
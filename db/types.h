@@ -3,6 +3,7 @@
 
 #include <stdlib.h>
 #include <stdint.h>
+#include <time.h>
 #include <float.h>
 #include <stdbool.h>
 
@@ -12,6 +13,11 @@
 #define DB_ERR_NONEXISTENT_KEY "ERR no such key"
 #define DB_ERR_SYNTAX_ERROR "ERR syntax error"
 #define DB_ERR_UNKNOWN_COMMAND "ERR unknown command"
+#define DB_ERR_NOT_INTEGER "ERR value is not an integer or out of range"
+#define DB_ERR_NOT_FLOAT "ERR value is not a valid float"
+#define DB_ERR_SCORE_NAN "ERR resulting score is not a number (NaN)"
+#define DB_ERR_INDEX_OUT_OF_RANGE "ERR index out of range"
+#define DB_ERR_PROTOCOL_ERROR "ERR Protocol error"
 
 typedef enum db_type_t
 {
@@ -28,12 +34,39 @@ typedef enum db_type_t
   DB_TYPE_HASH
 } db_type_t;
 
+// Internal representation of an object, a type may have several encodings
+typedef enum db_encoding_t
+{
+  DB_ENC_DEFAULT,
+  // DB_TYPE_HASH stored in a DBListpack
+  DB_ENC_LISTPACK,
+  // DB_TYPE_STRING holding a canonical integer in `int_value`
+  DB_ENC_INT,
+  // DB_TYPE_STRING holding a number in `double_value`, set by float increments
+  DB_ENC_DOUBLE,
+  // DBZSet stored in its `entries` array instead of a skiplist
+  DB_ENC_SORTED_ARRAY,
+  // DB_TYPE_LIST stored in a DBQuicklist, used by every list of the database
+  DB_ENC_QUICKLIST,
+  // DB_TYPE_STRING whose characters live in the arena of a request, or in the memory of the caller of a
+  // request built on the stack; they are not freed with the object
+  DB_ENC_ARENA,
+  // DB_ENC_ARENA string of a numeric token, its characters are the `text` of a DBArenaNumber
+  DB_ENC_ARENA_NUMBER
+} db_encoding_t;
+
 typedef enum db_action_t
 {
   DB_UNKNOWN_COMMAND,
   DB_SAVE,
   DB_START,
   DB_SET,
+  DB_MGET,
+  DB_MSET,
+  DB_INCR,
+  DB_INCRBY,
+  DB_DECR,
+  DB_DECRBY,
   DB_GET,
   DB_RENAME,
   DB_DEL,
@@ -43,24 +76,46 @@ typedef enum db_action_t
   DB_RPOP,
   DB_LLEN,
   DB_LRANGE,
+  DB_MLRANGE,
+  DB_LINDEX,
+  DB_LSET,
+  DB_LTRIM,
+  DB_LINSERT,
+  DB_LREM,
+  DB_LPOS,
+  DB_BLPOP,
+  DB_BRPOP,
   DB_HGET,
   DB_HSET,
+  DB_HMGET,
+  DB_HGETALL,
   DB_HINCRBY,
+  DB_HINCRBYFLOAT,
   DB_HDEL,
   DB_EXPIRE,
+  DB_PEXPIRE,
+  DB_TTL,
+  DB_PTTL,
+  DB_PERSIST,
   DB_ZSCORE,
   DB_ZADD,
+  DB_ZINCRBY,
   DB_ZCARD,
   DB_ZCOUNT,
   DB_ZINTERSTORE,
   DB_ZUNIONSTORE,
   DB_ZRANGE,
   DB_ZRANGEBYSCORE,
+  DB_ZREVRANGE,
+  DB_ZREVRANGEBYSCORE,
   DB_ZRANK,
   DB_ZREM,
   DB_ZREMRANGEBYSCORE,
   DB_KEYS,
   DB_MATCH_KEYS,
+  DB_SCAN,
+  DB_HSCAN,
+  DB_ZSCAN,
   DB_FLUSHALL,
   DB_INFO_DATASET_MEMORY,
   DB_SHUTDOWN
@@ -73,11 +128,35 @@ typedef enum db_aggregate_t
   DB_AGG_MIN
 } db_aggregate_t;
 
+// Only add new members
+#define DB_ZADD_FLAG_NX 0x01
+// Only update existing members
+#define DB_ZADD_FLAG_XX 0x02
+// Only update a member if its new score is greater than the current one
+#define DB_ZADD_FLAG_GT 0x04
+// Only update a member if its new score is less than the current one
+#define DB_ZADD_FLAG_LT 0x08
+// Add the score to the current score of the member, new members start at 0
+#define DB_ZADD_FLAG_INCR 0x10
+
+typedef enum db_zadd_result_t
+{
+  // the flags prevented the change
+  DB_ZADD_ABORTED,
+  DB_ZADD_UNCHANGED,
+  DB_ZADD_ADDED,
+  DB_ZADD_UPDATED,
+  // the increment would make the score NaN, nothing was changed
+  DB_ZADD_NAN
+} db_zadd_result_t;
+
 typedef bool db_bool_t;
 typedef int32_t db_int_t;
 typedef uint32_t db_uint_t;
 typedef double db_double_t;
 typedef uint8_t db_uint8_t;
+// Unix time or duration in milliseconds
+typedef int64_t db_mstime_t;
 
 #define DB_UINT_MAX UINT32_MAX
 #define DB_DBL_P_INF DBL_MAX
@@ -99,13 +178,72 @@ typedef struct DBList
   db_uint_t length;
 } DBList;
 
+// The entry has an expiration time in `expires_at`
+#define DB_ENTRY_FLAG_VOLATILE 0x01
+// The key of the entry is shared through the intern pool
+#define DB_ENTRY_FLAG_INTERNED_KEY 0x02
+
 typedef struct DBHashEntry
 {
   char *key;
   struct DBHashEntry *next;
   DBObj *data;
+  // Absolute expiration time in milliseconds, only valid with DB_ENTRY_FLAG_VOLATILE
+  db_mstime_t expires_at;
+  // Position of the entry in the expires heap of its table
+  db_uint_t expires_index;
+  db_uint8_t flags;
 } DBHashEntry;
 
+// Binary min-heap of volatile entries, ordered by expiration time
+typedef struct DBExpiresHeap
+{
+  db_uint_t size;
+  db_uint_t capacity;
+  DBHashEntry **entries;
+} DBExpiresHeap;
+
+// Run of pattern characters between two `*` of a glob pattern
+typedef struct DBGlobSegment
+{
+  // Unescaped characters, positions of `?` hold an arbitrary byte
+  char *chars;
+  // NULL if the segment has no `?`, otherwise true at the positions of `?`
+  db_bool_t *any;
+  db_uint_t length;
+  // Longest run without `?`, searched first when looking for the segment
+  db_uint_t anchor_offset;
+  db_uint_t anchor_length;
+} DBGlobSegment;
+
+// Glob pattern compiled by `dbutil_glob_compile`
+typedef struct DBGlobPattern
+{
+  // `*` are between the segments, so the first segment is a prefix and the last a suffix
+  DBGlobSegment *segments;
+  db_uint_t segments_count;
+  // Total length of all segments, the minimum length of a matching key
+  db_uint_t min_length;
+} DBGlobPattern;
+
+// Node of a radix tree, the edge from the parent is labeled with `label`
+typedef struct DBRadixNode
+{
+  char *label;
+  db_uint_t label_length;
+  // NULL if no key ends at this node
+  void *value;
+  db_uint_t children_count;
+  // Sorted by the first byte of their labels
+  struct DBRadixNode **children;
+} DBRadixNode;
+
+typedef struct DBRadixTree
+{
+  DBRadixNode *root;
+  db_uint_t size;
+} DBRadixTree;
+
 typedef struct DBHash
 {
   db_uint_t size0;
@@ -122,28 +260,114 @@ typedef struct DBHash
   // The occurrence of rehashing is determined by periodic tasks; when rehashing starts, rehashing_index will be the last index of the table size
   // Rehashing will be handled during periodic task execution and during db_insert_entry and db_get_entry.
   db_int_t rehashing_index;
+  // Created on demand when the first entry of the table gets an expiration time
+  DBExpiresHeap *expires;
+  // Optional ordered index of the keys, used to answer prefix queries
+  DBRadixTree *prefix_index;
+  // New keys are shared through the intern pool instead of being duplicated
+  db_bool_t intern_keys;
 } DBHash;
 
+// Field/value pairs stored back to back in one buffer, for small hashes
+// Each string is stored as [length byte][bytes]['\0'], so it can be read in place
+typedef struct DBListpack
+{
+  // Number of field/value pairs
+  db_uint_t length;
+  // Number of bytes used by `entries`
+  db_uint_t size;
+  unsigned char *entries;
+} DBListpack;
+
+// Node of a quicklist, a single allocation holding `count` entries back to back
+// Each entry is stored as [length][bytes]['\0'], the length takes 1 byte, or 5 for long strings
+typedef struct DBQuicklistNode
+{
+  struct DBQuicklistNode *prev;
+  struct DBQuicklistNode *next;
+  db_uint_t count;
+  // Number of bytes used by `entries`
+  db_uint_t size;
+  // Number of bytes allocated for `entries`
+  db_uint_t capacity;
+  unsigned char entries[];
+} DBQuicklistNode;
+
+// Doubly linked list of packed nodes, for the lists stored in the database
+typedef struct DBQuicklist
+{
+  DBQuicklistNode *head;
+  DBQuicklistNode *tail;
+  // Number of entries in all nodes
+  db_uint_t length;
+  // A node is not filled past this many bytes, unless a single entry is larger
+  db_uint_t node_size;
+} DBQuicklist;
+
+typedef struct DBZSetLevel
+{
+  struct DBZSetElement *forward;
+  // number of level 0 steps skipped by `forward`, so ranks add up along a search path
+  db_uint_t span;
+} DBZSetLevel;
+
+// An element is a single allocation: the struct, its levels, then the characters of its member
 typedef struct DBZSetElement
 {
   db_double_t score;
   char *member;
+  db_uint_t member_hash;
+  // next element in the same bucket of the member index
+  struct DBZSetElement *next_in_bucket;
   db_uint8_t level;
   struct DBZSetElement *backward;
-  struct DBZSetElement **forward;
+  DBZSetLevel levels[];
 } DBZSetElement;
 
+// Member of a zset in the sorted array encoding
+typedef struct DBZSetEntry
+{
+  db_double_t score;
+  char *member;
+} DBZSetEntry;
+
 typedef struct DBZSet
 {
-  DBHash *dict;
+  // db_encoding_t, DB_ENC_SORTED_ARRAY or DB_ENC_DEFAULT for the skiplist
+  db_uint8_t encoding;
+  // sorted array encoding: `length` entries ordered by score, then by member
+  DBZSetEntry *entries;
+  db_uint_t entries_capacity;
+  // skiplist encoding: member index chained through the elements themselves, NULL until the first member is added
+  DBZSetElement **buckets;
+  // always a power of two
+  db_uint_t buckets_size;
   db_uint8_t level;
-  DBZSetElement **sentinel_forward;
+  // sentinel in front of the first element, it has every level
+  DBZSetElement *header;
   DBZSetElement *tail;
+  db_uint_t length;
 } DBZSet;
 
+// Occupancy of the slabs of a size class, see `dbslab_stats`
+typedef struct DBSlabStats
+{
+  db_uint_t block_size;
+  db_uint_t slabs;
+  // Blocks handed out
+  db_uint_t used_blocks;
+  // Blocks of all slabs, the free ones are the fragmentation of the class
+  db_uint_t total_blocks;
+} DBSlabStats;
+
 typedef struct DBObj
 {
-  db_type_t type;
+  // db_type_t
+  db_uint8_t type;
+  // db_encoding_t
+  db_uint8_t encoding;
+  // Number of owners, see `dbobj_retain`; atomic since replies are freed by the client threads
+  _Atomic db_uint_t refcount;
   union DBObjValue
   {
     db_bool_t bool_value;
@@ -157,13 +381,44 @@ typedef struct DBObj
     DBZSet *zset;
     DBZSetElement *_zsetele;
     DBHash *hash;
+    DBListpack *listpack;
+    DBQuicklist *quicklist;
   } value;
 } DBObj;
 
+// Block of a request arena, allocations are carved from `data` in order
+typedef struct DBArenaChunk
+{
+  struct DBArenaChunk *next;
+  size_t size;
+  size_t used;
+  unsigned char data[];
+} DBArenaChunk;
+
+// Bump allocator for the short-lived memory of a request, freed all at once
+typedef struct DBArena
+{
+  // The chunk being filled, followed by the full ones
+  DBArenaChunk *chunks;
+} DBArena;
+
+// Numeric argument of a parsed command, parsed once by the tokenizer
+// The token follows the numbers, so the argument is read as a string like any other
+typedef struct DBArenaNumber
+{
+  db_double_t double_value;
+  db_int_t int_value;
+  // the token is an integer within the range of `int_value`
+  db_bool_t is_int;
+  char text[];
+} DBArenaNumber;
+
 typedef struct DBRequest
 {
   db_action_t action;
   DBList *args;
+  // Argument strings and handler scratch, released with the request
+  DBArena arena;
 } DBRequest;
 
 typedef struct DBReply
@@ -172,4 +427,40 @@ typedef struct DBReply
   DBObj *data;
 } DBReply;
 
+// Queued request of the worker
+typedef struct DBTask
+{
+  clock_t created_at;
+  DBRequest *request;
+  DBReply *reply;
+  // the task belongs to the caller, which built the request on its stack, so the worker does not free it
+  db_bool_t caller_owned;
+  struct DBTask *next;
+} DBTask;
+
+typedef enum db_resp_status_t
+{
+  DB_RESP_OK,
+  // the input ends inside the value, more of it must be read first
+  DB_RESP_INCOMPLETE,
+  DB_RESP_PROTOCOL_ERROR
+} db_resp_status_t;
+
+// Growable output of the RESP encoder
+typedef struct DBRespBuffer
+{
+  char *data;
+  size_t length;
+  size_t capacity;
+} DBRespBuffer;
+
+// Counters of a bulk load, see `dbapi_pipe`
+typedef struct DBPipeStats
+{
+  db_uint_t commands;
+  db_uint_t errors;
+  size_t bytes;
+  db_double_t seconds;
+} DBPipeStats;
+
 #endif
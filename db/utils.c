@@ -2,6 +2,10 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <time.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #include "utils.h"
 
@@ -80,6 +84,13 @@ char *dbutil_strdup(const char *source)
   return dup;
 }
 
+db_mstime_t dbutil_mstime()
+{
+  struct timespec ts;
+  timespec_get(&ts, TIME_UTC);
+  return (db_mstime_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
 db_bool_t dbutil_match_keys(const char *source, const char *pattern)
 {
   const char *src_ptr = source;
@@ -143,6 +154,229 @@ db_bool_t dbutil_match_keys(const char *source, const char *pattern)
   return *pat_ptr == '\0';
 }
 
+static void _glob_finish_segment(DBGlobSegment *segment)
+{
+  db_uint_t run_offset = 0, i;
+
+  segment->anchor_offset = 0;
+  segment->anchor_length = 0;
+
+  for (i = 0; i <= segment->length; ++i)
+  {
+    if (i < segment->length && !(segment->any && segment->any[i]))
+      continue;
+    if (i - run_offset > segment->anchor_length)
+    {
+      segment->anchor_offset = run_offset;
+      segment->anchor_length = i - run_offset;
+    }
+    run_offset = i + 1;
+  }
+}
+
+DBGlobPattern *dbutil_glob_compile(const char *pattern)
+{
+  if (!pattern)
+    return NULL;
+
+  db_uint_t pattern_length = strlen(pattern), segments_count = 1, i;
+  DBGlobPattern *glob = (DBGlobPattern *)malloc(sizeof(DBGlobPattern));
+
+  if (!glob)
+    EXIT_ON_MEMORY_ERROR();
+
+  // every `*` starts at most one segment
+  for (i = 0; i < pattern_length; ++i)
+    if (pattern[i] == '*')
+      ++segments_count;
+
+  glob->segments = (DBGlobSegment *)malloc(segments_count * sizeof(DBGlobSegment));
+  if (!glob->segments)
+    EXIT_ON_MEMORY_ERROR();
+  glob->segments_count = 0;
+  glob->min_length = 0;
+
+  DBGlobSegment *segment = NULL;
+  const char *pat_ptr = pattern;
+
+  while (true)
+  {
+    if (!segment)
+    {
+      segment = &glob->segments[glob->segments_count++];
+      segment->chars = (char *)malloc(pattern_length + 1);
+      if (!segment->chars)
+        EXIT_ON_MEMORY_ERROR();
+      segment->any = NULL;
+      segment->length = 0;
+    }
+
+    if (*pat_ptr == '\0' || *pat_ptr == '*')
+    {
+      segment->chars[segment->length] = '\0';
+      _glob_finish_segment(segment);
+      glob->min_length += segment->length;
+      if (*pat_ptr == '\0')
+        break;
+      while (*pat_ptr == '*')
+        ++pat_ptr;
+      segment = NULL;
+      continue;
+    }
+
+    if (*pat_ptr == '?')
+    {
+      if (!segment->any)
+      {
+        segment->any = (db_bool_t *)calloc(pattern_length, sizeof(db_bool_t));
+        if (!segment->any)
+          EXIT_ON_MEMORY_ERROR();
+      }
+      segment->any[segment->length] = true;
+    }
+    else if (*pat_ptr == '\\' && pat_ptr[1])
+    {
+      ++pat_ptr;
+    }
+
+    segment->chars[segment->length++] = *pat_ptr++;
+  }
+
+  return glob;
+}
+
+void dbutil_glob_free(DBGlobPattern *glob)
+{
+  if (!glob)
+    return;
+
+  for (db_uint_t i = 0; i < glob->segments_count; ++i)
+  {
+    free(glob->segments[i].chars);
+    free(glob->segments[i].any);
+  }
+  free(glob->segments);
+  free(glob);
+}
+
+db_uint_t dbutil_glob_prefix(const DBGlobPattern *glob, const char **prefix)
+{
+  if (!glob)
+    return 0;
+
+  const DBGlobSegment *segment = &glob->segments[0];
+  db_uint_t length = 0;
+
+  while (length < segment->length && !(segment->any && segment->any[length]))
+    ++length;
+
+  *prefix = segment->chars;
+  return length;
+}
+
+static inline db_bool_t _glob_segment_equals(const DBGlobSegment *segment, const char *source)
+{
+  if (!segment->any)
+    return memcmp(segment->chars, source, segment->length) == 0;
+
+  for (db_uint_t i = 0; i < segment->length; ++i)
+    if (!segment->any[i] && segment->chars[i] != source[i])
+      return false;
+
+  return true;
+}
+
+// Finds the first occurrence of `needle` in `haystack`; returns NULL if not found
+static const char *_glob_find(const char *haystack, db_uint_t haystack_length, const char *needle, db_uint_t needle_length)
+{
+  if (needle_length > haystack_length)
+    return NULL;
+  if (needle_length == 1)
+    return (const char *)memchr(haystack, needle[0], haystack_length);
+
+  db_uint_t last = haystack_length - needle_length, i = 0;
+
+#ifdef __SSE2__
+  // compare 16 candidate positions at once against the first and the last byte of the needle,
+  // only the positions where both bytes match are verified with memcmp
+  const __m128i first = _mm_set1_epi8(needle[0]);
+  const __m128i tail = _mm_set1_epi8(needle[needle_length - 1]);
+  unsigned int mask;
+
+  for (; i + 16 <= last + 1; i += 16)
+  {
+    __m128i block_first = _mm_loadu_si128((const __m128i *)(haystack + i));
+    __m128i block_last = _mm_loadu_si128((const __m128i *)(haystack + i + needle_length - 1));
+    mask = (unsigned int)_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(block_first, first), _mm_cmpeq_epi8(block_last, tail)));
+    while (mask)
+    {
+      unsigned int bit = __builtin_ctz(mask);
+      if (memcmp(haystack + i + bit + 1, needle + 1, needle_length - 2) == 0)
+        return haystack + i + bit;
+      mask &= mask - 1;
+    }
+  }
+#endif
+
+  const char *candidate;
+  while (i <= last)
+  {
+    candidate = (const char *)memchr(haystack + i, needle[0], last - i + 1);
+    if (!candidate)
+      return NULL;
+    i = candidate - haystack;
+    if (memcmp(candidate + 1, needle + 1, needle_length - 1) == 0)
+      return candidate;
+    ++i;
+  }
+
+  return NULL;
+}
+
+db_bool_t dbutil_glob_match(const DBGlobPattern *glob, const char *source, db_uint_t length)
+{
+  if (!glob || !source || length < glob->min_length)
+    return false;
+
+  const DBGlobSegment *first = &glob->segments[0];
+  const DBGlobSegment *last = &glob->segments[glob->segments_count - 1];
+
+  if (glob->segments_count == 1)
+    return length == first->length && _glob_segment_equals(first, source);
+
+  // the literal prefix and suffix reject most keys before any search
+  if (!_glob_segment_equals(first, source) || !_glob_segment_equals(last, source + length - last->length))
+    return false;
+
+  // interior segments are matched at their leftmost position, which never rules out a later match
+  db_uint_t from = first->length, limit = length - last->length, i;
+  const DBGlobSegment *segment;
+  const char *found;
+
+  for (i = 1; i + 1 < glob->segments_count; ++i)
+  {
+    segment = &glob->segments[i];
+    while (true)
+    {
+      if (limit - from < segment->length)
+        return false;
+      if (!segment->anchor_length)
+        break;
+      found = _glob_find(source + from + segment->anchor_offset, limit - from - segment->length + segment->anchor_length,
+                         segment->chars + segment->anchor_offset, segment->anchor_length);
+      if (!found)
+        return false;
+      from = found - source - segment->anchor_offset;
+      if (_glob_segment_equals(segment, source + from))
+        break;
+      ++from;
+    }
+    from += segment->length;
+  }
+
+  return true;
+}
+
 void debug_print(const char *s)
 {
   printf("%s", s);
@@ -198,13 +432,27 @@ void test_dbutil_match_keys()
       {"hello", "h*llo", true},
       {"heeeello", "h*llo", true},
       {"hey", "h*llo", false},
+      {"post:0123456789abcdef:tags", "post:*:tags", true},
+      {"post:0123456789abcdef:name", "post:*:tags", false},
+      {"index:tag:post:0123456789abcdef", "*:tag:*", true},
+      {"aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaab", "*aab", true},
+      {"abababababababababababababababab:x", "*ba?ab*:x", true},
+      {"abababababababababababababababab:x", "*bb*", false},
+      {"abc", "**a**b**c**", true},
+      {"abc", "a*\\*c", false},
+      {"a*bc", "a*\\*?c", true},
   };
 
   size_t test_count = sizeof(test_cases) / sizeof(TestCase);
 
   for (size_t i = 0; i < test_count; ++i)
   {
+    DBGlobPattern *glob = dbutil_glob_compile(test_cases[i].pattern);
     db_bool_t result = dbutil_match_keys(test_cases[i].source, test_cases[i].pattern);
+    // the compiled matcher must agree with the interpreting one
+    if (dbutil_glob_match(glob, test_cases[i].source, strlen(test_cases[i].source)) != result)
+      result = !test_cases[i].expected;
+    dbutil_glob_free(glob);
     printf("[%s] Source: \"%s\", Pattern: \"%s\" (Expected: %s)\n",
            (result == test_cases[i].expected) ? RESULT_PASS : RESULT_FAIL,
            test_cases[i].source, test_cases[i].pattern,
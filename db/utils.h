@@ -17,8 +17,22 @@ char *input_string();
 // Duplicates a string, allocating memory for the new string.
 char *dbutil_strdup(const char *source);
 
+// Returns the current Unix time in milliseconds.
+db_mstime_t dbutil_mstime();
+
 db_bool_t dbutil_match_keys(const char *source, const char *pattern);
 
+// Compiles a glob pattern (`*`, `?` and `\` escapes) for repeated matching with `dbutil_glob_match`
+DBGlobPattern *dbutil_glob_compile(const char *pattern);
+
+void dbutil_glob_free(DBGlobPattern *glob);
+
+// Checks if a key of `length` bytes matches a compiled pattern
+db_bool_t dbutil_glob_match(const DBGlobPattern *glob, const char *source, db_uint_t length);
+
+// Points `prefix` to the literal characters before the first wildcard; returns their count
+db_uint_t dbutil_glob_prefix(const DBGlobPattern *glob, const char **prefix);
+
 void debug_print(const char *s);
 
 // Don't use this function, please use the marco "EXIT_ON_ERROR()".
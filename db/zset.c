@@ -8,116 +8,469 @@
 #include "hash.h"
 #include "list.h"
 #include "zset.h"
+#include "slab.h"
 
 #define SKIPLIST_MAXLEVEL 32
 #define SKIPLIST_P 0.25
 
-static int compare_zset_ele(const DBZSetElement *a, const DBZSetElement *b)
+// Orders members by score, then by member; returns a negative number if the first one comes first
+static int compare_zset_order(db_double_t score_a, const char *member_a, db_double_t score_b, const char *member_b)
 {
-  if (!a)
-    return -1;
-  if (!b)
-    return 1;
-  int s_cmp = a->score - b->score;
-  if (s_cmp)
-    return s_cmp;
-  return strcmp(a->member, b->member);
+  if (score_a != score_b)
+    return score_a < score_b ? -1 : 1;
+  return strcmp(member_a, member_b);
+}
+
+static inline int compare_zset_ele(const DBZSetElement *element, db_double_t score, const char *member)
+{
+  return compare_zset_order(element->score, element->member, score, member);
+}
+
+static inline db_bool_t zset_score_above_min(db_double_t score, db_double_t min, db_bool_t included_min)
+{
+  return included_min ? score >= min : score > min;
+}
+
+static inline db_bool_t zset_score_below_max(db_double_t score, db_double_t max, db_bool_t included_max)
+{
+  return included_max ? score <= max : score < max;
 }
 
-static DBZSetElement *lookup_previos_element_in_level(const DBZSet *zset, const db_uint8_t level, const DBZSetElement *element, DBZSetElement *start_ele)
+static db_bool_t zset_range_is_empty(DBZSet *zset, db_double_t min, db_bool_t included_min, db_double_t max, db_bool_t included_max)
 {
-  if (!zset || !element)
-    EXIT_ON_ERROR("Invalid ZSet or ZSetElement");
-  if (zset->level < level)
-    EXIT_ON_ERROR("Invalid ZSet Level");
-  DBZSetElement *current = start_ele ? start_ele : zset->sentinel_forward[level];
-  if (!current || compare_zset_ele(element, current) < 0)
+  if (min > max || (min == max && (!included_min || !included_max)))
+    return true;
+  if (!zset->tail || !zset_score_above_min(zset->tail->score, min, included_min))
+    return true;
+  DBZSetElement *first = zset->header->levels[0].forward;
+  return !first || !zset_score_below_max(first->score, max, included_max);
+}
+
+// Returns the first element within the score range, or NULL if there is none
+static DBZSetElement *lookup_first_element_in_range(DBZSet *zset, db_double_t min, db_bool_t included_min, db_double_t max, db_bool_t included_max)
+{
+  if (zset_range_is_empty(zset, min, included_min, max, included_max))
     return NULL;
-  while (current->forward[level] && compare_zset_ele(element, current->forward[level]) > 0)
-    current = current->forward[level];
-  return current;
+
+  DBZSetElement *current = zset->header;
+
+  for (int lvl = zset->level - 1; lvl >= 0; --lvl)
+    while (current->levels[lvl].forward && !zset_score_above_min(current->levels[lvl].forward->score, min, included_min))
+      current = current->levels[lvl].forward;
+
+  current = current->levels[0].forward;
+  return current && zset_score_below_max(current->score, max, included_max) ? current : NULL;
 }
 
-static DBZSetElement *lookup_first_element_with_score(
-    DBZSet *zset,
-    db_double_t score,
-    bool included_score)
+// Returns the last element within the score range, or NULL if there is none
+static DBZSetElement *lookup_last_element_in_range(DBZSet *zset, db_double_t min, db_bool_t included_min, db_double_t max, db_bool_t included_max)
 {
-  if (!zset)
-    EXIT_ON_ERROR("Invalid ZSet");
+  if (zset_range_is_empty(zset, min, included_min, max, included_max))
+    return NULL;
+
+  DBZSetElement *current = zset->header;
 
-  if (included_score && zset->sentinel_forward[0]->score == score)
-    return zset->sentinel_forward[0];
+  for (int lvl = zset->level - 1; lvl >= 0; --lvl)
+    while (current->levels[lvl].forward && zset_score_below_max(current->levels[lvl].forward->score, max, included_max))
+      current = current->levels[lvl].forward;
+
+  return current != zset->header && zset_score_above_min(current->score, min, included_min) ? current : NULL;
+}
 
-  DBZSetElement *current = NULL;
+// Returns the 1-based rank of an element, summing the spans along its search path
+static db_uint_t lookup_element_rank(DBZSet *zset, const DBZSetElement *element)
+{
+  DBZSetElement *current = zset->header;
+  db_uint_t rank = 0;
 
   for (int lvl = zset->level - 1; lvl >= 0; --lvl)
   {
-    if (!current && zset->sentinel_forward[lvl] && (included_score ? zset->sentinel_forward[lvl]->score < score : zset->sentinel_forward[lvl]->score <= score))
-      current = zset->sentinel_forward[lvl];
-    while (current && current->forward[lvl] &&
-           (included_score ? current->forward[lvl]->score < score
-                           : current->forward[lvl]->score <= score))
+    while (current->levels[lvl].forward && compare_zset_ele(current->levels[lvl].forward, element->score, element->member) <= 0)
     {
-      current = current->forward[lvl];
+      rank += current->levels[lvl].span;
+      current = current->levels[lvl].forward;
     }
+    if (current == element)
+      return rank;
   }
 
-  return current && current->forward[0] ? current->forward[0] : current;
+  return 0;
 }
 
-static DBZSetElement *lookup_last_element_with_score(
-    DBZSet *zset,
-    db_double_t score,
-    bool included_score)
+// Returns the element with a 1-based rank, or NULL if out of range
+static DBZSetElement *lookup_element_by_rank(DBZSet *zset, db_uint_t rank)
 {
-  if (!zset)
-    EXIT_ON_ERROR("Invalid ZSet");
-
-  DBZSetElement *current = NULL;
+  DBZSetElement *current = zset->header;
+  db_uint_t traversed = 0;
 
   for (int lvl = zset->level - 1; lvl >= 0; --lvl)
   {
-    if (!current && zset->sentinel_forward[lvl] &&
-        (included_score ? zset->sentinel_forward[lvl]->score <= score
-                        : zset->sentinel_forward[lvl]->score < score))
-      current = zset->sentinel_forward[lvl];
-
-    while (current && current->forward[lvl] &&
-           (included_score ? current->forward[lvl]->score <= score
-                           : current->forward[lvl]->score < score))
+    while (current->levels[lvl].forward && traversed + current->levels[lvl].span <= rank)
     {
-      current = current->forward[lvl];
+      traversed += current->levels[lvl].span;
+      current = current->levels[lvl].forward;
     }
+    if (traversed == rank)
+      return current;
   }
-  return current;
+
+  return NULL;
 }
 
-static DBZSetElement *create_zset_ele(db_double_t score, char *member)
+static db_uint8_t random_zset_level()
 {
   db_uint8_t level = 1;
   while (level < SKIPLIST_MAXLEVEL && (rand() & 0xFFFF) < (SKIPLIST_P * 0xFFFF))
-  {
     ++level;
-  }
-  DBZSetElement *new_el = (DBZSetElement *)malloc(sizeof(DBZSetElement));
+  return level;
+}
+
+// Bytes of an element with its levels and member, the size it was allocated with
+static inline size_t zset_ele_size(db_uint8_t level, db_uint_t member_length)
+{
+  return sizeof(DBZSetElement) + level * sizeof(DBZSetLevel) + member_length + 1;
+}
+
+static void free_zset_ele(DBZSetElement *element)
+{
+  dbslab_free(element, zset_ele_size(element->level, strlen(element->member)));
+}
+
+static DBZSetElement *create_zset_ele(db_uint8_t level, db_double_t score, const char *member, db_uint_t member_hash)
+{
+  db_uint_t member_length = strlen(member);
+  // the levels and the member are allocated together with the element
+  DBZSetElement *new_el = (DBZSetElement *)dbslab_alloc(zset_ele_size(level, member_length));
   if (!new_el)
     EXIT_ON_MEMORY_ERROR();
   new_el->score = score;
-  new_el->member = member;
+  new_el->member = (char *)(new_el->levels + level);
+  memcpy(new_el->member, member, member_length + 1);
+  new_el->member_hash = member_hash;
+  new_el->next_in_bucket = NULL;
   new_el->level = level;
-  new_el->forward = calloc(level, sizeof(DBZSetElement *));
-  if (!new_el->forward)
-    EXIT_ON_MEMORY_ERROR();
+  new_el->backward = NULL;
   return new_el;
 }
 
-static db_bool_t zset_has_member(DBZSet *zset, const char *member)
+// Links an element at the position of its score and member, `rank` holds the rank of each predecessor
+static void link_zset_ele(DBZSet *zset, DBZSetElement *element)
 {
-  if (!zset || !member)
+  DBZSetElement *update[SKIPLIST_MAXLEVEL];
+  db_uint_t rank[SKIPLIST_MAXLEVEL];
+  DBZSetElement *current = zset->header;
+
+  for (int lvl = zset->level - 1; lvl >= 0; --lvl)
+  {
+    rank[lvl] = lvl == zset->level - 1 ? 0 : rank[lvl + 1];
+    while (current->levels[lvl].forward && compare_zset_ele(current->levels[lvl].forward, element->score, element->member) < 0)
+    {
+      rank[lvl] += current->levels[lvl].span;
+      current = current->levels[lvl].forward;
+    }
+    update[lvl] = current;
+  }
+
+  // zset up level, the new levels of the header skip the whole list
+  for (int lvl = zset->level; lvl < element->level; ++lvl)
+  {
+    rank[lvl] = 0;
+    update[lvl] = zset->header;
+    update[lvl]->levels[lvl].span = zset->length;
+  }
+  if (element->level > zset->level)
+    zset->level = element->level;
+
+  for (int lvl = 0; lvl < element->level; ++lvl)
+  {
+    element->levels[lvl].forward = update[lvl]->levels[lvl].forward;
+    update[lvl]->levels[lvl].forward = element;
+    // the element splits the span of its predecessor
+    element->levels[lvl].span = update[lvl]->levels[lvl].span - (rank[0] - rank[lvl]);
+    update[lvl]->levels[lvl].span = rank[0] - rank[lvl] + 1;
+  }
+
+  // the higher levels now skip one more element
+  for (int lvl = element->level; lvl < zset->level; ++lvl)
+    ++update[lvl]->levels[lvl].span;
+
+  element->backward = update[0] == zset->header ? NULL : update[0];
+  if (element->levels[0].forward)
+    element->levels[0].forward->backward = element;
+  else
+    zset->tail = element;
+
+  ++zset->length;
+}
+
+// Unlinks an element, `update` holds its predecessor at each level
+static void unlink_zset_ele(DBZSet *zset, DBZSetElement *element, DBZSetElement **update)
+{
+  for (int lvl = 0; lvl < zset->level; ++lvl)
+  {
+    if (update[lvl]->levels[lvl].forward == element)
+    {
+      update[lvl]->levels[lvl].span += element->levels[lvl].span - 1;
+      update[lvl]->levels[lvl].forward = element->levels[lvl].forward;
+    }
+    else
+    {
+      --update[lvl]->levels[lvl].span;
+    }
+  }
+
+  if (element->levels[0].forward)
+    element->levels[0].forward->backward = element->backward;
+  else
+    zset->tail = element->backward;
+
+  // zset down level
+  while (zset->level > 1 && !zset->header->levels[zset->level - 1].forward)
+    --zset->level;
+
+  --zset->length;
+}
+
+// Finds the predecessors of the position of `score` and `member` at each level
+static void lookup_zset_update(DBZSet *zset, db_double_t score, const char *member, DBZSetElement **update)
+{
+  DBZSetElement *current = zset->header;
+
+  for (int lvl = zset->level - 1; lvl >= 0; --lvl)
+  {
+    while (current->levels[lvl].forward && compare_zset_ele(current->levels[lvl].forward, score, member) < 0)
+      current = current->levels[lvl].forward;
+    update[lvl] = current;
+  }
+}
+
+static void zset_index_resize(DBZSet *zset, db_uint_t new_size)
+{
+  DBZSetElement **new_buckets = (DBZSetElement **)calloc(new_size, sizeof(DBZSetElement *));
+  DBZSetElement *element, *next;
+
+  if (!new_buckets)
+    EXIT_ON_MEMORY_ERROR();
+
+  for (db_uint_t i = 0; i < zset->buckets_size; ++i)
+  {
+    for (element = zset->buckets[i]; element; element = next)
+    {
+      next = element->next_in_bucket;
+      element->next_in_bucket = new_buckets[element->member_hash & (new_size - 1)];
+      new_buckets[element->member_hash & (new_size - 1)] = element;
+    }
+  }
+
+  free(zset->buckets);
+  zset->buckets = new_buckets;
+  zset->buckets_size = new_size;
+}
+
+static DBZSetElement *zset_index_find(DBZSet *zset, const char *member, db_uint_t member_hash)
+{
+  if (!zset->buckets)
+    return NULL;
+
+  DBZSetElement *element = zset->buckets[member_hash & (zset->buckets_size - 1)];
+
+  while (element && (element->member_hash != member_hash || strcmp(element->member, member) != 0))
+    element = element->next_in_bucket;
+
+  return element;
+}
+
+// Adds an element to the member index, `length` must already count it
+static void zset_index_add(DBZSet *zset, DBZSetElement *element)
+{
+  if (!zset->buckets)
+    zset_index_resize(zset, HT_INITIAL_SIZE);
+  else if (zset->length > HT_LOAD_FACTOR_EXPAND * zset->buckets_size)
+    zset_index_resize(zset, zset->buckets_size * 2);
+
+  DBZSetElement **bucket = &zset->buckets[element->member_hash & (zset->buckets_size - 1)];
+  element->next_in_bucket = *bucket;
+  *bucket = element;
+}
+
+// Removes an element from the member index, `length` must no longer count it
+static void zset_index_remove(DBZSet *zset, DBZSetElement *element)
+{
+  DBZSetElement **link = &zset->buckets[element->member_hash & (zset->buckets_size - 1)];
+
+  while (*link != element)
+    link = &(*link)->next_in_bucket;
+  *link = element->next_in_bucket;
+
+  if (zset->buckets_size > HT_INITIAL_SIZE && zset->length < HT_LOAD_FACTOR_SHRINK * zset->buckets_size)
+    zset_index_resize(zset, zset->buckets_size / 2);
+}
+
+static DBZSetElement *zset_lookup(DBZSet *zset, const char *member)
+{
+  return zset_index_find(zset, member, ht_hash_key(member));
+}
+
+// Returns the entry of a member in the sorted array encoding, or NULL if it is not in the zset
+static DBZSetEntry *zset_array_find(DBZSet *zset, const char *member)
+{
+  // the entries are ordered by score, so the member can be anywhere
+  for (db_uint_t i = 0; i < zset->length; ++i)
+    if (strcmp(zset->entries[i].member, member) == 0)
+      return &zset->entries[i];
+  return NULL;
+}
+
+// Unlinks an element from both the skiplist and the member index, then frees it
+static void delete_zset_ele(DBZSet *zset, DBZSetElement *element, DBZSetElement **update)
+{
+  unlink_zset_ele(zset, element, update);
+  zset_index_remove(zset, element);
+  free_zset_ele(element);
+}
+
+// Returns the index where an entry with this score and member belongs in the sorted array
+static db_uint_t zset_array_search(DBZSet *zset, db_double_t score, const char *member)
+{
+  db_uint_t low = 0, high = zset->length, middle;
+  while (low < high)
+  {
+    middle = low + (high - low) / 2;
+    if (compare_zset_order(zset->entries[middle].score, zset->entries[middle].member, score, member) < 0)
+      low = middle + 1;
+    else
+      high = middle;
+  }
+  return low;
+}
+
+// Returns the index of the first entry above `min`, or `length` if there is none
+static db_uint_t zset_array_range_start(DBZSet *zset, db_double_t min, db_bool_t included_min)
+{
+  db_uint_t low = 0, high = zset->length, middle;
+  while (low < high)
+  {
+    middle = low + (high - low) / 2;
+    if (zset_score_above_min(zset->entries[middle].score, min, included_min))
+      high = middle;
+    else
+      low = middle + 1;
+  }
+  return low;
+}
+
+// Returns the index following the last entry below `max`
+static db_uint_t zset_array_range_end(DBZSet *zset, db_double_t max, db_bool_t included_max)
+{
+  db_uint_t low = 0, high = zset->length, middle;
+  while (low < high)
+  {
+    middle = low + (high - low) / 2;
+    if (zset_score_below_max(zset->entries[middle].score, max, included_max))
+      low = middle + 1;
+    else
+      high = middle;
+  }
+  return low;
+}
+
+// Inserts an entry at `index`, the zset takes ownership of `member`
+static void zset_array_insert(DBZSet *zset, db_uint_t index, db_double_t score, char *member)
+{
+  if (zset->length == zset->entries_capacity)
+  {
+    db_uint_t new_capacity = zset->entries_capacity ? zset->entries_capacity * 2 : 4;
+    DBZSetEntry *new_entries = (DBZSetEntry *)realloc(zset->entries, new_capacity * sizeof(DBZSetEntry));
+    if (!new_entries)
+      EXIT_ON_MEMORY_ERROR();
+    zset->entries = new_entries;
+    zset->entries_capacity = new_capacity;
+  }
+  memmove(&zset->entries[index + 1], &zset->entries[index], (zset->length - index) * sizeof(DBZSetEntry));
+  zset->entries[index].score = score;
+  zset->entries[index].member = member;
+  ++zset->length;
+}
+
+// Removes `count` entries from `index` without freeing their members
+static void zset_array_remove(DBZSet *zset, db_uint_t index, db_uint_t count)
+{
+  memmove(&zset->entries[index], &zset->entries[index + count], (zset->length - index - count) * sizeof(DBZSetEntry));
+  zset->length -= count;
+}
+
+// Sets up an empty skiplist and member index
+static void zset_init_skiplist(DBZSet *zset)
+{
+  zset->encoding = DB_ENC_DEFAULT;
+  zset->buckets = NULL;
+  zset->buckets_size = 0;
+  zset->level = 1;
+  zset->header = create_zset_ele(SKIPLIST_MAXLEVEL, 0, "", 0);
+  for (int lvl = 0; lvl < SKIPLIST_MAXLEVEL; ++lvl)
+  {
+    zset->header->levels[lvl].forward = NULL;
+    zset->header->levels[lvl].span = 0;
+  }
+  zset->tail = NULL;
+  zset->length = 0;
+}
+
+// Moves the entries of a zset in the sorted array encoding into a skiplist
+static void zset_convert_to_skiplist(DBZSet *zset)
+{
+  DBZSetEntry *entries = zset->entries;
+  db_uint_t length = zset->length;
+  DBZSetElement *element;
+
+  zset_init_skiplist(zset);
+  for (db_uint_t i = 0; i < length; ++i)
+  {
+    element = create_zset_ele(random_zset_level(), entries[i].score, entries[i].member, ht_hash_key(entries[i].member));
+    link_zset_ele(zset, element);
+    zset_index_add(zset, element);
+    free(entries[i].member);
+  }
+
+  free(entries);
+  zset->entries = NULL;
+  zset->entries_capacity = 0;
+}
+
+// Walks the members of a zset in order, whatever its encoding
+typedef struct ZSetIterator
+{
+  DBZSet *zset;
+  db_uint_t index;
+  DBZSetElement *element;
+} ZSetIterator;
+
+static void zset_iterator_init(ZSetIterator *iterator, DBZSet *zset)
+{
+  iterator->zset = zset;
+  iterator->index = 0;
+  iterator->element = zset->encoding == DB_ENC_SORTED_ARRAY ? NULL : zset->header->levels[0].forward;
+}
+
+// Returns false once every member has been visited
+static db_bool_t zset_iterator_next(ZSetIterator *iterator, const char **member, db_double_t *score)
+{
+  if (iterator->zset->encoding == DB_ENC_SORTED_ARRAY)
+  {
+    if (iterator->index >= iterator->zset->length)
+      return false;
+    *member = iterator->zset->entries[iterator->index].member;
+    *score = iterator->zset->entries[iterator->index].score;
+    ++iterator->index;
+    return true;
+  }
+
+  if (!iterator->element)
     return false;
-  DBHashEntry *element = hget(zset->dict, member, NULL);
-  return element ? true : false;
+  *member = iterator->element->member;
+  *score = iterator->element->score;
+  iterator->element = iterator->element->levels[0].forward;
+  return true;
 }
 
 DBZSet *zset_create()
@@ -125,9 +478,16 @@ DBZSet *zset_create()
   DBZSet *zset = (DBZSet *)malloc(sizeof(DBZSet));
   if (!zset)
     EXIT_ON_MEMORY_ERROR();
-  zset->dict = ht_create();
+  // small zsets never need the skiplist, it is only built once they outgrow the sorted array
+  zset->encoding = DB_ENC_SORTED_ARRAY;
+  zset->entries = NULL;
+  zset->entries_capacity = 0;
+  zset->buckets = NULL;
+  zset->buckets_size = 0;
   zset->level = 0;
-  zset->sentinel_forward = NULL;
+  zset->header = NULL;
+  zset->tail = NULL;
+  zset->length = 0;
   return zset;
 }
 
@@ -135,62 +495,266 @@ void free_dbzset(DBZSet *zset)
 {
   if (!zset)
     return;
-  DBZSetElement *curr = zset->sentinel_forward[0];
+  if (zset->encoding == DB_ENC_SORTED_ARRAY)
+  {
+    for (db_uint_t i = 0; i < zset->length; ++i)
+      free(zset->entries[i].member);
+    free(zset->entries);
+    free(zset);
+    return;
+  }
+  DBZSetElement *curr = zset->header->levels[0].forward;
   DBZSetElement *next;
   while (curr)
   {
-    next = curr->forward[0];
-    // we don't free member, because it will be free when free dict
-    free(curr->forward);
-    free(curr);
+    next = curr->levels[0].forward;
+    free_zset_ele(curr);
     curr = next;
   }
-  free(zset->sentinel_forward);
-  ht_free(zset->dict);
+  free_zset_ele(zset->header);
+  free(zset->buckets);
   free(zset);
 }
 
-db_uint_t zadd(DBZSet *zset, db_double_t score, const char *member)
+// Member with its combined score, the member is borrowed from one of the input zsets
+typedef struct ZSetScoredMember
 {
-  if (!member || !zset)
-    return 0;
+  const char *member;
+  db_uint_t member_hash;
+  db_double_t score;
+} ZSetScoredMember;
 
-  zrem(zset, member);
-  char *duplicated_member = dbutil_strdup(member);
-  DBZSetElement *element = create_zset_ele(score, duplicated_member);
-  hset(zset->dict, duplicated_member, _dbobj_create_zsetele(element), NULL);
+static int compare_zset_scored_members(const void *a, const void *b)
+{
+  const ZSetScoredMember *member_a = (const ZSetScoredMember *)a;
+  const ZSetScoredMember *member_b = (const ZSetScoredMember *)b;
+  return compare_zset_order(member_a->score, member_a->member, member_b->score, member_b->member);
+}
+
+static inline db_double_t zset_weighted_score(db_double_t score, const db_double_t *weights, db_uint_t index)
+{
+  score = weights ? score * weights[index] : score;
+  // 0 * inf is not a number, it counts as 0
+  return isnan(score) ? 0 : score;
+}
 
-  // zset up level
-  while (zset->level < element->level)
+static db_double_t zset_aggregate_score(db_aggregate_t aggregate, db_double_t total, db_double_t score)
+{
+  switch (aggregate)
+  {
+  case DB_AGG_MIN:
+    return score < total ? score : total;
+  case DB_AGG_MAX:
+    return score > total ? score : total;
+  default:
+    total += score;
+    // inf + -inf is not a number either
+    return isnan(total) ? 0 : total;
+  }
+}
+
+// Reads the score of a member without allocating; returns false if it is not in the zset
+static db_bool_t zset_get_score(DBZSet *zset, const char *member, db_uint_t member_hash, db_double_t *score)
+{
+  if (zset->encoding == DB_ENC_SORTED_ARRAY)
   {
-    DBZSetElement **new_sentinel_forward = (DBZSetElement **)realloc(zset->sentinel_forward, (++zset->level) * sizeof(DBZSetElement *));
-    if (!new_sentinel_forward)
+    DBZSetEntry *entry = zset_array_find(zset, member);
+    if (!entry)
+      return false;
+    *score = entry->score;
+    return true;
+  }
+
+  DBZSetElement *element = zset_index_find(zset, member, member_hash);
+  if (!element)
+    return false;
+  *score = element->score;
+  return true;
+}
+
+// Builds a zset from members sorted by score, then by member
+// Each element is appended at the tail of the skiplist, so the build is O(n)
+static DBZSet *zset_create_from_sorted(const ZSetScoredMember *members, db_uint_t length)
+{
+  DBZSet *zset = zset_create();
+  db_bool_t fits_array = length <= ZSET_MAX_SORTED_ARRAY_ENTRIES;
+  db_uint_t i;
+
+  for (i = 0; i < length && fits_array; ++i)
+    fits_array = strlen(members[i].member) <= ZSET_MAX_SORTED_ARRAY_VALUE;
+
+  if (fits_array)
+  {
+    if (!length)
+      return zset;
+    zset->entries = (DBZSetEntry *)malloc(length * sizeof(DBZSetEntry));
+    if (!zset->entries)
       EXIT_ON_MEMORY_ERROR();
-    zset->sentinel_forward = new_sentinel_forward;
-    zset->sentinel_forward[zset->level - 1] = NULL;
+    zset->entries_capacity = length;
+    for (i = 0; i < length; ++i)
+    {
+      zset->entries[i].score = members[i].score;
+      zset->entries[i].member = dbutil_strdup(members[i].member);
+    }
+    zset->length = length;
+    return zset;
   }
 
-  // insert element
-  DBZSetElement *previous = NULL;
-  for (int lvl = element->level; --lvl >= 0;)
+  // last element reached at each level and its 1-based rank
+  DBZSetElement *last[SKIPLIST_MAXLEVEL];
+  db_uint_t last_rank[SKIPLIST_MAXLEVEL];
+  db_uint_t buckets_size = HT_INITIAL_SIZE;
+  DBZSetElement *element;
+  int lvl;
+
+  zset_init_skiplist(zset);
+  for (lvl = 0; lvl < SKIPLIST_MAXLEVEL; ++lvl)
   {
-    previous = lookup_previos_element_in_level(zset, lvl, element, previous);
-    if (previous == element)
-      continue;
-    if (previous)
-      element->forward[lvl] = previous->forward[lvl],
-      previous->forward[lvl] = element;
-    else
-      element->forward[lvl] = zset->sentinel_forward[lvl],
-      zset->sentinel_forward[lvl] = element;
-    if (lvl == 0)
-      element->backward = previous;
+    last[lvl] = zset->header;
+    last_rank[lvl] = 0;
   }
-  if (element->forward[0])
-    element->forward[0]->backward = element;
-  else
+
+  // the member index is sized up front, so it never grows during the build
+  while (length > HT_LOAD_FACTOR_EXPAND * buckets_size)
+    buckets_size *= 2;
+  zset_index_resize(zset, buckets_size);
+
+  for (i = 0; i < length; ++i)
+  {
+    element = create_zset_ele(random_zset_level(), members[i].score, members[i].member, members[i].member_hash);
+    if (element->level > zset->level)
+      zset->level = element->level;
+    for (lvl = 0; lvl < element->level; ++lvl)
+    {
+      last[lvl]->levels[lvl].forward = element;
+      last[lvl]->levels[lvl].span = i + 1 - last_rank[lvl];
+      last[lvl] = element;
+      last_rank[lvl] = i + 1;
+    }
+    element->backward = zset->tail;
     zset->tail = element;
+    ++zset->length;
+    zset_index_add(zset, element);
+  }
+
+  // the last element of each level skips to the end of the list
+  for (lvl = 0; lvl < zset->level; ++lvl)
+  {
+    last[lvl]->levels[lvl].forward = NULL;
+    last[lvl]->levels[lvl].span = length - last_rank[lvl];
+  }
+
+  return zset;
+}
+
+// Changes the score of an entry in the sorted array encoding
+static void zset_array_update_score(DBZSet *zset, DBZSetEntry *entry, db_double_t score)
+{
+  db_uint_t index = entry - zset->entries;
+  char *member = entry->member;
+
+  // the entry keeps its place if the new score does not cross a neighbour
+  if ((index == 0 || compare_zset_order(zset->entries[index - 1].score, zset->entries[index - 1].member, score, member) < 0) &&
+      (index + 1 == zset->length || compare_zset_order(zset->entries[index + 1].score, zset->entries[index + 1].member, score, member) > 0))
+  {
+    entry->score = score;
+    return;
+  }
+
+  zset_array_remove(zset, index, 1);
+  zset_array_insert(zset, zset_array_search(zset, score, member), score, member);
+}
+
+// Changes the score of an element in the skiplist
+static void zset_update_score(DBZSet *zset, DBZSetElement *element, db_double_t score)
+{
+  // the element keeps its place if the new score does not cross a neighbour
+  if ((!element->backward || compare_zset_ele(element->backward, score, element->member) < 0) &&
+      (!element->levels[0].forward || compare_zset_ele(element->levels[0].forward, score, element->member) > 0))
+  {
+    element->score = score;
+    return;
+  }
+
+  // otherwise the same element moves, nothing is freed or allocated
+  DBZSetElement *update[SKIPLIST_MAXLEVEL];
+  lookup_zset_update(zset, element->score, element->member, update);
+  unlink_zset_ele(zset, element, update);
+  element->score = score;
+  link_zset_ele(zset, element);
+}
+
+db_zadd_result_t zadd_with_flags(DBZSet *zset, db_double_t score, const char *member, db_uint8_t flags, db_double_t *new_score)
+{
+  if (!member || !zset)
+    return DB_ZADD_ABORTED;
 
+  DBZSetEntry *entry = NULL;
+  DBZSetElement *element = NULL;
+  db_uint_t member_hash = 0;
+  db_double_t current_score;
+
+  if (zset->encoding == DB_ENC_SORTED_ARRAY)
+    entry = zset_array_find(zset, member);
+  else
+  {
+    member_hash = ht_hash_key(member);
+    element = zset_index_find(zset, member, member_hash);
+  }
+
+  if (entry || element)
+  {
+    current_score = entry ? entry->score : element->score;
+    if (new_score)
+      *new_score = current_score;
+    if (flags & DB_ZADD_FLAG_NX)
+      return DB_ZADD_ABORTED;
+    if (flags & DB_ZADD_FLAG_INCR)
+    {
+      score += current_score;
+      if (isnan(score))
+        return DB_ZADD_NAN;
+    }
+    if (((flags & DB_ZADD_FLAG_GT) && score <= current_score) || ((flags & DB_ZADD_FLAG_LT) && score >= current_score))
+      return DB_ZADD_ABORTED;
+    if (new_score)
+      *new_score = score;
+    if (score == current_score)
+      return DB_ZADD_UNCHANGED;
+
+    if (entry)
+      zset_array_update_score(zset, entry, score);
+    else
+      zset_update_score(zset, element, score);
+    return DB_ZADD_UPDATED;
+  }
+
+  if (flags & DB_ZADD_FLAG_XX)
+    return DB_ZADD_ABORTED;
+  if (new_score)
+    *new_score = score;
+
+  if (zset->encoding == DB_ENC_SORTED_ARRAY)
+  {
+    if (zset->length < ZSET_MAX_SORTED_ARRAY_ENTRIES && strlen(member) <= ZSET_MAX_SORTED_ARRAY_VALUE)
+    {
+      zset_array_insert(zset, zset_array_search(zset, score, member), score, dbutil_strdup(member));
+      return DB_ZADD_ADDED;
+    }
+    zset_convert_to_skiplist(zset);
+    member_hash = ht_hash_key(member);
+  }
+
+  element = create_zset_ele(random_zset_level(), score, member, member_hash);
+  link_zset_ele(zset, element);
+  zset_index_add(zset, element);
+
+  return DB_ZADD_ADDED;
+}
+
+db_uint_t zadd(DBZSet *zset, db_double_t score, const char *member)
+{
+  zadd_with_flags(zset, score, member, 0, NULL);
   return zcard(zset);
 }
 
@@ -198,281 +762,293 @@ DBObj *zscore(DBZSet *zset, const char *member)
 {
   if (!zset || !member)
     return dbobj_create_null();
-  DBHashEntry *entry = hget(zset->dict, member, NULL);
-  if (!entry)
+  if (zset->encoding == DB_ENC_SORTED_ARRAY)
+  {
+    DBZSetEntry *entry = zset_array_find(zset, member);
+    return entry ? dbobj_create_double(entry->score) : dbobj_create_null();
+  }
+  DBZSetElement *element = zset_lookup(zset, member);
+  if (!element)
     return dbobj_create_null();
-  return dbobj_create_double(entry->data->value._zsetele->score);
+  return dbobj_create_double(element->score);
 }
 
 db_uint_t zcard(DBZSet *zset)
 {
   if (!zset)
     return 0;
-  return zset->dict->count0 + zset->dict->count1;
+  return zset->length;
 }
 
 db_uint_t zcount(DBZSet *zset, db_double_t min, db_bool_t included_min, db_double_t max, db_bool_t included_max)
 {
-  if (min >= max)
+  if (!zset)
     return 0;
-  DBZSetElement *curr = lookup_first_element_with_score(zset, min, included_min);
-  DBZSetElement *last = lookup_last_element_with_score(zset, max, included_max);
-  db_uint_t count = 1;
-  while (curr && curr != last)
+  if (zset->encoding == DB_ENC_SORTED_ARRAY)
   {
-    ++count;
-    curr = curr->forward[0];
+    db_uint_t start = zset_array_range_start(zset, min, included_min);
+    db_uint_t end = zset_array_range_end(zset, max, included_max);
+    return end > start ? end - start : 0;
   }
-  return count;
+  DBZSetElement *first = lookup_first_element_in_range(zset, min, included_min, max, included_max);
+  if (!first)
+    return 0;
+  DBZSetElement *last = lookup_last_element_in_range(zset, min, included_min, max, included_max);
+  // the ranks of both ends give the count without walking the range
+  return lookup_element_rank(zset, last) - lookup_element_rank(zset, first) + 1;
 }
 
-DBObj *zinterstore(DBList *zsets, DBList *weights, db_aggregate_t aggregate)
+DBZSet *zinterstore(DBZSet **zsets, db_uint_t zsets_count, const db_double_t *weights, db_aggregate_t aggregate)
 {
-  if (!zsets)
-    return dbobj_create_error(DB_ERR_WRONGTYPE);
-
   DBZSet *smallest_set = NULL;
+  db_uint_t i;
 
-  DBListNode *curr_zset_node = zsets->head;
-  DBZSet *curr_zset;
-  DBZSetElement *curr_zset_ele;
-  db_double_t curr_zset_ele_score;
-
-  DBListNode *curr_weight_node = weights ? weights->head : NULL;
-  db_double_t curr_weight;
-
-  DBObj *new_zset_ele_score_obj;
-  db_double_t new_zset_ele_score;
-
-  // find smallest set
-  while (curr_zset_node)
+  // a missing zset is empty, so is the intersection
+  for (i = 0; i < zsets_count; ++i)
   {
-    if (!dbobj_is_zset(curr_zset_node->data))
-      return dbobj_create_error(DB_ERR_WRONGTYPE);
-    curr_zset = curr_zset_node->data->value.zset;
-    if (!smallest_set || zcard(smallest_set) > zcard(curr_zset))
-      smallest_set = curr_zset;
-    curr_zset_node = curr_zset_node->next;
+    if (!zsets[i])
+      return zset_create();
+    if (!smallest_set || zcard(smallest_set) > zcard(zsets[i]))
+      smallest_set = zsets[i];
   }
-  if (!smallest_set)
-    return dbobj_create_error(DB_ERR_ARG_ERROR);
+  if (!smallest_set || !zcard(smallest_set))
+    return zset_create();
 
-  DBZSet *new_zset = zset_create();
-  DBList *members = create_dblist();
-  char *curr_member;
-  bool has_member;
+  // only the members of the smallest zset can be in every zset, they are looked up in the others
+  ZSetScoredMember *members = (ZSetScoredMember *)malloc(zcard(smallest_set) * sizeof(ZSetScoredMember));
+  db_uint_t members_count = 0, member_hash;
+  ZSetIterator iterator;
+  const char *member;
+  db_double_t member_score, score, total = 0;
+  db_bool_t in_all;
 
-  // makesure all sets has this member
-  curr_zset_ele = smallest_set->sentinel_forward[0];
-  while (curr_zset_ele)
-  {
-    has_member = true;
-    DBListNode *curr_zset_node = zsets->head;
-    while (curr_zset_node)
-    {
-      curr_zset = curr_zset_node->data->value.zset;
-      if (curr_zset != smallest_set && !zset_has_member(curr_zset, curr_zset_ele->member))
-      {
-        has_member = false;
-        break;
-      }
-      curr_zset_node = curr_zset_node->next;
-    }
-    if (has_member)
-      rpush(members, create_dblistnode_with_string(curr_zset_ele->member));
-    curr_zset_ele = curr_zset_ele->forward[0];
-  }
+  if (!members)
+    EXIT_ON_MEMORY_ERROR();
 
-  // aggregate
-  curr_member = extract_dblistnode_string(lpop(members));
-  while (curr_member)
+  zset_iterator_init(&iterator, smallest_set);
+  while (zset_iterator_next(&iterator, &member, &member_score))
   {
-    curr_zset_node = zsets->head;
-    while (curr_zset_node)
+    member_hash = ht_hash_key(member);
+    in_all = true;
+    // scores are aggregated in the order of the zsets, whichever one is the smallest
+    for (i = 0; i < zsets_count; ++i)
     {
-      curr_zset = curr_zset_node->data->value.zset;
-      curr_weight = curr_weight_node ? curr_weight_node->data->value.double_value : 1;
-
-      new_zset_ele_score_obj = zscore(new_zset, curr_member);
-      curr_zset_ele_score = dbobj_extract_double(zscore(curr_zset, curr_member)) * curr_weight;
-      switch (aggregate)
+      if (zsets[i] == smallest_set)
+        score = member_score;
+      else if (!zset_get_score(zsets[i], member, member_hash, &score))
       {
-      case DB_AGG_SUM:
-        new_zset_ele_score = dbobj_extract_double(new_zset_ele_score_obj) + curr_zset_ele_score;
-        break;
-      case DB_AGG_MIN:
-        if (!dbobj_is_double(new_zset_ele_score_obj))
-        {
-          new_zset_ele_score = curr_zset_ele_score;
-          free_dbobj(new_zset_ele_score_obj);
-          break;
-        }
-        new_zset_ele_score = dbobj_extract_double(new_zset_ele_score_obj);
-        new_zset_ele_score = new_zset_ele_score < curr_zset_ele_score
-                                 ? new_zset_ele_score
-                                 : curr_zset_ele_score;
+        in_all = false;
         break;
-      case DB_AGG_MAX:
-        if (!dbobj_is_double(new_zset_ele_score_obj))
-        {
-          new_zset_ele_score = curr_zset_ele_score;
-          free_dbobj(new_zset_ele_score_obj);
-          break;
-        }
-        new_zset_ele_score = dbobj_extract_double(new_zset_ele_score_obj);
-        new_zset_ele_score = new_zset_ele_score > curr_zset_ele_score
-                                 ? new_zset_ele_score
-                                 : curr_zset_ele_score;
-        break;
-      default:
-        free_dbobj(new_zset_ele_score_obj);
-        free_dblist(members);
-        free_dbzset(new_zset);
-        free(curr_member);
-        return dbobj_create_error(DB_ERR_SYNTAX_ERROR);
       }
-      zadd(new_zset, new_zset_ele_score, curr_member);
-
-      curr_zset_node = curr_zset_node->next;
-      curr_weight_node = curr_weight_node ? curr_weight_node->next : NULL;
+      score = zset_weighted_score(score, weights, i);
+      total = i == 0 ? score : zset_aggregate_score(aggregate, total, score);
     }
-    free(curr_member);
-    curr_member = extract_dblistnode_string(lpop(members));
+    if (!in_all)
+      continue;
+    members[members_count].member = member;
+    members[members_count].member_hash = member_hash;
+    members[members_count].score = total;
+    ++members_count;
   }
-  free_dblist(members);
-  return dbobj_create_zset(new_zset);
+
+  qsort(members, members_count, sizeof(ZSetScoredMember), compare_zset_scored_members);
+  DBZSet *result = zset_create_from_sorted(members, members_count);
+  free(members);
+  return result;
 }
 
-DBObj *zunionstore(DBList *zsets, DBList *weights, db_aggregate_t aggregate)
+DBZSet *zunionstore(DBZSet **zsets, db_uint_t zsets_count, const db_double_t *weights, db_aggregate_t aggregate)
 {
-  if (!zsets)
-    return dbobj_create_error(DB_ERR_WRONGTYPE);
-
-  DBZSet *new_zset = zset_create();
+  db_uint_t total_length = 0, capacity = HT_INITIAL_SIZE, members_count = 0, member_hash, slot, i;
 
-  DBListNode *curr_zset_node = zsets->head;
-  DBZSet *curr_zset;
-  DBZSetElement *curr_zset_ele;
-  db_double_t curr_zset_ele_score;
+  for (i = 0; i < zsets_count; ++i)
+    total_length += zcard(zsets[i]);
+  while (capacity < total_length * 2)
+    capacity *= 2;
 
-  DBListNode *curr_weight_node = weights ? weights->head : NULL;
-  db_double_t curr_weight;
+  // open addressing accumulator, at most half full so the probe sequences stay short
+  ZSetScoredMember *slots = (ZSetScoredMember *)calloc(capacity, sizeof(ZSetScoredMember));
+  ZSetIterator iterator;
+  const char *member;
+  db_double_t score;
 
-  DBObj *new_zset_ele_score_obj;
-  db_double_t new_zset_ele_score;
+  if (!slots)
+    EXIT_ON_MEMORY_ERROR();
 
-  while (curr_zset_node)
+  for (i = 0; i < zsets_count; ++i)
   {
-    if (!dbobj_is_zset(curr_zset_node->data))
-      return free_dbzset(new_zset), dbobj_create_error(DB_ERR_WRONGTYPE);
-    curr_zset = curr_zset_node->data->value.zset;
-    curr_weight = curr_weight_node ? curr_weight_node->data->value.double_value : 1;
-    curr_zset_ele = curr_zset->sentinel_forward[0];
-    while (curr_zset_ele)
+    if (!zsets[i])
+      continue;
+    zset_iterator_init(&iterator, zsets[i]);
+    while (zset_iterator_next(&iterator, &member, &score))
     {
-      new_zset_ele_score_obj = zscore(new_zset, curr_zset_ele->member);
-      curr_zset_ele_score = curr_zset_ele->score * curr_weight;
-      switch (aggregate)
+      score = zset_weighted_score(score, weights, i);
+      member_hash = ht_hash_key(member);
+      slot = member_hash & (capacity - 1);
+      while (slots[slot].member && (slots[slot].member_hash != member_hash || strcmp(slots[slot].member, member) != 0))
+        slot = (slot + 1) & (capacity - 1);
+
+      if (slots[slot].member)
       {
-      case DB_AGG_SUM:
-        new_zset_ele_score = dbobj_extract_double(new_zset_ele_score_obj) + curr_zset_ele_score;
-        break;
-      case DB_AGG_MIN:
-        if (!dbobj_is_double(new_zset_ele_score_obj))
-        {
-          new_zset_ele_score = curr_zset_ele_score;
-          free_dbobj(new_zset_ele_score_obj);
-          break;
-        }
-        new_zset_ele_score = dbobj_extract_double(new_zset_ele_score_obj);
-        new_zset_ele_score = new_zset_ele_score < curr_zset_ele_score
-                                 ? new_zset_ele_score
-                                 : curr_zset_ele_score;
-        break;
-      case DB_AGG_MAX:
-        if (!dbobj_is_double(new_zset_ele_score_obj))
-        {
-          new_zset_ele_score = curr_zset_ele_score;
-          free_dbobj(new_zset_ele_score_obj);
-          break;
-        }
-        new_zset_ele_score = dbobj_extract_double(new_zset_ele_score_obj);
-        new_zset_ele_score = new_zset_ele_score > curr_zset_ele_score
-                                 ? new_zset_ele_score
-                                 : curr_zset_ele_score;
-        break;
-      default:
-        free_dbzset(new_zset);
-        return dbobj_create_error(DB_ERR_SYNTAX_ERROR);
+        slots[slot].score = zset_aggregate_score(aggregate, slots[slot].score, score);
+        continue;
       }
-      zadd(new_zset, new_zset_ele_score, curr_zset_ele->member);
-      curr_zset_ele = curr_zset_ele->forward[0];
+      slots[slot].member = member;
+      slots[slot].member_hash = member_hash;
+      slots[slot].score = score;
+      ++members_count;
     }
-    curr_zset_node = curr_zset_node->next;
-    curr_weight_node = curr_weight_node ? curr_weight_node->next : NULL;
   }
 
-  return dbobj_create_zset(new_zset);
+  // the occupied slots are packed at the front, then sorted once
+  for (i = 0, slot = 0; i < capacity; ++i)
+    if (slots[i].member)
+      slots[slot++] = slots[i];
+
+  qsort(slots, members_count, sizeof(ZSetScoredMember), compare_zset_scored_members);
+  DBZSet *result = zset_create_from_sorted(slots, members_count);
+  free(slots);
+  return result;
+}
+
+static void zset_push_member(DBList *list, const char *member, db_double_t score, db_bool_t withscores)
+{
+  rpush(list, create_dblistnode(dbobj_create_string(dbutil_strdup(member))));
+  if (withscores)
+    rpush(list, create_dblistnode(dbobj_create_double(score)));
 }
 
 DBList *zrange(DBZSet *zset, db_uint_t start, db_uint_t stop, db_bool_t withscores)
 {
   if (!zset)
     return NULL;
-  db_uint_t index = 0;
-  DBZSetElement *curr = zset->sentinel_forward[0];
   DBList *list = create_dblist();
-  while (curr)
+  if (start >= zset->length || start > stop)
+    return list;
+  if (stop >= zset->length)
+    stop = zset->length - 1;
+  if (zset->encoding == DB_ENC_SORTED_ARRAY)
   {
-    if (index >= start && index <= stop)
-    {
-      rpush(list, create_dblistnode(dbobj_create_string(dbutil_strdup(curr->member))));
-      if (withscores)
-        rpush(list, create_dblistnode(dbobj_create_double(curr->score)));
-    }
-    ++index;
-    curr = curr->forward[0];
+    for (db_uint_t index = start; index <= stop; ++index)
+      zset_push_member(list, zset->entries[index].member, zset->entries[index].score, withscores);
+    return list;
+  }
+  // jump to the first element of the window through the spans
+  DBZSetElement *curr = lookup_element_by_rank(zset, start + 1);
+  for (db_uint_t index = start; curr && index <= stop; ++index)
+  {
+    zset_push_member(list, curr->member, curr->score, withscores);
+    curr = curr->levels[0].forward;
   }
   return list;
 }
 
-DBList *zrangebyscore(DBZSet *zset, db_double_t min, db_bool_t included_min, db_double_t max, db_bool_t included_max, db_bool_t withscores)
+DBList *zrevrange(DBZSet *zset, db_uint_t start, db_uint_t stop, db_bool_t withscores)
 {
-  if (!zset || min >= max)
+  if (!zset)
     return NULL;
-  DBZSetElement *curr = lookup_first_element_with_score(zset, min, included_min);
-  DBZSetElement *last = lookup_last_element_with_score(zset, max, included_max);
-  if (last)
-    last = last->forward[0];
   DBList *list = create_dblist();
-  while (curr && curr != last)
+  if (start >= zset->length || start > stop)
+    return list;
+  if (stop >= zset->length)
+    stop = zset->length - 1;
+  if (zset->encoding == DB_ENC_SORTED_ARRAY)
+  {
+    for (db_uint_t index = start; index <= stop; ++index)
+      zset_push_member(list, zset->entries[zset->length - 1 - index].member, zset->entries[zset->length - 1 - index].score, withscores);
+    return list;
+  }
+  // rank `start` from the end is rank `length - start` from the start, the window is walked backward
+  DBZSetElement *curr = lookup_element_by_rank(zset, zset->length - start);
+  for (db_uint_t index = start; curr && index <= stop; ++index)
   {
-    rpush(list, create_dblistnode(dbobj_create_string(dbutil_strdup(curr->member))));
-    if (withscores)
-      rpush(list, create_dblistnode(dbobj_create_double(curr->score)));
-    curr = curr->forward[0];
+    zset_push_member(list, curr->member, curr->score, withscores);
+    curr = curr->backward;
   }
   return list;
 }
 
-DBObj *zrank(DBZSet *zset, const char *member, const db_bool_t withscores)
+DBList *zrangebyscore(DBZSet *zset, db_double_t min, db_bool_t included_min, db_double_t max, db_bool_t included_max,
+                      db_uint_t offset, db_uint_t count, db_bool_t withscores)
 {
-  if (!zset || !member)
-    return dbobj_create_null();
+  if (!zset)
+    return NULL;
+  DBList *list = create_dblist();
+  if (zset->encoding == DB_ENC_SORTED_ARRAY)
+  {
+    db_uint_t start = zset_array_range_start(zset, min, included_min);
+    db_uint_t end = zset_array_range_end(zset, max, included_max);
+    if (end <= start || offset >= end - start)
+      return list;
+    for (db_uint_t index = start + offset; index < end && count; ++index, --count)
+      zset_push_member(list, zset->entries[index].member, zset->entries[index].score, withscores);
+    return list;
+  }
+  DBZSetElement *curr = lookup_first_element_in_range(zset, min, included_min, max, included_max);
+  // the offset is skipped through the spans instead of walking it
+  if (curr && offset)
+    curr = offset < zset->length ? lookup_element_by_rank(zset, lookup_element_rank(zset, curr) + offset) : NULL;
+  for (; curr && count && zset_score_below_max(curr->score, max, included_max); --count)
+  {
+    zset_push_member(list, curr->member, curr->score, withscores);
+    curr = curr->levels[0].forward;
+  }
+  return list;
+}
 
-  DBHashEntry *entry = hget(zset->dict, member, NULL);
+DBList *zrevrangebyscore(DBZSet *zset, db_double_t min, db_bool_t included_min, db_double_t max, db_bool_t included_max,
+                         db_uint_t offset, db_uint_t count, db_bool_t withscores)
+{
+  if (!zset)
+    return NULL;
+  DBList *list = create_dblist();
+  if (zset->encoding == DB_ENC_SORTED_ARRAY)
+  {
+    db_uint_t start = zset_array_range_start(zset, min, included_min);
+    db_uint_t end = zset_array_range_end(zset, max, included_max);
+    if (end <= start || offset >= end - start)
+      return list;
+    for (db_uint_t index = end - offset; index > start && count; --index, --count)
+      zset_push_member(list, zset->entries[index - 1].member, zset->entries[index - 1].score, withscores);
+    return list;
+  }
+  DBZSetElement *curr = lookup_last_element_in_range(zset, min, included_min, max, included_max);
+  if (curr && offset)
+  {
+    db_uint_t rank = lookup_element_rank(zset, curr);
+    curr = offset < rank ? lookup_element_by_rank(zset, rank - offset) : NULL;
+  }
+  for (; curr && count && zset_score_above_min(curr->score, min, included_min); --count)
+  {
+    zset_push_member(list, curr->member, curr->score, withscores);
+    curr = curr->backward;
+  }
+  return list;
+}
 
-  if (!entry)
+DBObj *zrank(DBZSet *zset, const char *member, const db_bool_t withscores)
+{
+  if (!zset || !member)
     return dbobj_create_null();
 
-  DBZSetElement *element = entry->data->value._zsetele;
-  DBZSetElement *current = zset->sentinel_forward[0];
-  db_int_t rank = 0;
+  db_int_t rank;
+  db_double_t score;
 
-  while (current != element)
+  if (zset->encoding == DB_ENC_SORTED_ARRAY)
+  {
+    DBZSetEntry *entry = zset_array_find(zset, member);
+    if (!entry)
+      return dbobj_create_null();
+    rank = (db_int_t)(entry - zset->entries);
+    score = entry->score;
+  }
+  else
   {
-    current = current->forward[0];
-    ++rank;
+    DBZSetElement *element = zset_lookup(zset, member);
+    if (!element)
+      return dbobj_create_null();
+    rank = (db_int_t)lookup_element_rank(zset, element) - 1;
+    score = element->score;
   }
 
   if (!withscores)
@@ -480,7 +1056,7 @@ DBObj *zrank(DBZSet *zset, const char *member, const db_bool_t withscores)
 
   DBList *list = create_dblist();
   rpush(list, create_dblistnode(dbobj_create_int(rank)));
-  rpush(list, create_dblistnode(dbobj_create_double(element->score)));
+  rpush(list, create_dblistnode(dbobj_create_double(score)));
   return dbobj_create_list(list);
 }
 
@@ -489,64 +1065,104 @@ db_uint_t zrem(DBZSet *zset, const char *member)
   if (!zset || !member)
     return 0;
 
-  // remove element from zset dict
-  DBZSetElement *element = _dbobj_extract_zsetele(ht_extract_entry(ht_remove(zset->dict, member, NULL)));
-
-  if (!element)
-    return 0;
-
-  // rebuild element member, because it freed when extract hash entry
-  element->member = dbutil_strdup(member);
-
-  // remove element from zset skip list
-  DBZSetElement *previous = NULL;
-  if (element->forward[0])
-    element->forward[0]->backward = element->backward;
-  for (int lvl = element->level; --lvl >= 0;)
+  if (zset->encoding == DB_ENC_SORTED_ARRAY)
   {
-    previous = lookup_previos_element_in_level(zset, lvl, element, NULL);
-    if (previous && previous != element)
-      previous->forward[lvl] = element->forward[lvl];
-    else if (zset->sentinel_forward[lvl] == element)
-      zset->sentinel_forward[lvl] = element->forward[lvl];
+    DBZSetEntry *entry = zset_array_find(zset, member);
+    if (!entry)
+      return 0;
+    free(entry->member);
+    zset_array_remove(zset, entry - zset->entries, 1);
+    return 1;
   }
-  if (zset->tail == element)
-    zset->tail = element->backward;
 
-  // zset down level
-  while (zset->level > 1 && zset->sentinel_forward[zset->level - 1] == NULL)
-  {
-    DBZSetElement **new_sentinel_forward = (DBZSetElement **)realloc(zset->sentinel_forward, (--zset->level) * sizeof(DBZSetElement *));
-    if (!new_sentinel_forward)
-      EXIT_ON_MEMORY_ERROR();
-    zset->sentinel_forward = new_sentinel_forward;
-  }
+  DBZSetElement *element = zset_lookup(zset, member);
 
-  // free memories, we don't free the member, because it was freed when extracted DBObj
-  free(element->forward);
-  free(element->member);
-  free(element);
+  if (!element)
+    return 0;
+
+  DBZSetElement *update[SKIPLIST_MAXLEVEL];
+  lookup_zset_update(zset, element->score, element->member, update);
+  delete_zset_ele(zset, element, update);
 
   return 1;
 }
 
 db_uint_t zremrangebyscore(DBZSet *zset, db_double_t min, db_bool_t included_min, db_double_t max, db_bool_t included_max)
 {
-  if (!zset || min >= max)
+  if (!zset)
     return 0;
 
-  DBZSetElement *curr = lookup_first_element_with_score(zset, min, included_min);
+  if (zset->encoding == DB_ENC_SORTED_ARRAY)
+  {
+    db_uint_t start = zset_array_range_start(zset, min, included_min);
+    db_uint_t end = zset_array_range_end(zset, max, included_max);
+    if (end <= start)
+      return 0;
+    for (db_uint_t index = start; index < end; ++index)
+      free(zset->entries[index].member);
+    zset_array_remove(zset, start, end - start);
+    return end - start;
+  }
+
+  DBZSetElement *curr = lookup_first_element_in_range(zset, min, included_min, max, included_max);
+
+  if (!curr)
+    return 0;
+
+  // the removed elements are consecutive, so they all share the predecessors of the first one
+  DBZSetElement *update[SKIPLIST_MAXLEVEL];
   DBZSetElement *next;
-  DBZSetElement *last = lookup_last_element_with_score(zset, max, included_max);
-  if (last)
-    last = last->forward[0];
   db_uint_t count = 0;
-  while (curr && curr != last)
+
+  lookup_zset_update(zset, curr->score, curr->member, update);
+  while (curr && zset_score_below_max(curr->score, max, included_max))
   {
+    next = curr->levels[0].forward;
+    delete_zset_ele(zset, curr, update);
     ++count;
-    next = curr->forward[0];
-    zrem(zset, curr->member);
     curr = next;
   }
   return count;
 }
+
+db_uint_t zscan(DBZSet *zset, db_uint_t cursor, const DBGlobPattern *glob, db_uint_t count, DBList *result)
+{
+  if (!zset || !result)
+    return 0;
+
+  // a zset in the sorted array encoding is small, it is returned in a single call
+  if (zset->encoding == DB_ENC_SORTED_ARRAY)
+  {
+    for (db_uint_t i = 0; i < zset->length; ++i)
+    {
+      if (glob && !dbutil_glob_match(glob, zset->entries[i].member, strlen(zset->entries[i].member)))
+        continue;
+      rpush(result, create_dblistnode_with_string(zset->entries[i].member));
+      rpush(result, create_dblistnode(dbobj_create_double(zset->entries[i].score)));
+    }
+    return 0;
+  }
+
+  if (!zset->buckets)
+    return 0;
+
+  db_uint_t visited_count = 0;
+  db_uint_t max_steps = count ? count * HT_SCAN_BUCKETS_PER_COUNT : HT_SCAN_BUCKETS_PER_COUNT;
+  DBZSetElement *element;
+
+  // the member index is scanned like a hash table, so resizes between calls do not skip members
+  do
+  {
+    for (element = zset->buckets[cursor & (zset->buckets_size - 1)]; element; element = element->next_in_bucket)
+    {
+      ++visited_count;
+      if (glob && !dbutil_glob_match(glob, element->member, strlen(element->member)))
+        continue;
+      rpush(result, create_dblistnode_with_string(element->member));
+      rpush(result, create_dblistnode(dbobj_create_double(element->score)));
+    }
+    cursor = ht_next_cursor(cursor, zset->buckets_size);
+  } while (cursor && --max_steps && visited_count < count);
+
+  return cursor;
+}
@@ -3,30 +3,57 @@
 
 #include "types.h"
 
+// Zsets are stored in the sorted array encoding until they have more members than this
+#define ZSET_MAX_SORTED_ARRAY_ENTRIES 128
+// or one of their members is longer than this
+#define ZSET_MAX_SORTED_ARRAY_VALUE 64
+
 DBZSet *zset_create();
 
 void free_dbzset(DBZSet *zset);
 
 db_uint_t zadd(DBZSet *zset, db_double_t score, const char *member);
 
+// Adds or updates a member according to `flags` (DB_ZADD_FLAG_*), `score` is the increment with DB_ZADD_FLAG_INCR
+// `new_score` (may be NULL) receives the score of the member when it is in the zset afterwards
+// A member only moves in the zset when its new score crosses one of its neighbours
+db_zadd_result_t zadd_with_flags(DBZSet *zset, db_double_t score, const char *member, db_uint8_t flags, db_double_t *new_score);
+
 DBObj *zscore(DBZSet *zset, const char *member);
 
 db_uint_t zcard(DBZSet *zset);
 
 db_uint_t zcount(DBZSet *zset, db_double_t min, db_bool_t included_min, db_double_t max, db_bool_t included_max);
 
-DBObj *zinterstore(DBList *zsets, DBList *weights, db_aggregate_t aggregate);
+// Returns a new zset combining `zsets`, a NULL zset counts as empty
+// The score of a member in each zset is multiplied by the weight of the zset (all 1 if `weights` is NULL),
+// then the weighted scores are aggregated
+DBZSet *zinterstore(DBZSet **zsets, db_uint_t zsets_count, const db_double_t *weights, db_aggregate_t aggregate);
 
-DBObj *zunionstore(DBList *zsets, DBList *weights, db_aggregate_t aggregate);
+DBZSet *zunionstore(DBZSet **zsets, db_uint_t zsets_count, const db_double_t *weights, db_aggregate_t aggregate);
 
 DBList *zrange(DBZSet *zset, db_uint_t start, db_uint_t stop, db_bool_t withscores);
 
-DBList *zrangebyscore(DBZSet *zset, db_double_t min, db_bool_t included_min, db_double_t max, db_bool_t included_max, db_bool_t withscores);
+// Same as `zrange` with ranks counted from the highest score
+DBList *zrevrange(DBZSet *zset, db_uint_t start, db_uint_t stop, db_bool_t withscores);
+
+// Returns at most `count` members within the score range, skipping the first `offset` ones
+// Both are O(log n), so the cost only grows with the number of returned members
+DBList *zrangebyscore(DBZSet *zset, db_double_t min, db_bool_t included_min, db_double_t max, db_bool_t included_max,
+                      db_uint_t offset, db_uint_t count, db_bool_t withscores);
+
+// Same as `zrangebyscore` walking from the highest score
+DBList *zrevrangebyscore(DBZSet *zset, db_double_t min, db_bool_t included_min, db_double_t max, db_bool_t included_max,
+                         db_uint_t offset, db_uint_t count, db_bool_t withscores);
 
 DBObj *zrank(DBZSet *zset, const char *member, const db_bool_t withscores);
 
 db_uint_t zrem(DBZSet *zset, const char *member);
 
+// Appends the member and score of about `count` elements matching `glob` (NULL for all) to `result`
+// Returns the next cursor, or 0 when the whole zset has been visited
+db_uint_t zscan(DBZSet *zset, db_uint_t cursor, const DBGlobPattern *glob, db_uint_t count, DBList *result);
+
 db_uint_t zremrangebyscore(DBZSet *zset, db_double_t min, db_bool_t included_min, db_double_t max, db_bool_t included_max);
 
 #endif
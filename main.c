@@ -1,12 +1,59 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "algorithms.h"
 #include "social_network.h"
 #include "database.h"
 #include "db/api.h"
 
-int main()
+// Loads the commands of a file, or of stdin for "-", into the database and saves it
+static int pipe_commands(const char *filepath)
 {
+  FILE *input = strcmp(filepath, "-") ? fopen(filepath, "rb") : stdin;
+  if (!input)
+  {
+    perror(filepath);
+    return 1;
+  }
+
+  start_db();
+  DBPipeStats stats;
+  db_bool_t valid = dbapi_pipe(input, &stats);
+  save_db();
+  if (input != stdin)
+    fclose(input);
+
+  printf("commands: %u, errors: %u, bytes: %zu\n", stats.commands, stats.errors, stats.bytes);
+  printf("%.3f s, %.0f commands/s\n", stats.seconds, stats.seconds > 0 ? stats.commands / stats.seconds : 0);
+  if (!valid)
+    printf("the input is not valid, the commands before the error were run\n");
+
+  return valid && !stats.errors ? 0 : 1;
+}
+
+// Measures how fast a command is parsed, without running it
+static int bench_parse(const char *command, const char *iterations_arg)
+{
+  char *end;
+  unsigned long iterations = strtoul(iterations_arg, &end, 10);
+  if (*end != '\0' || !iterations || iterations > DB_UINT_MAX)
+  {
+    printf("the number of iterations must be a positive integer\n");
+    return 1;
+  }
+
+  printf("%.0f commands/s\n", dbapi_bench_parse(command, (db_uint_t)iterations));
+  return 0;
+}
+
+int main(int argc, char **argv)
+{
+  if (argc == 3 && !strcmp(argv[1], "--pipe"))
+    return pipe_commands(argv[2]);
+  if (argc == 4 && !strcmp(argv[1], "--bench-parse"))
+    return bench_parse(argv[2], argv[3]);
+
   printf("program start\n");
   start_db();
 
@@ -108,29 +108,29 @@ void init_social_network(void)
   DBHash *tag_prob_dict = ht_create();
   // { [tag_name]: [tag_id] }
   DBHash *tag_id_dict = ht_create();
-  hset(tag_prob_dict, "tag-A", dbobj_create_double(0.80), NULL);
-  hset(tag_prob_dict, "tag-B", dbobj_create_double(0.80), NULL);
-  hset(tag_prob_dict, "tag-C", dbobj_create_double(0.75), NULL);
-  hset(tag_prob_dict, "tag-D", dbobj_create_double(0.70), NULL);
-  hset(tag_prob_dict, "tag-E", dbobj_create_double(0.60), NULL);
-  hset(tag_prob_dict, "tag-F", dbobj_create_double(0.50), NULL);
-  hset(tag_prob_dict, "tag-G", dbobj_create_double(0.45), NULL);
-  hset(tag_prob_dict, "tag-H", dbobj_create_double(0.40), NULL);
-  hset(tag_prob_dict, "tag-I", dbobj_create_double(0.35), NULL);
-  hset(tag_prob_dict, "tag-J", dbobj_create_double(0.25), NULL);
-  hset(tag_prob_dict, "tag-K", dbobj_create_double(0.25), NULL);
-  hset(tag_prob_dict, "tag-L", dbobj_create_double(0.20), NULL);
-  hset(tag_prob_dict, "tag-M", dbobj_create_double(0.20), NULL);
-  hset(tag_prob_dict, "tag-N", dbobj_create_double(0.20), NULL);
-  hset(tag_prob_dict, "tag-O", dbobj_create_double(0.20), NULL);
-  DBList *tag_name_list = ht_keys(tag_prob_dict, NULL);
+  hset(tag_prob_dict, "tag-A", dbobj_create_double(0.80));
+  hset(tag_prob_dict, "tag-B", dbobj_create_double(0.80));
+  hset(tag_prob_dict, "tag-C", dbobj_create_double(0.75));
+  hset(tag_prob_dict, "tag-D", dbobj_create_double(0.70));
+  hset(tag_prob_dict, "tag-E", dbobj_create_double(0.60));
+  hset(tag_prob_dict, "tag-F", dbobj_create_double(0.50));
+  hset(tag_prob_dict, "tag-G", dbobj_create_double(0.45));
+  hset(tag_prob_dict, "tag-H", dbobj_create_double(0.40));
+  hset(tag_prob_dict, "tag-I", dbobj_create_double(0.35));
+  hset(tag_prob_dict, "tag-J", dbobj_create_double(0.25));
+  hset(tag_prob_dict, "tag-K", dbobj_create_double(0.25));
+  hset(tag_prob_dict, "tag-L", dbobj_create_double(0.20));
+  hset(tag_prob_dict, "tag-M", dbobj_create_double(0.20));
+  hset(tag_prob_dict, "tag-N", dbobj_create_double(0.20));
+  hset(tag_prob_dict, "tag-O", dbobj_create_double(0.20));
+  DBList *tag_name_list = ht_keys(tag_prob_dict);
   {
     DBListNode *tag_node = tag_name_list->head;
     while (tag_node)
     {
       const char *tag_name = tag_node->data->value.string;
       char *id = create_tag_with_id_returned(tag_name);
-      hset(tag_id_dict, tag_name, dbobj_create_string(id), NULL);
+      hset(tag_id_dict, tag_name, dbobj_create_string(id));
       tag_node = tag_node->next;
     }
   }
@@ -143,12 +143,12 @@ void init_social_network(void)
     while (tag_name_node)
     {
       // 計算使用者的到 tag 的概率
-      const DBHashEntry *tag_probability_entry = hget(tag_prob_dict, tag_name_node->data->value.string, NULL);
+      const DBHashEntry *tag_probability_entry = hget(tag_prob_dict, tag_name_node->data->value.string);
       const double again_tag_prob = tag_probability_entry->data->value.double_value;
       if (drand() < again_tag_prob)
       {
         const char *tag_name = tag_name_node->data->value.string;
-        const char *tag_id = hget(tag_id_dict, tag_name, NULL)->data->value.string;
+        const char *tag_id = hget(tag_id_dict, tag_name)->data->value.string;
         const double tag_weight = drand(); // 計算使用者此 atag 的權重
         TagWithWeight *tag_with_w = create_tag_w(tag_id, tag_weight);
         const char *atag_string = serialize_tag_w(tag_with_w);
@@ -180,7 +180,7 @@ void init_social_network(void)
       EXIT_ON_ERROR("Tag id node is NULL");
 
     const char *tag_name = tag_name_node->data->value.string;
-    const char *tag_id = hget(tag_id_dict, tag_name, NULL)->data->value.string;
+    const char *tag_id = hget(tag_id_dict, tag_name)->data->value.string;
     rpush(post_tags, create_dblistnode_with_string(tag_id));
 
     // 以下是讓 post 獲取多個 tag 的方法，但目前不採用
@@ -229,7 +229,7 @@ void init_users_ptags(DBList *ptags)
 
 static DBList *likes_dict_to_ptags(DBHash *likes_dict, size_t user_count)
 {
-  DBList *post_ids = ht_keys(likes_dict, NULL);
+  DBList *post_ids = ht_keys(likes_dict);
   // 當 tag 出現時，被按贊的次數
   DBHash *tag_likes_dict = ht_create();
   // tag 出現的總次數
@@ -239,19 +239,17 @@ static DBList *likes_dict_to_ptags(DBHash *likes_dict, size_t user_count)
   while (post_id_node)
   {
     const char *post_id = post_id_node->data->value.string;
-    const DBHashEntry *post_likes_entry = hget(likes_dict, post_id, NULL);
+    const DBHashEntry *post_likes_entry = hget(likes_dict, post_id);
+    db_int_t post_likes_count = 0;
     if (post_likes_entry)
-      dbobj_string_to_int(post_likes_entry->data);
-    const int post_likes_count = post_likes_entry ? post_likes_entry->data->value.int_value : 0;
-    if (post_likes_entry)
-      dbobj_int_to_string(post_likes_entry->data);
+      dbobj_string_get_int(post_likes_entry->data, &post_likes_count);
     DBList *post_tags = get_post_tags(post_id);
     DBListNode *tag_node = post_tags->head;
     while (tag_node)
     {
       const char *tag_id = tag_node->data->value.string;
-      hincrby(tag_likes_dict, tag_id, post_likes_count, NULL);
-      hincrby(tag_total_dict, tag_id, user_count, NULL);
+      hincrby(tag_likes_dict, tag_id, post_likes_count);
+      hincrby(tag_total_dict, tag_id, user_count);
       tag_node = tag_node->next;
     }
     free_dblist(post_tags);
@@ -259,20 +257,17 @@ static DBList *likes_dict_to_ptags(DBHash *likes_dict, size_t user_count)
   }
 
   DBList *result_ptags = create_dblist();
-  DBList *ptag_ids = ht_keys(tag_total_dict, NULL);
+  DBList *ptag_ids = ht_keys(tag_total_dict);
   DBListNode *ptag_id_node = ptag_ids->head;
   while (ptag_id_node)
   {
     const char *ptag_id = ptag_id_node->data->value.string;
-    const DBHashEntry *tag_likes_entry = hget(tag_likes_dict, ptag_id, NULL);
-    const DBHashEntry *tag_total_entry = hget(tag_total_dict, ptag_id, NULL);
-    dbobj_string_to_int(tag_likes_entry->data);
-    dbobj_string_to_int(tag_total_entry->data);
-    const double ptag_likes_count = (double)tag_likes_entry->data->value.int_value;
-    const double ptag_total_count = (double)tag_total_entry->data->value.int_value;
-    dbobj_int_to_string(tag_likes_entry->data);
-    dbobj_int_to_string(tag_total_entry->data);
-    const double ptag_w = ptag_likes_count / ptag_total_count;
+    const DBHashEntry *tag_likes_entry = hget(tag_likes_dict, ptag_id);
+    const DBHashEntry *tag_total_entry = hget(tag_total_dict, ptag_id);
+    db_int_t ptag_likes_count = 0, ptag_total_count = 0;
+    dbobj_string_get_int(tag_likes_entry->data, &ptag_likes_count);
+    dbobj_string_get_int(tag_total_entry->data, &ptag_total_count);
+    const double ptag_w = (double)ptag_likes_count / (double)ptag_total_count;
     TagWithWeight *tag_with_w = create_tag_w(ptag_id, ptag_w);
     char *serialized_ptags = serialize_tag_w(tag_with_w);
     rpush(result_ptags, create_dblistnode_with_string(serialized_ptags));
@@ -318,12 +313,11 @@ void free_user_feedback(UserFeedback *feedback)
   free(feedback);
 }
 
-static double calculate_post_like_probability(const char *post_id, DBList *atags)
+static double calculate_post_like_probability(DBList *post_tags, DBList *atags)
 {
   double like_probability = 0;
-  DBList *post_tags = get_post_tags(post_id);
 
-  DBListNode *post_tag_node = post_tags->head;
+  DBListNode *post_tag_node = post_tags ? post_tags->head : NULL;
   while (post_tag_node)
   {
     const char *post_tag_id = post_tag_node->data->value.string;
@@ -345,36 +339,40 @@ static double calculate_post_like_probability(const char *post_id, DBList *atags
     post_tag_node = post_tag_node->next;
   }
 end:
-  free_dblist(post_tags);
   return like_probability > 1 ? 1 : like_probability;
 }
 
 UserFeedback *simulate_user_feedback(const char *user_id, DBList *post_ids)
 {
   DBList *user_atags = get_user_atags(user_id);
+  DBList *posts_tags = get_posts_tags(post_ids);
   DBHash *likes_dict = ht_create();
   DBListNode *post_node = post_ids->head;
+  DBListNode *post_tags_node = posts_tags->head;
   size_t likes_count = 0;
   size_t posts_count = 0;
 
-  while (post_node)
+  while (post_node && post_tags_node)
   {
     const char *post_id = post_node->data->value.string;
+    DBList *post_tags = dbobj_is_list(post_tags_node->data) ? post_tags_node->data->value.list : NULL;
 
-    if (drand() < calculate_post_like_probability(post_id, user_atags))
+    if (drand() < calculate_post_like_probability(post_tags, user_atags))
     {
-      hincrby(likes_dict, post_id, 1, NULL);
+      hincrby(likes_dict, post_id, 1);
       ++likes_count;
     }
     else
     {
-      hincrby(likes_dict, post_id, 0, NULL);
+      hincrby(likes_dict, post_id, 0);
     }
 
     ++posts_count;
     post_node = post_node->next;
+    post_tags_node = post_tags_node->next;
   }
 
+  free_dblist(posts_tags);
   free_dblist(user_atags);
 
   return create_user_feedback(likes_dict, 1, likes_count, posts_count);
@@ -404,15 +402,11 @@ UserFeedback *collect_popular_feedback(DBList *post_ids)
     while (post_id_node)
     {
       const char *post_id = post_id_node->data->value.string;
-      const DBHashEntry *is_liked_entry = hget(feedback->likes_dict, post_id, NULL);
+      const DBHashEntry *is_liked_entry = hget(feedback->likes_dict, post_id);
+      db_int_t is_liked = 0;
       if (is_liked_entry)
-      {
-        dbobj_string_to_int(is_liked_entry->data);
-        hincrby(users_likes_dict, post_id, is_liked_entry->data->value.int_value, NULL);
-        dbobj_int_to_string(is_liked_entry->data);
-      }
-      else
-        hincrby(users_likes_dict, post_id, 0, NULL);
+        dbobj_string_get_int(is_liked_entry->data, &is_liked);
+      hincrby(users_likes_dict, post_id, is_liked);
       post_id_node = post_id_node->next;
     }
 
@@ -502,17 +496,17 @@ static DBList *recommand_posts(
   DBListNode *part_node = base_part->head;
   while (part_node)
   {
-    hset(recommanded_post_dict, part_node->data->value.string, dbobj_create_bool(true), NULL);
+    hset(recommanded_post_dict, part_node->data->value.string, dbobj_create_bool(true));
     part_node = part_node->next;
   }
   part_node = test_part->head;
   while (part_node)
   {
-    hset(recommanded_post_dict, part_node->data->value.string, dbobj_create_bool(true), NULL);
+    hset(recommanded_post_dict, part_node->data->value.string, dbobj_create_bool(true));
     part_node = part_node->next;
   }
 
-  DBList *recommanded_posts = ht_keys(recommanded_post_dict, NULL);
+  DBList *recommanded_posts = ht_keys(recommanded_post_dict);
 
   ht_free(recommanded_post_dict);
   free_dblist(base_part);
@@ -579,21 +573,16 @@ static void clear_users_ptags(DBList *user_ids)
   {
     const char *user_id = user_id_node1->data->value.string;
     DBList *user_ptags = get_user_ptags(user_id);
-    DBList *filtered_user_ptags = create_dblist();
-    DBListNode *ptag_node = lpop(user_ptags);
+    DBListNode *ptag_node = user_ptags->head;
     while (ptag_node)
     {
       TagWithWeight *tag_with_w = parse_tag_w(ptag_node->data->value.string);
       if (tag_with_w->weight < CLEAN_PTAG_THRESHOLD)
-        free_dblistnode(ptag_node);
-      else
-        rpush(filtered_user_ptags, ptag_node);
+        remove_user_ptag(user_id, ptag_node->data->value.string);
       free_tag_w(tag_with_w);
-      ptag_node = lpop(user_ptags);
+      ptag_node = ptag_node->next;
     }
-    set_user_ptags(user_id, filtered_user_ptags);
     free_dblist(user_ptags);
-    free_dblist(filtered_user_ptags);
     user_id_node1 = user_id_node1->next;
   }
 }
@@ -696,28 +685,7 @@ void run_simulations(
   free_dblist(likes_rates);
 
   // clean ptags
-  DBListNode *user_id_node = user_ids->head;
-  while (user_id_node)
-  {
-    const char *user_id = user_id_node->data->value.string;
-    DBList *user_ptags = get_user_ptags(user_id);
-    DBList *filtered_user_ptags = create_dblist();
-    DBListNode *ptag_node = lpop(user_ptags);
-    while (ptag_node)
-    {
-      TagWithWeight *tag_with_w = parse_tag_w(ptag_node->data->value.string);
-      if (tag_with_w->weight < CLEAN_PTAG_THRESHOLD)
-        free_dblistnode(ptag_node);
-      else
-        rpush(filtered_user_ptags, ptag_node);
-      free_tag_w(tag_with_w);
-      ptag_node = lpop(user_ptags);
-    }
-    set_user_ptags(user_id, filtered_user_ptags);
-    free_dblist(user_ptags);
-    free_dblist(filtered_user_ptags);
-    user_id_node = user_id_node->next;
-  }
+  clear_users_ptags(user_ids);
 
   popular_id = create_user_with_id_returned(POPULAR_USER_NAME, used_popular_ptags);
 